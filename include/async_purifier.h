@@ -0,0 +1,267 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   async_purifier.h
+ * @author Aludirk Wong
+ * @date   2017-08-21
+ */
+
+#ifndef __LAKOO_ASYNC_PURIFIER_H__
+#define __LAKOO_ASYNC_PURIFIER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "text_purifier.h"
+
+
+namespace lakoo
+{
+    template <typename _Type>
+    class MpmcQueue;
+
+    //! The operation of an AsyncRequest.
+    enum class AsyncOperation
+    {
+        //! To check whether the text needs to be purified, as TextPurifier::check.
+        Check,
+
+        //! To purify the text, as TextPurifier::purify.
+        Purify
+    };
+
+    //! What AsyncPurifier::submit does if the queue is full.
+    enum class Backpressure
+    {
+        //! To wait for a free slot.
+        Block,
+
+        //! To reject the request at once.
+        Reject
+    };
+
+    //! The status of an AsyncResult.
+    enum class AsyncStatus
+    {
+        //! The request is done.
+        Done,
+
+        //! The request is rejected as the queue is full or the purifier is stopping.
+        Rejected
+    };
+
+    //! A request to AsyncPurifier.
+    struct AsyncRequest
+    {
+        //! The AsyncOperation.
+        AsyncOperation _operation;
+
+        //! The UTF-8 text.
+        std::string _text;
+
+        //! The UTF-8 mask of each word to purify, empty for a '*' per character.
+        std::string _mask;
+    };
+
+    //! The result of an AsyncRequest.
+    struct AsyncResult
+    {
+        //! The AsyncStatus.
+        AsyncStatus _status;
+
+        //! The tag given to AsyncPurifier::submit, 0 for the other ways of completion.
+        std::uint64_t _tag;
+
+        //! Whether the text has any word.
+        bool _isFound;
+
+        //! The purified text, empty for AsyncOperation::Check.
+        std::string _text;
+    };
+
+    //! To check and purify text on worker threads, without blocking the threads submitting.
+    /**
+     * The requests are pushed into a bounded lock-free queue, and the workers take them in
+     * batches of up to 64, each worker with its own ScanContext. A request completes in one of
+     * three ways:
+     * - through a std::future, for the threads which can wait;
+     * - through a callback, called from the worker thread;
+     * - into the completion queue with a tag, signalling a file descriptor which an event loop
+     *   can watch by epoll or poll, then AsyncPurifier::poll takes the results.
+     *
+     * The TextPurifier must outlive the AsyncPurifier, and its words and options must not be
+     * changed while requests are pending. The destructor finishes all requests in the queue.
+     */
+    class AsyncPurifier final
+    {
+    public:
+        //! The callback to receive the result of a request.
+        /**
+         * It is called from a worker thread and should return quickly.
+         * @param [in]     context The user context given to AsyncPurifier::submit.
+         * @param [in,out] result  The AsyncResult, the text can be moved away.
+         */
+        typedef void (*CompletionCallback)(void* context, AsyncResult& result);
+
+    public:
+        //! Constructor with a worker per core, a queue of 4096 requests and Backpressure::Block.
+        /**
+         * @param [in] purifier The TextPurifier.
+         */
+        explicit AsyncPurifier(const TextPurifier& purifier);
+
+        /**
+         * @overload
+         * @param [in] purifier     The TextPurifier.
+         * @param [in] threadCount  The number of workers, 0 to use the number of cores.
+         * @param [in] queueSize    The maximum number of pending requests, rounded up to a power
+         *                          of 2.
+         * @param [in] backpressure What to do if the queue is full.
+         */
+        AsyncPurifier(const TextPurifier& purifier,
+                      std::size_t threadCount,
+                      std::size_t queueSize,
+                      Backpressure backpressure);
+
+        //! Destructor.
+        ~AsyncPurifier();
+
+        //! Deleted copy constructor.
+        AsyncPurifier(const AsyncPurifier&) = delete;
+
+        //! Deleted assignment operator.
+        AsyncPurifier& operator=(const AsyncPurifier&) = delete;
+
+    public:
+        //! To submit a request completed through a future.
+        /**
+         * @param [in] request The AsyncRequest.
+         * @return             The future of the AsyncResult, which is ready at once with
+         *                     AsyncStatus::Rejected if the request is rejected.
+         */
+        std::future<AsyncResult> submit(AsyncRequest request);
+
+        //! To submit a request completed through a callback.
+        /**
+         * @param [in] request  The AsyncRequest.
+         * @param [in] callback The CompletionCallback.
+         * @param [in] context  The user context passed to the callback.
+         * @return              \c false if the request is rejected, the callback is not called.
+         */
+        bool submit(AsyncRequest request, CompletionCallback callback, void* context);
+
+        //! To submit a request completed into the completion queue.
+        /**
+         * @param [in] request The AsyncRequest.
+         * @param [in] tag     The tag of the AsyncResult, to tell the requests apart.
+         * @return             \c false if the request is rejected.
+         * @sa AsyncPurifier::poll
+         */
+        bool submit(AsyncRequest request, std::uint64_t tag);
+
+        //! The file descriptor which is readable once the completion queue has results.
+        /**
+         * It is an eventfd on Linux and the read end of a pipe elsewhere, owned by the
+         * AsyncPurifier. Do not read it, AsyncPurifier::poll does.
+         * @return The file descriptor, -1 if it cannot be created.
+         */
+        int completionFd() const;
+
+        //! To take the results in the completion queue without waiting.
+        /**
+         * @param [out] results The results to append to.
+         * @return              The number of results taken.
+         */
+        std::size_t poll(std::vector<AsyncResult>& results);
+
+    private:
+        //! A request in the queue with the way to complete it.
+        struct Job;
+
+        //! To push a job into the queue by the Backpressure.
+        bool push(Job& job);
+
+        //! To take a batch of jobs, waiting if the queue is empty.
+        /**
+         * @param [out] batch The jobs.
+         * @return            \c false if the purifier is stopped and the queue is empty.
+         */
+        bool pop(std::vector<Job>& batch);
+
+        //! The loop of a worker.
+        void work();
+
+    private:
+        //! The TextPurifier.
+        const TextPurifier& _purifier;
+
+        //! What to do if the queue is full.
+        const Backpressure _backpressure;
+
+        //! The queue of jobs.
+        std::unique_ptr<MpmcQueue<Job>> _queue;
+
+        //! The number of jobs pushed and not yet popped.
+        std::atomic<std::size_t> _pendingCount;
+
+        //! The number of workers waiting for jobs.
+        std::atomic<std::size_t> _idleCount;
+
+        //! The number of threads waiting for a free slot.
+        std::atomic<std::size_t> _blockedCount;
+
+        //! Whether the purifier is stopping.
+        std::atomic<bool> _isStopped;
+
+        //! The mutex for the threads to sleep on, never held while a job is pushed or popped.
+        std::mutex _mutex;
+
+        //! To wake up the idle workers.
+        std::condition_variable _notEmpty;
+
+        //! To wake up the blocked threads.
+        std::condition_variable _notFull;
+
+        //! The mutex of the completion queue.
+        std::mutex _completionMutex;
+
+        //! The results completed with tags.
+        std::vector<AsyncResult> _completions;
+
+        //! The file descriptor to read, signalling the completion queue.
+        int _readFd;
+
+        //! The file descriptor to write, the same as _readFd for an eventfd.
+        int _writeFd;
+
+        //! The workers.
+        std::vector<std::thread> _workers;
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_ASYNC_PURIFIER_H__
@@ -0,0 +1,255 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   static_dictionary.h
+ * @author Aludirk Wong
+ * @date   2017-08-11
+ */
+
+#ifndef __LAKOO_STATIC_DICTIONARY_H__
+#define __LAKOO_STATIC_DICTIONARY_H__
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "text_purifier.h"
+
+
+namespace lakoo
+{
+    //! A fixed word list compiled into constant tables, matched without any construction.
+    /**
+     * The tables are generated by \c textpurifier-gen from a word file, one word per line in
+     * UTF-8, as a header of \c constexpr arrays which are placed in read-only data:
+     * @code
+     * textpurifier-gen reserved_names.txt reservedNames > reserved_names.h
+     * @endcode
+     * @code
+     * #include "reserved_names.h"
+     * bool isReserved = reservedNames.check(name.data(), name.size());
+     * @endcode
+     * The words are normalized and matched the same way as TextPurifier, and the word IDs
+     * follow the first lines of the words. Patterns, word boundaries and approximate matching
+     * are not supported. This header does not need the library.
+     */
+    class StaticDictionary final
+    {
+    public:
+        //! A node of the automaton, its edges are contiguous and sorted by the characters.
+        struct Node
+        {
+            //! The index of the first edge.
+            std::uint32_t _firstEdge;
+
+            //! The number of edges.
+            std::uint32_t _edgeCount;
+
+            //! Whether a word ends at the node.
+            bool _isFinal;
+        };
+
+        //! An edge of the automaton.
+        struct Edge
+        {
+            //! The character of the edge.
+            wchar_t _character;
+
+            //! The index of the next node.
+            std::uint32_t _target;
+
+            //! The number of words ordered before the words through the edge, from its node.
+            std::uint32_t _rank;
+        };
+
+    public:
+        //! Constructor.
+        /**
+         * @param [in] nodes     The nodes, the root is the first one.
+         * @param [in] nodeCount The number of nodes.
+         * @param [in] edges     The edges.
+         * @param [in] wordIds   The word IDs by the ranks of the words.
+         * @param [in] wordCount The number of words.
+         */
+        constexpr StaticDictionary(const Node* nodes,
+                                   std::size_t nodeCount,
+                                   const Edge* edges,
+                                   const std::size_t* wordIds,
+                                   std::size_t wordCount)
+        : _nodes(nodes)
+        , _nodeCount(nodeCount)
+        , _edges(edges)
+        , _wordIds(wordIds)
+        , _wordCount(wordCount)
+        {
+        }
+
+    public:
+        //! The number of nodes.
+        /**
+         * @return The number of nodes.
+         */
+        constexpr std::size_t nodeCount() const { return _nodeCount; }
+
+        //! The number of words.
+        /**
+         * @return The number of words.
+         */
+        constexpr std::size_t wordCount() const { return _wordCount; }
+
+        //! To visit all word segments to filter.
+        /**
+         * @param [in] str     The wchar_t string to check.
+         * @param [in] size    The length of the string.
+         * @param [in] mode    The MatchMode.
+         * @param [in] visitor The callable with signature
+         *                     <tt>bool(std::size_t start, std::size_t length, std::size_t wordId)</tt>,
+         *                     returns \c false to stop the scan.
+         * @return             \c false if the scan is stopped by the visitor.
+         */
+        template <typename _Visitor>
+        bool find(const wchar_t* str, std::size_t size, MatchMode mode, _Visitor&& visitor) const;
+
+        /**
+         * @overload
+         * @param [in] str     The wchar_t string to check.
+         * @param [in] size    The length of the string.
+         * @param [in] visitor The callable to receive the word segments, by MatchMode::All.
+         */
+        template <typename _Visitor>
+        bool find(const wchar_t* str, std::size_t size, _Visitor&& visitor) const
+        {
+            return find(str, size, MatchMode::All, visitor);
+        }
+
+        //! To check whether the string contains any word.
+        /**
+         * @param [in] str  The wchar_t string to check.
+         * @param [in] size The length of the string.
+         * @return          \c true if any word is found.
+         */
+        bool check(const wchar_t* str, std::size_t size) const
+        {
+            auto stop = [](std::size_t, std::size_t, std::size_t) { return false; };
+            return !find(str, size, MatchMode::LeftmostFirst, stop);
+        }
+
+    private:
+        //! To follow the edge of a character.
+        /**
+         * @param [in] node      The node.
+         * @param [in] character The character of the edge.
+         * @return               The edge, nullptr if there is no such edge.
+         */
+        const Edge* next(const Node& node, wchar_t character) const
+        {
+            const Edge* first = _edges + node._firstEdge;
+            const Edge* last = first + node._edgeCount;
+            const Edge* edge = std::lower_bound(first, last, character,
+                                                [](const Edge& edge, wchar_t character)
+            {
+                return edge._character < character;
+            });
+            return (last != edge && edge->_character == character) ? edge : nullptr;
+        }
+
+    private:
+        //! The nodes, the root is the first one.
+        const Node* _nodes;
+
+        //! The number of nodes.
+        std::size_t _nodeCount;
+
+        //! The edges.
+        const Edge* _edges;
+
+        //! The word IDs by the ranks of the words.
+        const std::size_t* _wordIds;
+
+        //! The number of words.
+        std::size_t _wordCount;
+    };
+
+
+    template <typename _Visitor>
+    bool StaticDictionary::find(const wchar_t* str,
+                                std::size_t size,
+                                MatchMode mode,
+                                _Visitor&& visitor) const
+    {
+        for(std::size_t charIndex = 0; charIndex < size; ++charIndex)
+        {
+            if(L' ' == str[charIndex])
+            {
+                continue;
+            }
+
+            std::size_t end = std::numeric_limits<std::size_t>::max();
+            std::size_t wordId = 0;
+            const Node* node = _nodes;
+            std::size_t rank = 0;
+            for(std::size_t findIndex = charIndex; findIndex < size; ++findIndex)
+            {
+                const wchar_t ch = static_cast<wchar_t>(::tolower(str[findIndex]));
+                if(L' ' == ch)
+                {
+                    continue;
+                }
+
+                const Edge* edge = next(*node, ch);
+                if(nullptr == edge)
+                {
+                    break;
+                }
+
+                node = _nodes + edge->_target;
+                rank += edge->_rank;
+                if(node->_isFinal &&
+                   (MatchMode::LeftmostFirst != mode ||
+                    std::numeric_limits<std::size_t>::max() == end ||
+                    _wordIds[rank] < wordId))
+                {
+                    end = findIndex;
+                    wordId = _wordIds[rank];
+                }
+            }
+
+            if(std::numeric_limits<std::size_t>::max() != end)
+            {
+                if(!visitor(charIndex, end - charIndex + 1, wordId))
+                {
+                    return false;
+                }
+
+                if(MatchMode::All != mode)
+                {
+                    // Skip the positions covered by the reported word segment.
+                    charIndex = end;
+                }
+            }
+        }
+
+        return true;
+    }
+} // namespace lakoo
+
+#endif // __LAKOO_STATIC_DICTIONARY_H__
@@ -26,20 +26,345 @@
 #ifndef __LAKOO_TEXT_PURIFIER_H__
 #define __LAKOO_TEXT_PURIFIER_H__
 
+#include <cstddef>
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 
 //! The namespace for Lakoo library.
 namespace lakoo
 {
     class FilterList;
+    class HitSketch;
+    struct MaskTable;
+    class ResultCache;
+    struct ScanBuffer;
+    class StatisticsCounters;
+
+
+    //! The semantics of reporting the matched word segments.
+    enum class MatchMode
+    {
+        //! The longest word from every start position, the word segments may overlap.
+        All,
+
+        //! The longest word from the leftmost start position, the scan resumes after it.
+        LeftmostLongest,
+
+        //! The earliest added word from the leftmost start position, the scan resumes after it.
+        LeftmostFirst
+    };
+
+
+    //! The counters of the result cache of TextPurifier.
+    struct CacheStatistics
+    {
+        //! The number of results taken from the cache.
+        std::size_t _hits;
+
+        //! The number of results not in the cache.
+        std::size_t _misses;
+
+        //! The number of results in the cache.
+        std::size_t _size;
+    };
+
+
+    //! The phases of purifying and checking, see TextPurifier::latencyStatistics.
+    enum class Phase
+    {
+        //! Transcoding the UTF-8 or UTF-16 input to a wide string.
+        TranscodeIn,
+
+        //! Folding the input to lower case.
+        CaseFold,
+
+        //! Scanning the input for the words.
+        Scan,
+
+        //! Writing the masks into the purified string.
+        Rewrite,
+
+        //! Transcoding the purified string to UTF-8 or UTF-16.
+        TranscodeOut,
+
+        //! The whole call.
+        Total
+    };
+
+
+    //! The latencies of a Phase in nanoseconds, within 1/32 of the real values.
+    struct LatencyStatistics
+    {
+        //! The number of the latencies recorded.
+        std::uint64_t _count;
+
+        //! The median.
+        std::uint64_t _p50;
+
+        //! The 90th percentile.
+        std::uint64_t _p90;
+
+        //! The 99th percentile.
+        std::uint64_t _p99;
+
+        //! The 99.9th percentile.
+        std::uint64_t _p999;
+
+        //! The maximum.
+        std::uint64_t _max;
+    };
+
+
+    //! The number of hits of a word, see TextPurifier::setHitSketchWidth.
+    struct WordHits
+    {
+        //! The ID of the word.
+        std::size_t _wordId;
+
+        //! The estimated number of hits.
+        std::uint64_t _hits;
+    };
+
+
+    //! A matched word segment, see TextPurifier::find.
+    struct WordMatch
+    {
+        //! The start position of the word segment.
+        std::size_t _start;
+
+        //! The length of the word segment.
+        std::size_t _length;
+
+        //! The ID of the matched word.
+        std::size_t _wordId;
+    };
+
+
+    //! The runtime counters of TextPurifier, see TextPurifier::setStatisticsEnabled.
+    struct RuntimeStatistics
+    {
+        //! The number of calls to purify.
+        std::uint64_t _purifyCalls;
+
+        //! The number of calls to check.
+        std::uint64_t _checkCalls;
+
+        //! The number of calls to find.
+        std::uint64_t _findCalls;
+
+        //! The number of bytes of the UTF-8 or UTF-16 input transcoded.
+        std::uint64_t _bytes;
+
+        //! The number of characters scanned, the results taken from the cache are not scanned.
+        std::uint64_t _characters;
+
+        //! The number of dictionary transitions taken.
+        std::uint64_t _transitions;
+
+        //! The number of word segments found.
+        std::uint64_t _matches;
+
+        //! The time of transcoding between UTF-8 and wide strings in nanoseconds.
+        std::uint64_t _transcodingTime;
+
+        //! The number of times the scratch buffers grow.
+        std::uint64_t _allocations;
+    };
+
+
+    //! The estimated bytes of TextPurifier by component, see TextPurifier::memoryUsage.
+    /**
+     * The bytes include the overhead of the heap, the headers and the alignment of the blocks and
+     * the control blocks of the shared nodes, as they are estimated by the common layouts.
+     */
+    struct MemoryUsage
+    {
+        //! The nodes of the trie or the compiled words.
+        std::size_t _nodes;
+
+        //! The edges, the entries of the child maps of the trie or the edges of the compiled words.
+        std::size_t _edges;
+
+        //! The tables to find the edges by character: the labels, the dense tables and the chains.
+        std::size_t _tables;
+
+        //! The word IDs, the counters of the statistics and the hit sketch.
+        std::size_t _metadata;
+
+        //! The result cache.
+        std::size_t _cache;
+
+        //! The sum of all the above.
+        std::size_t _total;
+    };
+
+
+    //! The reusable scratch buffers for purifying and checking.
+    /**
+     * Create one ScanContext for each worker thread and pass it to the purify and check functions
+     * of TextPurifier. All the temporary buffers are taken from the ScanContext and recycled
+     * between calls, so nothing is allocated once the buffers have grown to the size of the
+     * longest input. A ScanContext must not be shared between threads.
+     */
+    class ScanContext final
+    {
+    public:
+        //! Default constructor.
+        ScanContext();
+
+        //! Destructor.
+        ~ScanContext();
+
+        //! Deleted copy constructor.
+        ScanContext(const ScanContext&) = delete;
+
+        //! Deleted assignment operator.
+        ScanContext& operator=(const ScanContext&) = delete;
+
+    public:
+        //! To release the memory held by the buffers.
+        void clear();
+
+        //! The estimated bytes of the buffers, the overhead of the heap included.
+        /**
+         * @return The number of bytes.
+         */
+        std::size_t memoryUsage() const;
+
+        //! Whether the last purify with the ScanContext found any word.
+        /**
+         * A clean text may still differ from its result, e.g. the invalid UTF-8 is replaced.
+         * @return \c true if any word segment is masked.
+         */
+        bool isFound() const;
+
+    private:
+        friend class TextPurifier;
+
+        //! The scratch buffers.
+        std::unique_ptr<ScanBuffer> _buffer;
+    };
+
+
+    //! How the word segments are masked, prepared once and reused by the purify functions.
+    /**
+     * The masks are converted to wide, UTF-8 and UTF-16 strings when the policy is made, so a
+     * purify call writes them into the output in its own encoding, without converting any mask.
+     * Overlapped word segments are merged into the same masked span, which is masked as the
+     * first of them. A MaskPolicy can be shared between threads.
+     */
+    class MaskPolicy final
+    {
+    public:
+        //! The callback to write the mask of a masked span.
+        /**
+         * @param [in]  context The user context given to the MaskPolicy.
+         * @param [in]  wordId  The ID of the word of the first word segment of the span.
+         * @param [in]  length  The number of characters of the span.
+         * @param [out] mask    The mask to replace the span with, empty when it is called.
+         */
+        typedef void (*MaskCallback)(void* context,
+                                     std::size_t wordId,
+                                     std::size_t length,
+                                     std::wstring& mask);
+
+    public:
+        //! Constructor of a fixed mask, which replaces each span.
+        /**
+         * @param [in] mask The std::wstring mask.
+         */
+        explicit MaskPolicy(const std::wstring& mask);
+
+        /**
+         * @overload
+         * @param [in] mask The UTF-8 std::string mask.
+         */
+        explicit MaskPolicy(const std::string& mask);
+
+        /**
+         * @overload
+         * @param [in] mask The UTF-16 std::u16string mask.
+         */
+        explicit MaskPolicy(const std::u16string& mask);
+
+        //! Constructor of a character repeated for each character of a span.
+        /**
+         * @param [in] mask The character.
+         */
+        explicit MaskPolicy(wchar_t mask);
+
+        //! Constructor of a mask for each category of the words.
+        /**
+         * @param [in] categories  The category of each word ID, the words beyond it are of the
+         *                         category 0.
+         * @param [in] masks       The mask of each category, a category without mask is masked
+         *                         by the mask of the category 0.
+         * @param [in] isMatchSize If isMatchSize is \c true, the first character of the mask will
+         *                         be repeated until the same size with the purified word.
+         */
+        MaskPolicy(const std::vector<std::size_t>& categories,
+                   const std::vector<std::wstring>& masks,
+                   bool isMatchSize);
+
+        //! Constructor of a mask written by a callback for each span.
+        /**
+         * @param [in] callback The MaskCallback.
+         * @param [in] context  The user context passed to the callback.
+         */
+        MaskPolicy(MaskCallback callback, void* context);
+
+        //! Destructor.
+        ~MaskPolicy();
+
+        //! Deleted copy constructor.
+        MaskPolicy(const MaskPolicy&) = delete;
+
+        //! Deleted assignment operator.
+        MaskPolicy& operator=(const MaskPolicy&) = delete;
+
+    private:
+        friend class TextPurifier;
+
+        //! The prepared masks.
+        std::unique_ptr<MaskTable> _table;
+    };
 
 
     //! To purify text by given list of strings.
     class TextPurifier final
     {
+    public:
+        //! The callback to receive a matched word segment.
+        /**
+         * @param [in] context The user context given to TextPurifier::find.
+         * @param [in] start   The start position of the word segment.
+         * @param [in] length  The length of the word segment.
+         * @param [in] wordId  The ID of the matched word.
+         * @return             \c false to stop the scan.
+         */
+        typedef bool (*MatchCallback)(void* context,
+                                      std::size_t start,
+                                      std::size_t length,
+                                      std::size_t wordId);
+
+        //! The callback to receive the time of a Phase of a call.
+        /**
+         * The times are in nanoseconds of a monotonic clock with an arbitrary origin.
+         * @param [in] context The user context given to TextPurifier::setTraceCallback.
+         * @param [in] phase   The Phase.
+         * @param [in] start   The time the phase starts.
+         * @param [in] end     The time the phase ends.
+         */
+        typedef void (*TraceCallback)(void* context,
+                                      Phase phase,
+                                      std::uint64_t start,
+                                      std::uint64_t end);
+
     public:
         //! Default constructor.
         TextPurifier();
@@ -80,9 +405,175 @@ namespace lakoo
         TextPurifier& operator=(const TextPurifier&) = delete;
 
     public:
+        //! To set the semantics of reporting the matched word segments.
+        /**
+         * The default is MatchMode::All.
+         * @param [in] mode The MatchMode.
+         */
+        void setMatchMode(MatchMode mode);
+
+        //! The semantics of reporting the matched word segments.
+        /**
+         * @return The MatchMode.
+         */
+        MatchMode matchMode() const;
+
+        //! To set whether the words of alphabetic scripts must match on word boundaries.
+        /**
+         * If it is \c true, a word which starts (ends) with a letter or a digit of alphabetic
+         * scripts such as Latin, Greek or Cyrillic only matches if it is not preceded (followed) by
+         * another such character, so that "ass" no longer matches "class". Words in CJK are still
+         * matched as substrings. The default is \c false.
+         * @param [in] isWordBoundary Whether to match on word boundaries.
+         */
+        void setWordBoundary(bool isWordBoundary);
+
+        //! Whether the words of alphabetic scripts must match on word boundaries.
+        /**
+         * @return Whether to match on word boundaries.
+         */
+        bool isWordBoundary() const;
+
+        //! To set the maximum number of characters a gap in patterns can match.
+        /**
+         * The default is 3.
+         * @param [in] maxGap The maximum number of characters.
+         * @sa TextPurifier::addPattern
+         */
+        void setMaxGap(std::size_t maxGap);
+
+        //! The maximum number of characters a gap in patterns can match.
+        /**
+         * @return The maximum number of characters.
+         */
+        std::size_t maxGap() const;
+
+        //! To set the maximum edit distance of approximate matching.
+        /**
+         * If it is larger than 0, a word also matches the text within the given Levenshtein
+         * distance, e.g. "fuck" matches "fvck" and "色情圖片" matches "色請圖片" with the distance
+         * 1. The first character of a word must still match exactly, and a word of \c n
+         * characters tolerates at most <tt>(n - 1) / 2</tt> edits, so that short words do not
+         * match everything. Among the matches from a position, the one with the least edits is
+         * reported. The gaps of patterns are not followed in approximate matching. The default
+         * is 0, exact matching.
+         * @param [in] maxDistance The maximum edit distance.
+         */
+        void setMaxDistance(std::size_t maxDistance);
+
+        //! The maximum edit distance of approximate matching.
+        /**
+         * @return The maximum edit distance.
+         */
+        std::size_t maxDistance() const;
+
+        //! To set the maximum number of results in the cache.
+        /**
+         * The cache keeps the results of checking and purifying the strings up to 256
+         * characters, so that the strings repeated in chat, e.g. "gg" or spam waves, are not
+         * scanned again. The results are keyed on the string and the mask, and they are dropped
+         * once the words or options are changed. It is safe to use from multiple threads. The
+         * counters and the results are cleared. The default is 0, no cache.
+         * @param [in] size The maximum number of results, 0 to disable the cache.
+         */
+        void setCacheSize(std::size_t size);
+
+        //! The maximum number of results in the cache.
+        /**
+         * @return The maximum number of results.
+         */
+        std::size_t cacheSize() const;
+
+        //! The counters of the cache, to size it.
+        /**
+         * @return The CacheStatistics.
+         */
+        CacheStatistics cacheStatistics() const;
+
+        //! To enable or disable the runtime counters.
+        /**
+         * The counters are only available if the library is configured with
+         * --enable-statistics, otherwise they are compiled out and this is ignored. The counters
+         * are shared by all threads. The default is disabled.
+         * @param [in] isEnabled Whether to enable the counters.
+         */
+        void setStatisticsEnabled(bool isEnabled);
+
+        //! Whether the runtime counters are enabled.
+        /**
+         * @return Whether the counters are enabled, always \c false if they are compiled out.
+         */
+        bool isStatisticsEnabled() const;
+
+        //! The snapshot of the runtime counters.
+        /**
+         * @return The RuntimeStatistics.
+         */
+        RuntimeStatistics statistics() const;
+
+        //! To reset the runtime counters and the latencies to 0.
+        void resetStatistics();
+
+        //! The latencies of a Phase while the runtime counters are enabled.
+        /**
+         * The phases are timed by the time stamp counter where it is available, the latencies are
+         * recorded into the histograms of each thread and summed up here. The phases of a call
+         * taking the result from the cache are not recorded, except TranscodeIn, TranscodeOut and
+         * Total.
+         * @param [in] phase The Phase.
+         * @return           The LatencyStatistics, all 0 if the counters are compiled out.
+         */
+        LatencyStatistics latencyStatistics(Phase phase) const;
+
+        //! To set the callback to receive the time of every Phase of every call.
+        /**
+         * The callback is called from the thread of the call once the phase ends, whether the
+         * runtime counters are enabled or not. It is ignored if the counters are compiled out.
+         * It must not be changed while other threads are purifying or checking.
+         * @param [in] callback The callback, nullptr to stop tracing.
+         * @param [in] context  The user context passed to the callback.
+         */
+        void setTraceCallback(TraceCallback callback, void* context);
+
+        //! To set the size of the sketch counting the hits of each word.
+        /**
+         * Every word segment found by purify, check and find is counted into a count-min sketch
+         * of 4 rows of the given width, rounded up to a power of 2, so the memory is fixed to
+         * 256 bytes per column whatever the number of words, e.g. 1 MB for the width of 4096.
+         * The estimates are never less than the real numbers and the error is small if the
+         * width is large compared with the number of words hit. A counter stops at 2^32 - 1
+         * hits of a copy instead of wrapping. Each of the first 16 threads counts into its own
+         * copy of the sketch, so the threads do not contend. A result taken from the cache
+         * counts the words its scan found again. The counters are cleared. The default is 0, no
+         * counting.
+         * @param [in] width The number of counters in a row, 0 to disable the sketch.
+         */
+        void setHitSketchWidth(std::size_t width);
+
+        //! The number of counters in a row of the sketch.
+        /**
+         * @return The width, 0 if the sketch is disabled.
+         */
+        std::size_t hitSketchWidth() const;
+
+        //! The estimated number of hits of a word.
+        /**
+         * @param [in] wordId The ID of the word, the order which the word is first added.
+         * @return            The estimated number of hits, 0 if the sketch is disabled.
+         */
+        std::uint64_t wordHits(std::size_t wordId) const;
+
+        //! The words of the most hits.
+        /**
+         * @param [in] count The maximum number of words to return.
+         * @return           The words with hits, in descending order of the hits.
+         */
+        std::vector<WordHits> topWords(std::size_t count) const;
+
         //! To add a word to the list to purify.
         /**
          * @param [in] str The std::wstring to add.
+         * @throw std::bad_alloc The words would exceed the memory budget.
          */
         void add(const std::wstring& str);
 
@@ -130,6 +621,240 @@ namespace lakoo
          */
         void add(const char* const* list, std::size_t count);
 
+        //! To add the words of a word file to the list to purify.
+        /**
+         * It is the fast way to load a large list: the file has one word per line in UTF-8, the
+         * words are normalized, deduplicated and sorted by multiple threads, then compiled with
+         * the words already added in one pass, as TextPurifier::compile. The new words get their
+         * IDs in the order of their first lines.
+         * @param [in] path The path of the word file.
+         * @return          \c false if the file cannot be read.
+         */
+        bool addFile(const std::string& path);
+
+        /**
+         * @overload
+         * @param [in] path        The path of the word file.
+         * @param [in] threadCount The number of threads, 0 to use the number of cores.
+         */
+        bool addFile(const std::string& path, std::size_t threadCount);
+
+        //! To add the words of the content of a word file to the list to purify.
+        /**
+         * @param [in] data The content with one word per line in UTF-8.
+         * @param [in] size The number of bytes of the content.
+         * @throw std::bad_alloc The words would exceed the memory budget.
+         * @sa TextPurifier::addFile
+         */
+        void addWords(const char* data, std::size_t size);
+
+        /**
+         * @overload
+         * @param [in] data        The content with one word per line in UTF-8.
+         * @param [in] size        The number of bytes of the content.
+         * @param [in] threadCount The number of threads, 0 to use the number of cores.
+         */
+        void addWords(const char* data, std::size_t size, std::size_t threadCount);
+
+        //! To add a pattern to the list to purify.
+        /**
+         * In a pattern, \c ? matches any single character and \c * matches up to maxGap()
+         * arbitrary characters, e.g. "b*u*y" matches "b_u_y" and "粗*口" matches "粗xx口". Spaces
+         * in the text are skipped as usual. The wildcards are compiled into the same trie as the
+         * words, the cost of scanning does not grow with the number of texts a pattern can match.
+         * A pattern without any other character is ignored.
+         * @param [in] str The std::wstring pattern to add.
+         */
+        void addPattern(const std::wstring& str);
+
+        /**
+         * @overload
+         * @param [in] str The std::string pattern to add.
+         */
+        void addPattern(const std::string& str);
+
+        /**
+         * @overload
+         * @param [in] str The wchar_t string pattern to add.
+         */
+        void addPattern(const wchar_t* str);
+
+        /**
+         * @overload
+         * @param [in] str The char string pattern to add.
+         */
+        void addPattern(const char* str);
+
+        //! To compile the words into a minimal automaton.
+        /**
+         * The words and patterns added so far are compiled into an automaton sharing both the
+         * prefixes and the suffixes, e.g. the words ending with "ing" share the nodes of "ing",
+         * which takes much less memory than the trie for a large list. The results and word IDs
+         * are the same as before. Adding a word afterwards restores the trie, so compile again
+         * after all words are added.
+         * @throw std::bad_alloc The compiled words would exceed the memory budget.
+         */
+        void compile();
+
+        //! Whether the words are compiled.
+        /**
+         * @return Whether the words are compiled.
+         * @sa TextPurifier::compile
+         */
+        bool isCompiled() const;
+
+        //! The number of nodes of the dictionary, including the root.
+        /**
+         * @return The number of nodes of the trie, or the compiled automaton.
+         * @sa TextPurifier::compile
+         */
+        std::size_t nodeCount() const;
+
+        //! The estimated bytes of the memory by component.
+        /**
+         * The words count once for each copy on the NUMA nodes, the words of a base purifier
+         * count for the base only. The scratch buffers are counted by ScanContext::memoryUsage.
+         * @return The MemoryUsage.
+         */
+        MemoryUsage memoryUsage() const;
+
+        //! To set the maximum bytes of the words, the trie or the compiled automaton.
+        /**
+         * The words which would take more than the budget are rejected before they are added,
+         * compiled, loaded, laid out or copied to the NUMA nodes, and the words already added are
+         * not changed. So a large list fails cleanly instead of running the host out of memory.
+         * Setting a budget below the current bytes does not release anything, it only rejects
+         * the next change. The default is 0, no budget.
+         * @param [in] bytes The maximum number of bytes, 0 for no budget.
+         * @sa TextPurifier::memoryUsage
+         */
+        void setMemoryBudget(std::size_t bytes);
+
+        //! The maximum bytes of the words.
+        /**
+         * @return The maximum number of bytes, 0 for no budget.
+         */
+        std::size_t memoryBudget() const;
+
+        //! To scan the words of a shared base purifier together with the words of this one.
+        /**
+         * It is for many purifiers sharing a large list, each with a few words of its own: the
+         * compiled automaton of the base is shared instead of copied, and the text is scanned
+         * once for the words of both, e.g. a global list of 300k words as the base of a purifier
+         * per game server. The words of this purifier can still be added or compiled on their own,
+         * and the options of this purifier apply. The word IDs of the base are kept and the word
+         * IDs of this purifier follow them. Later changes to the base do not affect this purifier
+         * until the base is set again, and the base of the base is not included.
+         * @param [in] base The base TextPurifier, it must be compiled.
+         * @return          \c false if the base is not compiled, the base is not changed.
+         * @sa TextPurifier::compile
+         */
+        bool setBase(const TextPurifier& base);
+
+        //! To scan the words of this purifier only.
+        void clearBase();
+
+        //! Whether there is a base purifier.
+        /**
+         * @return Whether there is a base purifier.
+         */
+        bool hasBase() const;
+
+        //! To count how often each node of the compiled words is visited when scanning a text.
+        /**
+         * The counts of sample text of production give TextPurifier::orderNodes the hot paths of
+         * the dictionary. The counts can be added up over many texts, and kept to order the
+         * nodes of the same compiled words later. The words of a base purifier are not counted.
+         * @param [in]     text   The UTF-8 sample text.
+         * @param [in,out] visits The count of each node to add to, reset first if it does not
+         *                        have a count per node.
+         * @return                \c false if the words are not compiled.
+         * @sa TextPurifier::compile
+         */
+        bool recordVisits(const std::string& text, std::vector<std::uint64_t>& visits) const;
+
+        //! To lay out the nodes of the compiled words by how often they are visited.
+        /**
+         * A scan spends most of its time in a few hot nodes, the root, the common first
+         * characters and the frequent prefixes, but the nodes are laid out in the order of the
+         * words. The most visited nodes are packed first, so they share a few cache lines and
+         * pages. The results of scanning are not changed, and the layout is kept in the image.
+         * @param [in] visits The counts of each node by TextPurifier::recordVisits, on the
+         *                    current layout.
+         * @return            \c false if the words are not compiled or the counts are not of the
+         *                    current nodes.
+         */
+        bool orderNodes(const std::vector<std::uint64_t>& visits);
+
+        /**
+         * @overload
+         * @param [in] samples The UTF-8 sample texts to count the visits by.
+         * @return             \c false if the words are not compiled or there is no sample.
+         */
+        bool orderNodes(const std::list<std::string>& samples);
+
+        //! To set whether the compiled words are placed on huge pages.
+        /**
+         * A scan walks the compiled automaton at random, so with a large list most of its time
+         * goes to the misses of the TLB on normal pages. The huge pages are taken from the pool
+         * reserved by vm.nr_hugepages first, then from transparent huge pages, and normal pages
+         * are kept if neither is available. It is off by default, and it has no effect until the
+         * words are compiled.
+         * @param [in] isHugePage Whether to use huge pages.
+         * @sa TextPurifier::compile
+         */
+        void setHugePage(bool isHugePage);
+
+        //! Whether the compiled words are placed on huge pages.
+        /**
+         * @return Whether to use huge pages.
+         */
+        bool isHugePage() const;
+
+        //! To set whether the compiled words are copied to each NUMA node.
+        /**
+         * Each scan reads the copy on the NUMA node of the core it runs on, instead of the memory
+         * of a remote node, at the cost of a copy per node. It is off by default, and it has no
+         * effect on a host of a single node or until the words are compiled. A base purifier
+         * is read as it is placed by itself.
+         * @param [in] isNumaReplicated Whether to copy to each NUMA node.
+         * @sa TextPurifier::compile
+         * @sa TextPurifier::setBase
+         */
+        void setNumaReplicated(bool isNumaReplicated);
+
+        //! Whether the compiled words are copied to each NUMA node.
+        /**
+         * @return Whether to copy to each NUMA node.
+         */
+        bool isNumaReplicated() const;
+
+        //! To save the compiled words to a file, to load them later without building them.
+        /**
+         * The image keeps the words, their IDs and the patterns, but not the options such as
+         * the MatchMode. It can only be loaded on hosts of the same byte order.
+         * @param [in] path The path of the image file.
+         * @return          \c false if the file cannot be written.
+         */
+        bool saveImage(const std::string& path) const;
+
+        //! To replace all the words by an image saved by saveImage.
+        /**
+         * The image is validated before it is used.
+         * @param [in] path The path of the image file.
+         * @return          \c false if the file cannot be read or is not a valid image, the
+         *                  words are not changed.
+         * @throw std::bad_alloc The words of the image would exceed the memory budget.
+         */
+        bool loadImage(const std::string& path);
+
+        /**
+         * @overload
+         * @param [in] data The content of the image file.
+         * @param [in] size The number of bytes of the content.
+         */
+        bool loadImage(const char* data, std::size_t size);
+
         //! To purify the string with given mask.
         /**
          * @param [in,out] str  The std::wstring to purify.
@@ -224,6 +949,23 @@ namespace lakoo
          */
         std::string& purify(std::string& str, char mask, bool isMatchSize) const;
 
+        /**
+         * @overload
+         * A surrogate pair is one character to the words and the mask, a lone surrogate is kept.
+         * @param [in] str  The UTF-16 std::u16string to purify.
+         * @param [in] mask The UTF-16 std::u16string mask.
+         */
+        std::u16string purify(const std::u16string& str, const std::u16string& mask) const;
+
+        /**
+         * @overload
+         * @param [in] str         The UTF-16 std::u16string to purify.
+         * @param [in] mask        The char16_t mask.
+         * @param [in] isMatchSize If isMatchSize is \c true, the mask will be repeated until the
+         *                         same size with the purified word.
+         */
+        std::u16string purify(const std::u16string& str, char16_t mask, bool isMatchSize) const;
+
         //! To purify the string with given mask.
         /**
          * @param [in] str  The wchar_t string to purify.
@@ -272,6 +1014,224 @@ namespace lakoo
          */
         void freePurifiedString(const char* str) const;
 
+        //! To purify the string with given mask by the scratch buffers of a ScanContext.
+        /**
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The std::wstring to purify.
+         * @param [in]     mask    The std::wstring mask.
+         * @return                 The purified string, it is owned by the context and valid until
+         *                         the context is used again.
+         */
+        const std::wstring& purify(ScanContext& context,
+                                   const std::wstring& str,
+                                   const std::wstring& mask) const;
+
+        /**
+         * @overload
+         * @param [in,out] context     The ScanContext which provides the buffers.
+         * @param [in]     str         The std::wstring to purify.
+         * @param [in]     mask        The wchar_t mask.
+         * @param [in]     isMatchSize If isMatchSize is \c true, the mask will be repeated until
+         *                             the same size with the purified word.
+         */
+        const std::wstring& purify(ScanContext& context,
+                                   const std::wstring& str,
+                                   wchar_t mask,
+                                   bool isMatchSize) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The std::string to purify.
+         * @param [in]     mask    The std::string mask.
+         */
+        const std::string& purify(ScanContext& context,
+                                  const std::string& str,
+                                  const std::string& mask) const;
+
+        /**
+         * @overload
+         * @param [in,out] context     The ScanContext which provides the buffers.
+         * @param [in]     str         The std::string to purify.
+         * @param [in]     mask        The char mask.
+         * @param [in]     isMatchSize If isMatchSize is \c true, the mask will be repeated until
+         *                             the same size with the purified word.
+         */
+        const std::string& purify(ScanContext& context,
+                                  const std::string& str,
+                                  char mask,
+                                  bool isMatchSize) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The wchar_t string to purify.
+         * @param [in]     mask    The wchar_t string mask.
+         */
+        const wchar_t* purify(ScanContext& context, const wchar_t* str, const wchar_t* mask) const;
+
+        /**
+         * @overload
+         * @param [in,out] context     The ScanContext which provides the buffers.
+         * @param [in]     str         The wchar_t string to purify.
+         * @param [in]     mask        The wchar_t mask.
+         * @param [in]     isMatchSize If isMatchSize is \c true, the mask will be repeated until
+         *                             the same size with the purified word.
+         */
+        const wchar_t* purify(ScanContext& context,
+                              const wchar_t* str,
+                              wchar_t mask,
+                              bool isMatchSize) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The char string to purify.
+         * @param [in]     mask    The char string mask.
+         */
+        const char* purify(ScanContext& context, const char* str, const char* mask) const;
+
+        /**
+         * @overload
+         * @param [in,out] context     The ScanContext which provides the buffers.
+         * @param [in]     str         The char string to purify.
+         * @param [in]     mask        The char mask.
+         * @param [in]     isMatchSize If isMatchSize is \c true, the mask will be repeated until
+         *                             the same size with the purified word.
+         */
+        const char* purify(ScanContext& context, const char* str, char mask, bool isMatchSize) const;
+
+        /**
+         * @overload
+         * The UTF-8 string does not need to be terminated by \c NUL, nothing is allocated once the
+         * buffers of the ScanContext are large enough.
+         * @param [in,out] context  The ScanContext which provides the buffers.
+         * @param [in]     str      The UTF-8 string to purify.
+         * @param [in]     size     The number of bytes of the string.
+         * @param [in]     mask     The UTF-8 mask.
+         * @param [in]     maskSize The number of bytes of the mask.
+         */
+        const std::string& purify(ScanContext& context,
+                                  const char* str,
+                                  std::size_t size,
+                                  const char* mask,
+                                  std::size_t maskSize) const;
+
+        /**
+         * @overload
+         * @param [in,out] context     The ScanContext which provides the buffers.
+         * @param [in]     str         The UTF-8 string to purify.
+         * @param [in]     size        The number of bytes of the string.
+         * @param [in]     mask        The char mask.
+         * @param [in]     isMatchSize If isMatchSize is \c true, the mask will be repeated until
+         *                             the same size with the purified word.
+         */
+        const std::string& purify(ScanContext& context,
+                                  const char* str,
+                                  std::size_t size,
+                                  char mask,
+                                  bool isMatchSize) const;
+
+        /**
+         * @overload
+         * The UTF-16 string does not need to be terminated by \c NUL, nothing is allocated once
+         * the buffers of the ScanContext are large enough.
+         * @param [in,out] context  The ScanContext which provides the buffers.
+         * @param [in]     str      The UTF-16 string to purify.
+         * @param [in]     size     The number of code units of the string.
+         * @param [in]     mask     The UTF-16 mask.
+         * @param [in]     maskSize The number of code units of the mask.
+         */
+        const std::u16string& purify(ScanContext& context,
+                                     const char16_t* str,
+                                     std::size_t size,
+                                     const char16_t* mask,
+                                     std::size_t maskSize) const;
+
+        /**
+         * @overload
+         * @param [in,out] context     The ScanContext which provides the buffers.
+         * @param [in]     str         The UTF-16 string to purify.
+         * @param [in]     size        The number of code units of the string.
+         * @param [in]     mask        The char16_t mask.
+         * @param [in]     isMatchSize If isMatchSize is \c true, the mask will be repeated until
+         *                             the same size with the purified word.
+         */
+        const std::u16string& purify(ScanContext& context,
+                                     const char16_t* str,
+                                     std::size_t size,
+                                     char16_t mask,
+                                     bool isMatchSize) const;
+
+        //! To purify the string by a MaskPolicy.
+        /**
+         * The masks of the policy are already in the encoding of the output, so they are
+         * written into it as they are. Without the result cache, the purified string is also
+         * written straight into the output instead of being transcoded as a whole.
+         * @param [in] str    The std::wstring to purify.
+         * @param [in] policy The MaskPolicy.
+         * @return            The purified string.
+         */
+        std::wstring purify(const std::wstring& str, const MaskPolicy& policy) const;
+
+        /**
+         * @overload
+         * @param [in] str    The UTF-8 std::string to purify.
+         * @param [in] policy The MaskPolicy.
+         */
+        std::string purify(const std::string& str, const MaskPolicy& policy) const;
+
+        /**
+         * @overload
+         * @param [in] str    The UTF-16 std::u16string to purify.
+         * @param [in] policy The MaskPolicy.
+         */
+        std::u16string purify(const std::u16string& str, const MaskPolicy& policy) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The std::wstring to purify.
+         * @param [in]     policy  The MaskPolicy.
+         */
+        const std::wstring& purify(ScanContext& context,
+                                   const std::wstring& str,
+                                   const MaskPolicy& policy) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The UTF-8 std::string to purify.
+         * @param [in]     policy  The MaskPolicy.
+         */
+        const std::string& purify(ScanContext& context,
+                                  const std::string& str,
+                                  const MaskPolicy& policy) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The UTF-8 string to purify.
+         * @param [in]     size    The number of bytes of the string.
+         * @param [in]     policy  The MaskPolicy.
+         */
+        const std::string& purify(ScanContext& context,
+                                  const char* str,
+                                  std::size_t size,
+                                  const MaskPolicy& policy) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The UTF-16 string to purify.
+         * @param [in]     size    The number of code units of the string.
+         * @param [in]     policy  The MaskPolicy.
+         */
+        const std::u16string& purify(ScanContext& context,
+                                     const char16_t* str,
+                                     std::size_t size,
+                                     const MaskPolicy& policy) const;
+
         //! Check whether the given string need to be purified.
         /**
          * @param [in] str The std::wstring to check.
@@ -297,9 +1257,216 @@ namespace lakoo
          */
         bool check(const char* str) const;
 
+        /**
+         * @overload
+         * @param [in] str The UTF-16 std::u16string to check.
+         */
+        bool check(const std::u16string& str) const;
+
+        //! Check whether the given string need to be purified by the scratch buffers of a ScanContext.
+        /**
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The std::wstring to check.
+         * @return                 Whether the given string need to be purified.
+         */
+        bool check(ScanContext& context, const std::wstring& str) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The std::string to check.
+         */
+        bool check(ScanContext& context, const std::string& str) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The wchar_t string to check.
+         */
+        bool check(ScanContext& context, const wchar_t* str) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The char string to check.
+         */
+        bool check(ScanContext& context, const char* str) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The UTF-8 string to check, not necessarily terminated by \c NUL.
+         * @param [in]     size    The number of bytes of the string.
+         */
+        bool check(ScanContext& context, const char* str, std::size_t size) const;
+
+        /**
+         * @overload
+         * @param [in,out] context The ScanContext which provides the buffers.
+         * @param [in]     str     The UTF-16 string to check, not necessarily terminated by \c NUL.
+         * @param [in]     size    The number of code units of the string.
+         */
+        bool check(ScanContext& context, const char16_t* str, std::size_t size) const;
+
+        //! To visit all matched word segments without building any container.
+        /**
+         * The word segments are reported in the order of their start positions, the word ID is the
+         * order which the word is first added, starting from 0. The scan hands the segments over
+         * in small batches on the stack, so the visitor is inlined into the loop over a batch
+         * instead of being called through a pointer for each segment.
+         * @param [in] str     The std::wstring to check.
+         * @param [in] visitor The callable with signature
+         *                     <tt>bool(std::size_t start, std::size_t length, std::size_t wordId)</tt>,
+         *                     returns \c false to stop the scan.
+         * @return             \c false if the scan is stopped by the visitor.
+         */
+        template <typename _Visitor>
+        bool find(const std::wstring& str, _Visitor&& visitor) const
+        {
+            return findBatches(
+                str,
+                &TextPurifier::visitBatch<typename std::remove_reference<_Visitor>::type>,
+                const_cast<void*>(static_cast<const void*>(&visitor)));
+        }
+
+        /**
+         * @overload
+         * @param [in] str      The std::wstring to check.
+         * @param [in] callback The callback to receive the matched word segments.
+         * @param [in] context  The user context passed to the callback.
+         */
+        bool find(const std::wstring& str, MatchCallback callback, void* context) const;
+
+        /**
+         * @overload
+         * The start positions and lengths are in UTF-16 code units, a surrogate pair counts 2.
+         * @param [in] str     The UTF-16 std::u16string to check.
+         * @param [in] visitor The callable with signature
+         *                     <tt>bool(std::size_t start, std::size_t length, std::size_t wordId)</tt>,
+         *                     returns \c false to stop the scan.
+         */
+        template <typename _Visitor>
+        bool find(const std::u16string& str, _Visitor&& visitor) const
+        {
+            return findBatches(
+                str,
+                &TextPurifier::visitBatch<typename std::remove_reference<_Visitor>::type>,
+                const_cast<void*>(static_cast<const void*>(&visitor)));
+        }
+
+        /**
+         * @overload
+         * @param [in] str      The UTF-16 std::u16string to check.
+         * @param [in] callback The callback to receive the matched word segments.
+         * @param [in] context  The user context passed to the callback.
+         */
+        bool find(const std::u16string& str, MatchCallback callback, void* context) const;
+
+    private:
+        //! The callback to receive a batch of matched word segments.
+        /**
+         * @param [in]     context The user context given to findBatches.
+         * @param [in]     matches The word segments.
+         * @param [in,out] count   The number of word segments, set to the number visited.
+         * @return                 \c false to stop the scan.
+         */
+        typedef bool (*MatchBatchCallback)(void* context,
+                                           const WordMatch* matches,
+                                           std::size_t& count);
+
+        //! To scan a string and hand the matched word segments over in batches.
+        /**
+         * @param [in] str      The std::wstring to check.
+         * @param [in] callback The callback to receive the batches.
+         * @param [in] context  The user context passed to the callback.
+         * @return              \c false if the scan is stopped by the callback.
+         */
+        bool findBatches(const std::wstring& str, MatchBatchCallback callback, void* context) const;
+
+        /**
+         * @overload
+         * @param [in] str      The UTF-16 std::u16string to check.
+         * @param [in] callback The callback to receive the batches, in UTF-16 code units.
+         * @param [in] context  The user context passed to the callback.
+         */
+        bool findBatches(const std::u16string& str,
+                         MatchBatchCallback callback,
+                         void* context) const;
+
+        //! To write the purified string into the result buffer of a ScanContext.
+        /**
+         * Overlapped word segments are merged into the same masked span.
+         * @param [in,out] buffer      The buffers of a ScanContext.
+         * @param [in]     str         The string to purify, must not be the result buffer.
+         * @param [in]     size        The length of the string.
+         * @param [in]     mask        The mask.
+         * @param [in]     maskSize    The length of the mask.
+         * @param [in]     isMatchSize If isMatchSize is \c true, the first character of the mask
+         *                             will be repeated until the same size with the purified word.
+         */
+        void rewrite(ScanBuffer& buffer,
+                     const wchar_t* str,
+                     std::size_t size,
+                     const wchar_t* mask,
+                     std::size_t maskSize,
+                     bool isMatchSize) const;
+
+        //! To write the purified string by a MaskPolicy into an output in its encoding.
+        /**
+         * The results of a single mask are taken from and kept in the cache as the results of
+         * rewrite with the mask, the others are written span by span into the output.
+         * @tparam _String The output, std::wstring, std::string or std::u16string.
+         * @param [in,out] buffer The buffers of a ScanContext.
+         * @param [in]     str    The string to purify, must not be the output.
+         * @param [in]     size   The length of the string.
+         * @param [in]     policy The MaskPolicy.
+         * @param [out]    output The purified string.
+         */
+        template <typename _String>
+        void rewrite(ScanBuffer& buffer,
+                     const wchar_t* str,
+                     std::size_t size,
+                     const MaskPolicy& policy,
+                     _String& output) const;
+
+        //! To check the string by the buffers of a ScanContext.
+        /**
+         * @param [in,out] buffer  The buffers of a ScanContext.
+         * @param [in]     str     The string to check.
+         * @param [in]     size    The length of the string.
+         * @return                 Whether the given string need to be purified.
+         */
+        bool check(ScanBuffer& buffer, const wchar_t* str, std::size_t size) const;
+
+        //! The trampoline from MatchBatchCallback to the visitor of find, called once a batch.
+        template <typename _Visitor>
+        static bool visitBatch(void* context, const WordMatch* matches, std::size_t& count)
+        {
+            _Visitor& visitor = *static_cast<_Visitor*>(context);
+            for(std::size_t index = 0; index < count; ++index)
+            {
+                if(!visitor(matches[index]._start, matches[index]._length, matches[index]._wordId))
+                {
+                    count = index + 1;
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
     private:
         //! The filter list for purifying words.
         std::unique_ptr<FilterList> _filterList;
+
+        //! The cache of the results.
+        std::unique_ptr<ResultCache> _cache;
+
+        //! The runtime counters.
+        std::unique_ptr<StatisticsCounters> _statistics;
+
+        //! The sketch of the hits of each word, nullptr if it is disabled.
+        std::unique_ptr<HitSketch> _hitSketch;
     };
 } // namespace lakoo
 
@@ -0,0 +1,300 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   text_purifier_c.h
+ * @author Aludirk Wong
+ * @date   2017-08-20
+ *
+ * The C interface of TextPurifier for the bindings of other languages.
+ *
+ * The purifiers and the scan contexts are opaque handles. The strings are UTF-8 with explicit
+ * sizes, they do not need to be terminated by \c NUL. The results are written into the buffers of
+ * the caller, and every function returns a ::textpurifier_status instead of throwing, so that
+ * nothing is allocated for a scan once the buffers of the scan context are large enough.
+ * @code
+ * textpurifier* purifier = NULL;
+ * textpurifier_context* context = NULL;
+ * textpurifier_create(&purifier);
+ * textpurifier_add_file(purifier, "words.txt");
+ * textpurifier_compile(purifier);
+ * textpurifier_context_create(&context);
+ *
+ * char output[256];
+ * size_t size = 0;
+ * textpurifier_purify(purifier, context, text, textSize, NULL, 0, output, sizeof(output), &size);
+ *
+ * textpurifier_context_destroy(context);
+ * textpurifier_destroy(purifier);
+ * @endcode
+ * A purifier can be scanned by many threads at once, each with its own scan context, but it must
+ * not be changed while it is scanned.
+ */
+
+#ifndef __LAKOO_TEXT_PURIFIER_C_H__
+#define __LAKOO_TEXT_PURIFIER_C_H__
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    //! The opaque handle of a purifier.
+    typedef struct textpurifier textpurifier;
+
+    //! The opaque handle of the scratch buffers of a thread, as lakoo::ScanContext.
+    typedef struct textpurifier_context textpurifier_context;
+
+    //! The results of the functions.
+    typedef enum textpurifier_status
+    {
+        //! Success.
+        TEXTPURIFIER_OK = 0,
+
+        //! A required pointer is \c NULL.
+        TEXTPURIFIER_INVALID_ARGUMENT = 1,
+
+        //! The output buffer is too small, the required size is given.
+        TEXTPURIFIER_BUFFER_TOO_SMALL = 2,
+
+        //! A file or an image cannot be read.
+        TEXTPURIFIER_IO_ERROR = 3,
+
+        //! The memory is exhausted.
+        TEXTPURIFIER_OUT_OF_MEMORY = 4,
+
+        //! Any other failure inside the library.
+        TEXTPURIFIER_INTERNAL_ERROR = 5
+    } textpurifier_status;
+
+    //! The description of a status.
+    /**
+     * @param [in] status The ::textpurifier_status.
+     * @return            The static string of the description.
+     */
+    const char* textpurifier_status_string(textpurifier_status status);
+
+    //! To create an empty purifier.
+    /**
+     * @param [out] purifier The new purifier, to destroy by textpurifier_destroy.
+     * @return               The ::textpurifier_status.
+     */
+    textpurifier_status textpurifier_create(textpurifier** purifier);
+
+    //! To destroy a purifier.
+    /**
+     * @param [in] purifier The purifier, \c NULL is ignored.
+     */
+    void textpurifier_destroy(textpurifier* purifier);
+
+    //! To set whether the words of alphabetic scripts must match on word boundaries.
+    /**
+     * @param [in,out] purifier       The purifier.
+     * @param [in]     isWordBoundary Non-zero to match on word boundaries.
+     * @return                        The ::textpurifier_status.
+     * @sa lakoo::TextPurifier::setWordBoundary
+     */
+    textpurifier_status textpurifier_set_word_boundary(textpurifier* purifier, int isWordBoundary);
+
+    //! To set the maximum bytes of the words.
+    /**
+     * The changes of the words beyond it fail with ::TEXTPURIFIER_OUT_OF_MEMORY.
+     * @param [in,out] purifier The purifier.
+     * @param [in]     bytes    The maximum number of bytes, 0 for no budget.
+     * @return                  The ::textpurifier_status.
+     * @sa lakoo::TextPurifier::setMemoryBudget
+     */
+    textpurifier_status textpurifier_set_memory_budget(textpurifier* purifier, size_t bytes);
+
+    //! To add a word.
+    /**
+     * @param [in,out] purifier The purifier.
+     * @param [in]     word     The UTF-8 word.
+     * @param [in]     size     The number of bytes of the word.
+     * @return                  The ::textpurifier_status.
+     */
+    textpurifier_status textpurifier_add(textpurifier* purifier, const char* word, size_t size);
+
+    //! To add a pattern.
+    /**
+     * @param [in,out] purifier The purifier.
+     * @param [in]     pattern  The UTF-8 pattern.
+     * @param [in]     size     The number of bytes of the pattern.
+     * @return                  The ::textpurifier_status.
+     * @sa lakoo::TextPurifier::addPattern
+     */
+    textpurifier_status textpurifier_add_pattern(textpurifier* purifier,
+                                                 const char* pattern,
+                                                 size_t size);
+
+    //! To add the words of the content of a word file, one word per line.
+    /**
+     * @param [in,out] purifier The purifier.
+     * @param [in]     data     The UTF-8 content.
+     * @param [in]     size     The number of bytes of the content.
+     * @return                  The ::textpurifier_status.
+     * @sa lakoo::TextPurifier::addWords
+     */
+    textpurifier_status textpurifier_add_words(textpurifier* purifier,
+                                               const char* data,
+                                               size_t size);
+
+    //! To add the words of a word file, one word per line.
+    /**
+     * @param [in,out] purifier The purifier.
+     * @param [in]     path     The path of the word file.
+     * @return                  The ::textpurifier_status.
+     * @sa lakoo::TextPurifier::addFile
+     */
+    textpurifier_status textpurifier_add_file(textpurifier* purifier, const char* path);
+
+    //! To compile the words into a minimal automaton.
+    /**
+     * @param [in,out] purifier The purifier.
+     * @return                  The ::textpurifier_status.
+     * @sa lakoo::TextPurifier::compile
+     */
+    textpurifier_status textpurifier_compile(textpurifier* purifier);
+
+    //! To replace all the words by an image file.
+    /**
+     * @param [in,out] purifier The purifier.
+     * @param [in]     path     The path of the image.
+     * @return                  The ::textpurifier_status.
+     * @sa lakoo::TextPurifier::loadImage
+     */
+    textpurifier_status textpurifier_load_image(textpurifier* purifier, const char* path);
+
+    //! To replace all the words by an image in memory.
+    /**
+     * @param [in,out] purifier The purifier.
+     * @param [in]     data     The image.
+     * @param [in]     size     The number of bytes of the image.
+     * @return                  The ::textpurifier_status.
+     */
+    textpurifier_status textpurifier_load_image_data(textpurifier* purifier,
+                                                     const char* data,
+                                                     size_t size);
+
+    //! To create the scratch buffers for a thread.
+    /**
+     * @param [out] context The new scan context, to destroy by textpurifier_context_destroy.
+     * @return              The ::textpurifier_status.
+     */
+    textpurifier_status textpurifier_context_create(textpurifier_context** context);
+
+    //! To destroy a scan context.
+    /**
+     * @param [in] context The scan context, \c NULL is ignored.
+     */
+    void textpurifier_context_destroy(textpurifier_context* context);
+
+    //! To check whether a string needs to be purified.
+    /**
+     * @param [in]     purifier The purifier.
+     * @param [in,out] context  The scan context of the thread.
+     * @param [in]     text     The UTF-8 string.
+     * @param [in]     size     The number of bytes of the string.
+     * @param [out]    isFound  1 if the string has any word, otherwise 0.
+     * @return                  The ::textpurifier_status.
+     */
+    textpurifier_status textpurifier_check(const textpurifier* purifier,
+                                           textpurifier_context* context,
+                                           const char* text,
+                                           size_t size,
+                                           int* isFound);
+
+    //! To purify a string into the buffer of the caller.
+    /**
+     * @param [in]     purifier   The purifier.
+     * @param [in,out] context    The scan context of the thread.
+     * @param [in]     text       The UTF-8 string.
+     * @param [in]     size       The number of bytes of the string.
+     * @param [in]     mask       The UTF-8 mask of each word, \c NULL for a '*' per character.
+     * @param [in]     maskSize   The number of bytes of the mask.
+     * @param [out]    output     The buffer of the purified string, not terminated by \c NUL.
+     * @param [in]     capacity   The number of bytes of the buffer.
+     * @param [out]    outputSize The number of bytes of the purified string, also given if the
+     *                            buffer is too small and nothing is written.
+     * @return                    The ::textpurifier_status.
+     */
+    textpurifier_status textpurifier_purify(const textpurifier* purifier,
+                                            textpurifier_context* context,
+                                            const char* text,
+                                            size_t size,
+                                            const char* mask,
+                                            size_t maskSize,
+                                            char* output,
+                                            size_t capacity,
+                                            size_t* outputSize);
+
+    //! To check a batch of strings in one call.
+    /**
+     * @param [in]     purifier The purifier.
+     * @param [in,out] context  The scan context of the thread.
+     * @param [in]     texts    The UTF-8 strings.
+     * @param [in]     sizes    The number of bytes of each string.
+     * @param [in]     count    The number of strings.
+     * @param [out]    isFound  1 for each string which has any word, otherwise 0.
+     * @return                  The ::textpurifier_status.
+     */
+    textpurifier_status textpurifier_check_batch(const textpurifier* purifier,
+                                                 textpurifier_context* context,
+                                                 const char* const* texts,
+                                                 const size_t* sizes,
+                                                 size_t count,
+                                                 unsigned char* isFound);
+
+    //! To purify a batch of strings into one buffer of the caller.
+    /**
+     * The purified strings are written one after another, the i-th of them is between
+     * <tt>ends[i - 1]</tt> (0 for the first) and <tt>ends[i]</tt>. If the buffer is too small,
+     * all the strings are still scanned to give the ends, only the strings which fit are
+     * written, and the buffer of <tt>ends[count - 1]</tt> bytes is large enough.
+     * @param [in]     purifier The purifier.
+     * @param [in,out] context  The scan context of the thread.
+     * @param [in]     texts    The UTF-8 strings.
+     * @param [in]     sizes    The number of bytes of each string.
+     * @param [in]     count    The number of strings.
+     * @param [in]     mask     The UTF-8 mask of each word, \c NULL for a '*' per character.
+     * @param [in]     maskSize The number of bytes of the mask.
+     * @param [out]    output   The buffer of the purified strings.
+     * @param [in]     capacity The number of bytes of the buffer.
+     * @param [out]    ends     The end offset of each purified string in the buffer.
+     * @return                  The ::textpurifier_status.
+     */
+    textpurifier_status textpurifier_purify_batch(const textpurifier* purifier,
+                                                  textpurifier_context* context,
+                                                  const char* const* texts,
+                                                  const size_t* sizes,
+                                                  size_t count,
+                                                  const char* mask,
+                                                  size_t maskSize,
+                                                  char* output,
+                                                  size_t capacity,
+                                                  size_t* ends);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // __LAKOO_TEXT_PURIFIER_C_H__
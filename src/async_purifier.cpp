@@ -0,0 +1,357 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   async_purifier.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-21
+ */
+
+#include "async_purifier.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#include "mpmc_queue.h"
+
+
+using namespace lakoo;
+using namespace std;
+
+
+namespace
+{
+    //! The default maximum number of pending requests.
+    const size_t defaultQueueSize = 4096;
+
+    //! The maximum number of jobs a worker takes at once.
+    const size_t batchSize = 64;
+}
+
+
+//! A request in the queue with the way to complete it.
+struct AsyncPurifier::Job
+{
+    //! The request.
+    AsyncRequest _request;
+
+    //! The promise of the future, nullptr if it does not complete through a future.
+    unique_ptr<promise<AsyncResult>> _promise;
+
+    //! The callback, if it completes through a callback.
+    CompletionCallback _callback;
+
+    //! The user context of the callback.
+    void* _context;
+
+    //! The tag, if it completes into the completion queue.
+    uint64_t _tag;
+};
+
+
+AsyncPurifier::AsyncPurifier(const TextPurifier& purifier)
+: AsyncPurifier(purifier, 0, defaultQueueSize, Backpressure::Block)
+{
+}
+
+AsyncPurifier::AsyncPurifier(const TextPurifier& purifier,
+                             std::size_t threadCount,
+                             std::size_t queueSize,
+                             Backpressure backpressure)
+: _purifier(purifier)
+, _backpressure(backpressure)
+, _queue(new MpmcQueue<Job>(queueSize))
+, _pendingCount(0)
+, _idleCount(0)
+, _blockedCount(0)
+, _isStopped(false)
+, _mutex()
+, _notEmpty()
+, _notFull()
+, _completionMutex()
+, _completions()
+, _readFd(-1)
+, _writeFd(-1)
+, _workers()
+{
+#ifdef __linux__
+    _readFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    _writeFd = _readFd;
+#else
+    int fds[2];
+    if(0 == pipe(fds))
+    {
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(fds[1], F_SETFL, O_NONBLOCK);
+        _readFd = fds[0];
+        _writeFd = fds[1];
+    }
+#endif
+
+    if(0 == threadCount)
+    {
+        threadCount = max<size_t>(thread::hardware_concurrency(), 1);
+    }
+
+    for(size_t index = 0; index < threadCount; ++index)
+    {
+        _workers.emplace_back(&AsyncPurifier::work, this);
+    }
+}
+
+AsyncPurifier::~AsyncPurifier()
+{
+    {
+        lock_guard<mutex> lock(_mutex);
+        _isStopped = true;
+    }
+    _notEmpty.notify_all();
+    _notFull.notify_all();
+
+    for(thread& worker : _workers)
+    {
+        worker.join();
+    }
+
+    if(-1 != _readFd)
+    {
+        close(_readFd);
+    }
+    if(_writeFd != _readFd)
+    {
+        close(_writeFd);
+    }
+}
+
+std::future<AsyncResult> AsyncPurifier::submit(AsyncRequest request)
+{
+    Job job;
+    job._request = move(request);
+    job._callback = nullptr;
+    job._context = nullptr;
+    job._promise.reset(new promise<AsyncResult>());
+    job._tag = 0;
+
+    future<AsyncResult> result = job._promise->get_future();
+    if(!push(job))
+    {
+        job._promise->set_value(AsyncResult{AsyncStatus::Rejected, 0, false, string()});
+    }
+    return result;
+}
+
+bool AsyncPurifier::submit(AsyncRequest request, CompletionCallback callback, void* context)
+{
+    Job job;
+    job._request = move(request);
+    job._callback = callback;
+    job._context = context;
+    job._tag = 0;
+    return push(job);
+}
+
+bool AsyncPurifier::submit(AsyncRequest request, std::uint64_t tag)
+{
+    Job job;
+    job._request = move(request);
+    job._callback = nullptr;
+    job._context = nullptr;
+    job._tag = tag;
+    return push(job);
+}
+
+int AsyncPurifier::completionFd() const
+{
+    return _readFd;
+}
+
+std::size_t AsyncPurifier::poll(std::vector<AsyncResult>& results)
+{
+    // Drain the signal before the results, so a result completed meanwhile signals again.
+    if(-1 != _readFd)
+    {
+        char buffer[64];
+        while(read(_readFd, buffer, sizeof(buffer)) > 0)
+        {
+        }
+    }
+
+    lock_guard<mutex> lock(_completionMutex);
+    const size_t count = _completions.size();
+    for(AsyncResult& result : _completions)
+    {
+        results.push_back(move(result));
+    }
+    _completions.clear();
+    return count;
+}
+
+bool AsyncPurifier::push(Job& job)
+{
+    for(;;)
+    {
+        if(_isStopped)
+        {
+            return false;
+        }
+
+        // The job is counted before it is pushed, so the count never falls below the jobs in
+        // the queue when a worker pops it at once.
+        ++_pendingCount;
+        if(_queue->tryPush(job))
+        {
+            break;
+        }
+
+        --_pendingCount;
+        if(Backpressure::Reject == _backpressure)
+        {
+            return false;
+        }
+
+        // The counter is raised before checking the queue again, so either the worker freeing
+        // a slot sees a blocked thread, or the thread sees the slot.
+        unique_lock<mutex> lock(_mutex);
+        ++_blockedCount;
+        _notFull.wait(lock, [this]()
+        {
+            return _isStopped || _pendingCount < _queue->capacity();
+        });
+        --_blockedCount;
+    }
+
+    if(0 != _idleCount)
+    {
+        lock_guard<mutex> lock(_mutex);
+        _notEmpty.notify_one();
+    }
+    return true;
+}
+
+bool AsyncPurifier::pop(std::vector<Job>& batch)
+{
+    batch.clear();
+    for(;;)
+    {
+        Job job;
+        while(batch.size() < batchSize && _queue->tryPop(job))
+        {
+            batch.push_back(move(job));
+        }
+
+        if(!batch.empty())
+        {
+            _pendingCount -= batch.size();
+            if(0 != _blockedCount)
+            {
+                lock_guard<mutex> lock(_mutex);
+                _notFull.notify_all();
+            }
+            return true;
+        }
+
+        unique_lock<mutex> lock(_mutex);
+        ++_idleCount;
+        _notEmpty.wait(lock, [this]()
+        {
+            return _isStopped || 0 != _pendingCount;
+        });
+        --_idleCount;
+
+        if(_isStopped && 0 == _pendingCount)
+        {
+            return false;
+        }
+    }
+}
+
+void AsyncPurifier::work()
+{
+    ScanContext context;
+    vector<Job> batch;
+    vector<AsyncResult> completions;
+    batch.reserve(batchSize);
+    while(pop(batch))
+    {
+        for(Job& job : batch)
+        {
+            const AsyncRequest& request = job._request;
+            AsyncResult result{AsyncStatus::Done, job._tag, false, string()};
+            if(AsyncOperation::Check == request._operation)
+            {
+                result._isFound =
+                    _purifier.check(context, request._text.data(), request._text.size());
+            }
+            else
+            {
+                const string& text = request._text;
+                const string& mask = request._mask;
+                result._text = mask.empty()
+                               ? _purifier.purify(context, text.data(), text.size(), '*', true)
+                               : _purifier.purify(context,
+                                                  text.data(),
+                                                  text.size(),
+                                                  mask.data(),
+                                                  mask.size());
+                result._isFound = context.isFound();
+            }
+
+            if(nullptr != job._promise)
+            {
+                job._promise->set_value(move(result));
+            }
+            else if(nullptr != job._callback)
+            {
+                job._callback(job._context, result);
+            }
+            else
+            {
+                completions.push_back(move(result));
+            }
+        }
+
+        // The completion queue is signalled once for the batch.
+        if(!completions.empty())
+        {
+            {
+                lock_guard<mutex> lock(_completionMutex);
+                for(AsyncResult& result : completions)
+                {
+                    _completions.push_back(move(result));
+                }
+            }
+            completions.clear();
+
+            if(-1 != _writeFd)
+            {
+                const uint64_t signal = 1;
+                while(-1 == write(_writeFd, &signal, sizeof(signal)) && EINTR == errno)
+                {
+                }
+            }
+        }
+    }
+}
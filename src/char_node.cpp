@@ -38,6 +38,7 @@ CharNode::CharNode()
 CharNode::CharNode(wchar_t character)
 : _character(character)
 , _isEndNode(false)
+, _wordId(0)
 , _next()
 {
 }
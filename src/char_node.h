@@ -26,6 +26,7 @@
 #ifndef __LAKOO_CHAR_NODE_H__
 #define __LAKOO_CHAR_NODE_H__
 
+#include <cstddef>
 #include <map>
 #include <memory>
 
@@ -42,6 +43,13 @@ namespace lakoo
     //! A character node.
     class CharNode final
     {
+    public:
+        //! The reserved character of the edge which matches any single character.
+        static const wchar_t anyCharacter = L'\xFDD0';
+
+        //! The reserved character of the edge which starts a gap of arbitrary characters.
+        static const wchar_t gapCharacter = L'\xFDD1';
+
     public:
         //! Default constructor.
         /**
@@ -78,12 +86,26 @@ namespace lakoo
          */
         inline bool isEndNode() const { return _isEndNode; }
 
+        //! The ID of the word which ends at this CharNode.
+        /**
+         * @return The word ID, only meaningful if the CharNode is an end node.
+         * @sa CharNode::markEndNode
+         */
+        inline std::size_t wordId() const { return _wordId; }
+
         //! To mark the CharNode to be an end node.
         /**
          * The CharNode will mark to be an end node if the character is the last character in the
          * word.
+         * @param [in] wordId The ID of the word which ends at this CharNode.
+         */
+        inline void markEndNode(std::size_t wordId) { _isEndNode = true; _wordId = wordId; }
+
+        //! The next CharNode of all characters.
+        /**
+         * @return The container of the next CharNode.
          */
-        inline void markEndNode() { _isEndNode = true; }
+        inline const CharMap& nextNodes() const { return _next; }
 
     public:
         //! To retrieve the next code with the given character.
@@ -93,6 +115,18 @@ namespace lakoo
          */
         std::shared_ptr<CharNode> nextNode(wchar_t character) const;
 
+        //! To retrieve the next node with the given character without touching the reference count.
+        /**
+         * It is the lightweight version of CharNode::nextNode for the scanning loop.
+         * @param [in] character The character to find next node.
+         * @return               The next CharNode, nullptr if it is not found.
+         */
+        inline const CharNode* findNext(wchar_t character) const
+        {
+            auto iter = _next.find(character);
+            return _next.end() != iter ? iter->second.get() : nullptr;
+        }
+
         //! To add the next character from this CharNode.
         /**
          * @param [in] character The character to add.
@@ -107,6 +141,9 @@ namespace lakoo
         //! Whether the node is an end node.
         bool _isEndNode;
 
+        //! The ID of the word which ends at this node.
+        std::size_t _wordId;
+
         //! The container to store the next CharNode.
         CharMap _next;
     };
@@ -0,0 +1,858 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   dafsa.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-07
+ */
+
+#include "dafsa.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <queue>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+using namespace lakoo;
+using namespace std;
+
+
+namespace
+{
+    //! The number of edges below which the edges are searched linearly.
+    const uint32_t linearEdgeCount = 16;
+
+    //! The minimum number of edges of a node to index them in a table.
+    const uint32_t denseEdgeCount = 32;
+
+    //! The maximum number of entries of the table per edge, bounding the memory of a table.
+    const uint32_t denseSlotsPerEdge = 8;
+
+    //! The number of chain labels read past the last one by a block of Dafsa::follow.
+    const size_t chainPadding = 3;
+
+    //! The initial number of slots of the register, a power of 2.
+    const size_t initialRegisterSize = 1024;
+
+    //! The slot of the register without any node.
+    const uint32_t emptySlot = numeric_limits<uint32_t>::max();
+
+    //! To find a character in the sorted characters of the edges of a node.
+    /**
+     * @param [in] labels    The characters.
+     * @param [in] count     The number of characters.
+     * @param [in] character The character to find.
+     * @return               The index of the character, \c count if it is not found.
+     */
+    inline uint32_t findLabel(const wchar_t* labels, uint32_t count, wchar_t character)
+    {
+        if(count >= linearEdgeCount)
+        {
+            const wchar_t* label = lower_bound(labels, labels + count, character);
+            return labels + count != label && character == *label
+                   ? static_cast<uint32_t>(label - labels)
+                   : count;
+        }
+
+        uint32_t index = 0;
+#ifdef __SSE2__
+        // Compare 4 characters at once.
+        static_assert(sizeof(wchar_t) == sizeof(int32_t), "the characters are 32 bits");
+        const __m128i key = _mm_set1_epi32(static_cast<int32_t>(character));
+        for(; index + 4 <= count; index += 4)
+        {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(labels + index));
+            const int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(block, key));
+            if(0 != mask)
+            {
+                return index + static_cast<uint32_t>(__builtin_ctz(mask)) / 4;
+            }
+        }
+#endif
+        for(; index < count; ++index)
+        {
+            if(character == labels[index])
+            {
+                return index;
+            }
+        }
+        return count;
+    }
+
+    //! To append a value to an image.
+    template <typename _Type>
+    void put(string& image, _Type value)
+    {
+        image.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    //! To read a value from an image.
+    template <typename _Type>
+    bool get(const char* data, size_t size, size_t& offset, _Type& value)
+    {
+        if(size - offset < sizeof(value))
+        {
+            return false;
+        }
+
+        memcpy(&value, data + offset, sizeof(value));
+        offset += sizeof(value);
+        return true;
+    }
+}
+
+
+Dafsa::Dafsa()
+: _nodes(1, Node{0, 0, false, NodeKind::Sorted, 0})
+, _edges()
+, _wordIds()
+, _labels()
+, _slots()
+, _chainLabels()
+, _chainTargets()
+{
+}
+
+const std::uint32_t Dafsa::chainEnd;
+
+bool Dafsa::next(const AutomatonState& current, wchar_t character, AutomatonState& next) const
+{
+    if(current._node >= _nodes.size())
+    {
+        const uint32_t label = _chainLabels[current._node - _nodes.size()];
+        if((label & ~chainEnd) != static_cast<uint32_t>(character))
+        {
+            return false;
+        }
+
+        next = chainNext(current, label);
+        return true;
+    }
+
+    const Node& node = _nodes[current._node];
+    uint32_t index = node._edgeCount;
+    if(NodeKind::Single == node._kind)
+    {
+        index = character == _labels[node._firstEdge] ? 0 : 1;
+    }
+    else if(NodeKind::Dense == node._kind)
+    {
+        // An entry of 0 for no edge wraps to an index past the edges.
+        const uint32_t* table = _slots.data() + node._table;
+        const uint32_t offset = static_cast<uint32_t>(character) - table[0];
+        index = (offset < table[1] ? table[2 + offset] : 0) - 1;
+    }
+    else
+    {
+        index = findLabel(_labels.data() + node._firstEdge, node._edgeCount, character);
+    }
+
+    if(index >= node._edgeCount)
+    {
+        return false;
+    }
+
+    const Edge& edge = _edges[node._firstEdge + index];
+    next = AutomatonState{edge._target, current._rank + edge._rank};
+    return true;
+}
+
+std::size_t Dafsa::follow(AutomatonState& current, const wchar_t* text, std::size_t size) const
+{
+    if(current._node < _nodes.size())
+    {
+        return 0;
+    }
+
+    // The last state of the chain is left to next, which goes out of the chain.
+    const uint32_t* labels = _chainLabels.data() + (current._node - _nodes.size());
+    size_t count = 0;
+#ifdef __SSE2__
+    // Compare 4 characters at once, the labels must not end the chain.
+    for(; count + 4 <= size; count += 4)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + count));
+        const __m128i chain = _mm_loadu_si128(reinterpret_cast<const __m128i*>(labels + count));
+        if(0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi32(block, chain)) ||
+           0 != _mm_movemask_ps(_mm_castsi128_ps(chain)))
+        {
+            break;
+        }
+    }
+#endif
+    for(; count < size; ++count)
+    {
+        if(static_cast<uint32_t>(text[count]) != labels[count] || 0 != (labels[count] & chainEnd))
+        {
+            break;
+        }
+    }
+
+    current._node += count;
+    return count;
+}
+
+void Dafsa::expand(NodeArray& nodes, EdgeArray& edges) const
+{
+    vector<uint32_t> order(_nodes.size(), 0);
+    for(uint32_t index = 0; index < order.size(); ++index)
+    {
+        order[index] = index;
+    }
+    expand(order, nodes, edges);
+}
+
+std::size_t Dafsa::memoryUsage(MemoryUsage& usage) const
+{
+    const size_t nodes = _nodes.capacity() * sizeof(Node);
+    const size_t edges = _edges.capacity() * sizeof(Edge);
+    const size_t tables = _labels.capacity() * sizeof(wchar_t) +
+                          (_slots.capacity() + _chainLabels.capacity() +
+                           _chainTargets.capacity()) * sizeof(uint32_t);
+    const size_t metadata = sizeof(Dafsa) + _wordIds.capacity() * sizeof(size_t);
+    usage._nodes += nodes;
+    usage._edges += edges;
+    usage._tables += tables;
+    usage._metadata += metadata;
+    return nodes + edges + tables + metadata;
+}
+
+std::shared_ptr<Dafsa> Dafsa::place(const PagePlacement& placement) const
+{
+    auto dafsa = make_shared<Dafsa>();
+    dafsa->_nodes = NodeArray(_nodes.begin(), _nodes.end(), PageAllocator<Node>(placement));
+    dafsa->_edges = EdgeArray(_edges.begin(), _edges.end(), PageAllocator<Edge>(placement));
+    dafsa->_wordIds =
+        WordIdArray(_wordIds.begin(), _wordIds.end(), PageAllocator<size_t>(placement));
+    dafsa->_labels = LabelArray(_labels.begin(), _labels.end(), PageAllocator<wchar_t>(placement));
+    dafsa->_slots = SlotArray(_slots.begin(), _slots.end(), PageAllocator<uint32_t>(placement));
+    dafsa->_chainLabels =
+        SlotArray(_chainLabels.begin(), _chainLabels.end(), PageAllocator<uint32_t>(placement));
+    dafsa->_chainTargets =
+        SlotArray(_chainTargets.begin(), _chainTargets.end(), PageAllocator<uint32_t>(placement));
+    return dafsa;
+}
+
+std::shared_ptr<Dafsa> Dafsa::order(const std::vector<std::uint64_t>& visits) const
+{
+    if(visits.size() != nodeCount())
+    {
+        return nullptr;
+    }
+
+    // The chains go with the nodes they start from, so a node waits for the nodes whose chains
+    // end at it.
+    auto chainTarget = [this](uint32_t target)
+    {
+        if(target < _nodes.size())
+        {
+            return target;
+        }
+
+        size_t index = target - _nodes.size();
+        while(0 == (_chainLabels[index] & chainEnd))
+        {
+            ++index;
+        }
+        return _chainTargets[index];
+    };
+
+    vector<uint32_t> parentCounts(_nodes.size(), 0);
+    for(const Edge& edge : _edges)
+    {
+        ++parentCounts[chainTarget(edge._target)];
+    }
+
+    // Kahn's algorithm taking the most visited of the ready nodes, the earlier one on ties, and
+    // the root always first.
+    auto isColder = [&visits](uint32_t left, uint32_t right)
+    {
+        if(0 == left || 0 == right)
+        {
+            return 0 != left;
+        }
+        return visits[left] != visits[right] ? visits[left] < visits[right] : left > right;
+    };
+    priority_queue<uint32_t, vector<uint32_t>, decltype(isColder)> ready(isColder);
+    for(uint32_t index = 0; index < _nodes.size(); ++index)
+    {
+        if(0 == parentCounts[index])
+        {
+            ready.push(index);
+        }
+    }
+
+    vector<uint32_t> order;
+    order.reserve(_nodes.size());
+    while(!ready.empty())
+    {
+        const uint32_t index = ready.top();
+        ready.pop();
+        order.push_back(index);
+
+        const Node& node = _nodes[index];
+        for(uint32_t edge = node._firstEdge; edge < node._firstEdge + node._edgeCount; ++edge)
+        {
+            const uint32_t target = chainTarget(_edges[edge]._target);
+            if(0 == --parentCounts[target])
+            {
+                ready.push(target);
+            }
+        }
+    }
+
+    // The chains are compressed again in the new order, next to their nodes.
+    auto dafsa = make_shared<Dafsa>();
+    expand(order, dafsa->_nodes, dafsa->_edges);
+    dafsa->_wordIds.assign(_wordIds.begin(), _wordIds.end());
+    dafsa->compress();
+    return dafsa;
+}
+
+void Dafsa::save(std::string& image) const
+{
+    NodeArray nodes;
+    EdgeArray edges;
+    expand(nodes, edges);
+
+    put<uint64_t>(image, nodes.size());
+    put<uint64_t>(image, edges.size());
+    put<uint64_t>(image, _wordIds.size());
+    for(const Node& node : nodes)
+    {
+        put<uint32_t>(image, node._firstEdge);
+        put<uint32_t>(image, node._edgeCount);
+        put<uint32_t>(image, node._isFinal ? 1 : 0);
+    }
+
+    for(const Edge& edge : edges)
+    {
+        put<uint32_t>(image, static_cast<uint32_t>(edge._character));
+        put<uint32_t>(image, edge._target);
+        put<uint32_t>(image, edge._rank);
+    }
+
+    for(size_t wordId : _wordIds)
+    {
+        put<uint64_t>(image, wordId);
+    }
+}
+
+std::shared_ptr<Dafsa> Dafsa::load(const char* data, std::size_t size, std::size_t& offset)
+{
+    uint64_t nodeCount = 0;
+    uint64_t edgeCount = 0;
+    uint64_t wordCount = 0;
+    if(offset > size ||
+       !get(data, size, offset, nodeCount) ||
+       !get(data, size, offset, edgeCount) ||
+       !get(data, size, offset, wordCount))
+    {
+        return nullptr;
+    }
+
+    // Check the counts against the size before allocating anything.
+    const uint64_t left = size - offset;
+    if(0 == nodeCount ||
+       nodeCount > numeric_limits<uint32_t>::max() ||
+       edgeCount > numeric_limits<uint32_t>::max() ||
+       nodeCount > left / 12 ||
+       edgeCount > left / 12 ||
+       wordCount > left / 8 ||
+       nodeCount * 12 + edgeCount * 12 + wordCount * 8 > left)
+    {
+        return nullptr;
+    }
+
+    shared_ptr<Dafsa> dafsa = make_shared<Dafsa>();
+    dafsa->_nodes.resize(nodeCount);
+    for(Node& node : dafsa->_nodes)
+    {
+        uint32_t isFinal = 0;
+        get(data, size, offset, node._firstEdge);
+        get(data, size, offset, node._edgeCount);
+        get(data, size, offset, isFinal);
+        node._isFinal = 0 != isFinal;
+    }
+
+    dafsa->_edges.resize(edgeCount);
+    for(Edge& edge : dafsa->_edges)
+    {
+        uint32_t character = 0;
+        get(data, size, offset, character);
+        get(data, size, offset, edge._target);
+        get(data, size, offset, edge._rank);
+        edge._character = static_cast<wchar_t>(character);
+    }
+
+    dafsa->_wordIds.resize(wordCount);
+    for(size_t& wordId : dafsa->_wordIds)
+    {
+        uint64_t value = 0;
+        get(data, size, offset, value);
+        wordId = static_cast<size_t>(value);
+    }
+
+    // The targets are after their nodes, so the words below each node are counted backward.
+    vector<uint64_t> counts(nodeCount, 0);
+    for(size_t index = nodeCount; index-- > 0;)
+    {
+        const Node& node = dafsa->_nodes[index];
+        if(static_cast<uint64_t>(node._firstEdge) + node._edgeCount > edgeCount)
+        {
+            return nullptr;
+        }
+
+        uint64_t rank = node._isFinal ? 1 : 0;
+        const Edge* edge = dafsa->_edges.data() + node._firstEdge;
+        for(const Edge* last = edge + node._edgeCount; edge != last; ++edge)
+        {
+            if(edge->_target <= index ||
+               edge->_target >= nodeCount ||
+               edge->_rank != rank ||
+               (edge + 1 != last && edge->_character >= (edge + 1)->_character))
+            {
+                return nullptr;
+            }
+
+            rank += counts[edge->_target];
+            if(rank > wordCount)
+            {
+                return nullptr;
+            }
+        }
+        counts[index] = rank;
+    }
+
+    if(counts[0] != wordCount)
+    {
+        return nullptr;
+    }
+
+    dafsa->compress();
+    return dafsa;
+}
+
+void Dafsa::compress()
+{
+    // A node goes into a chain if it is not the root, no word ends at it, only one edge goes to
+    // it, and its only edge is not a space, which the scan skips, or a character with chainEnd.
+    vector<uint32_t> parentCounts(_nodes.size(), 0);
+    for(const Edge& edge : _edges)
+    {
+        ++parentCounts[edge._target];
+    }
+
+    vector<bool> isChained(_nodes.size(), false);
+    vector<uint32_t> indices(_nodes.size(), 0);
+    uint32_t count = 0;
+    for(size_t index = 0; index < _nodes.size(); ++index)
+    {
+        const Node& node = _nodes[index];
+        isChained[index] =
+            0 != index &&
+            !node._isFinal &&
+            1 == node._edgeCount &&
+            1 == parentCounts[index] &&
+            L' ' != _edges[node._firstEdge]._character &&
+            0 == (static_cast<uint32_t>(_edges[node._firstEdge]._character) & chainEnd);
+        if(!isChained[index])
+        {
+            indices[index] = count++;
+        }
+    }
+
+    // Only the edges from the other nodes are kept, each chain is walked from the edge into it.
+    NodeArray nodes(_nodes.get_allocator());
+    EdgeArray edges(_edges.get_allocator());
+    SlotArray labels(_chainLabels.get_allocator());
+    SlotArray targets(_chainTargets.get_allocator());
+    nodes.reserve(count);
+    for(size_t index = 0; index < _nodes.size(); ++index)
+    {
+        if(isChained[index])
+        {
+            continue;
+        }
+
+        const Node& node = _nodes[index];
+        nodes.push_back(Node{static_cast<uint32_t>(edges.size()),
+                             node._edgeCount,
+                             node._isFinal,
+                             NodeKind::Sorted,
+                             0});
+        for(uint32_t edge = node._firstEdge; edge < node._firstEdge + node._edgeCount; ++edge)
+        {
+            const Edge& source = _edges[edge];
+            uint32_t target = source._target;
+            if(!isChained[target])
+            {
+                edges.push_back(Edge{source._character, indices[target], source._rank});
+                continue;
+            }
+
+            edges.push_back(Edge{source._character,
+                                 count + static_cast<uint32_t>(labels.size()),
+                                 source._rank});
+            while(isChained[target])
+            {
+                const Edge& chain = _edges[_nodes[target]._firstEdge];
+                labels.push_back(static_cast<uint32_t>(chain._character));
+                targets.push_back(0);
+                target = chain._target;
+            }
+            labels.back() |= chainEnd;
+            targets.back() = indices[target];
+        }
+    }
+    labels.insert(labels.end(), chainPadding, chainEnd);
+
+    _nodes.swap(nodes);
+    _edges.swap(edges);
+    _chainLabels.swap(labels);
+    _chainTargets.swap(targets);
+    classify();
+}
+
+void Dafsa::expand(const std::vector<std::uint32_t>& order,
+                   NodeArray& nodes,
+                   EdgeArray& edges) const
+{
+    // The number of states of the chain from a state.
+    auto chainLength = [this](uint32_t state)
+    {
+        uint32_t length = 1;
+        for(size_t index = state - _nodes.size(); 0 == (_chainLabels[index] & chainEnd); ++index)
+        {
+            ++length;
+        }
+        return length;
+    };
+
+    // Each node is followed by the states of its chains, the indices are counted first as the
+    // edges go forward.
+    vector<uint32_t> indices(_nodes.size(), 0);
+    uint32_t count = 0;
+    for(uint32_t index : order)
+    {
+        indices[index] = count++;
+        const Node& node = _nodes[index];
+        for(uint32_t edge = node._firstEdge; edge < node._firstEdge + node._edgeCount; ++edge)
+        {
+            if(_edges[edge]._target >= _nodes.size())
+            {
+                count += chainLength(_edges[edge]._target);
+            }
+        }
+    }
+
+    nodes.clear();
+    edges.clear();
+    nodes.reserve(count);
+    edges.reserve(_edges.size() + _chainTargets.size());
+    for(uint32_t index : order)
+    {
+        const Node& node = _nodes[index];
+        nodes.push_back(Node{static_cast<uint32_t>(edges.size()),
+                             node._edgeCount,
+                             node._isFinal,
+                             NodeKind::Sorted,
+                             0});
+
+        uint32_t chainIndex = indices[index] + 1;
+        for(uint32_t edge = node._firstEdge; edge < node._firstEdge + node._edgeCount; ++edge)
+        {
+            const Edge& source = _edges[edge];
+            if(source._target < _nodes.size())
+            {
+                edges.push_back(Edge{source._character, indices[source._target], source._rank});
+            }
+            else
+            {
+                edges.push_back(Edge{source._character, chainIndex, source._rank});
+                chainIndex += chainLength(source._target);
+            }
+        }
+
+        for(uint32_t edge = node._firstEdge; edge < node._firstEdge + node._edgeCount; ++edge)
+        {
+            if(_edges[edge]._target < _nodes.size())
+            {
+                continue;
+            }
+
+            for(size_t state = _edges[edge]._target - _nodes.size();; ++state)
+            {
+                const uint32_t label = _chainLabels[state];
+                const uint32_t target = 0 != (label & chainEnd)
+                                        ? indices[_chainTargets[state]]
+                                        : static_cast<uint32_t>(nodes.size() + 1);
+                nodes.push_back(Node{static_cast<uint32_t>(edges.size()),
+                                     1,
+                                     false,
+                                     NodeKind::Sorted,
+                                     0});
+                edges.push_back(Edge{static_cast<wchar_t>(label & ~chainEnd), target, 0});
+                if(0 != (label & chainEnd))
+                {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void Dafsa::classify()
+{
+    _labels.assign(_edges.size(), 0);
+    for(size_t index = 0; index < _edges.size(); ++index)
+    {
+        _labels[index] = _edges[index]._character;
+    }
+
+    _slots.clear();
+    for(Node& node : _nodes)
+    {
+        node._kind = 1 == node._edgeCount ? NodeKind::Single : NodeKind::Sorted;
+        node._table = 0;
+        if(node._edgeCount < denseEdgeCount)
+        {
+            continue;
+        }
+
+        // The characters are sorted, so the range is from the first one to the last one.
+        const Edge* edges = _edges.data() + node._firstEdge;
+        const uint32_t first = static_cast<uint32_t>(edges[0]._character);
+        const uint64_t range =
+            static_cast<uint64_t>(static_cast<uint32_t>(edges[node._edgeCount - 1]._character)) -
+            first + 1;
+        if(range > static_cast<uint64_t>(node._edgeCount) * denseSlotsPerEdge)
+        {
+            continue;
+        }
+
+        node._kind = NodeKind::Dense;
+        node._table = static_cast<uint32_t>(_slots.size());
+        _slots.push_back(first);
+        _slots.push_back(static_cast<uint32_t>(range));
+        _slots.resize(_slots.size() + range, 0);
+        for(uint32_t index = 0; index < node._edgeCount; ++index)
+        {
+            _slots[node._table + 2 + (static_cast<uint32_t>(edges[index]._character) - first)] =
+                index + 1;
+        }
+    }
+}
+
+DafsaBuilder::DafsaBuilder()
+: _nodes()
+, _edges()
+, _register(initialRegisterSize, make_pair(0U, emptySlot))
+, _path(1)
+, _pathSize(1)
+, _previous()
+, _wordIds()
+{
+}
+
+void DafsaBuilder::add(const std::wstring& word, std::size_t wordId)
+{
+    add(word.data(), word.size(), wordId);
+}
+
+void DafsaBuilder::add(const wchar_t* word, std::size_t size, std::size_t wordId)
+{
+    if(0 == size || _previous.compare(0, _previous.size(), word, size) >= 0)
+    {
+        return;
+    }
+
+    size_t depth = 0;
+    while(depth < _previous.size() && depth < size && _previous[depth] == word[depth])
+    {
+        ++depth;
+    }
+
+    // The nodes of the previous word after the common prefix are complete.
+    minimize(depth);
+
+    for(size_t index = depth; index < size; ++index)
+    {
+        // The edge is resolved when the next node is registered.
+        _path[_pathSize - 1]._edges.emplace_back(word[index], 0);
+        if(_path.size() == _pathSize)
+        {
+            _path.emplace_back();
+        }
+
+        PathNode& node = _path[_pathSize++];
+        node._isFinal = false;
+        node._edges.clear();
+    }
+
+    _path[_pathSize - 1]._isFinal = true;
+    _wordIds.push_back(wordId);
+    _previous.assign(word, size);
+}
+
+std::shared_ptr<Dafsa> DafsaBuilder::build()
+{
+    minimize(0);
+
+    // The root is registered last, number the nodes backward so that it is the first one.
+    replaceOrRegister(_path[0]);
+    const uint32_t last = static_cast<uint32_t>(_nodes.size() - 1);
+
+    // The children are registered before their parents, so they are counted first.
+    vector<uint32_t> counts(_nodes.size());
+    for(size_t index = 0; index < _nodes.size(); ++index)
+    {
+        const Node& node = _nodes[index];
+        uint32_t count = node._isFinal ? 1 : 0;
+        for(uint32_t edge = node._firstEdge; edge < node._firstEdge + node._edgeCount; ++edge)
+        {
+            count += counts[_edges[edge].second];
+        }
+        counts[index] = count;
+    }
+
+    auto dafsa = make_shared<Dafsa>();
+    dafsa->_nodes.resize(_nodes.size());
+    dafsa->_edges.reserve(_edges.size());
+    for(size_t index = 0; index < _nodes.size(); ++index)
+    {
+        const Node& node = _nodes[last - index];
+        dafsa->_nodes[index] = Dafsa::Node{static_cast<uint32_t>(dafsa->_edges.size()),
+                                           node._edgeCount,
+                                           node._isFinal,
+                                           Dafsa::NodeKind::Sorted,
+                                           0};
+
+        uint32_t rank = node._isFinal ? 1 : 0;
+        for(uint32_t edge = node._firstEdge; edge < node._firstEdge + node._edgeCount; ++edge)
+        {
+            const uint32_t target = _edges[edge].second;
+            dafsa->_edges.push_back(Dafsa::Edge{_edges[edge].first, last - target, rank});
+            rank += counts[target];
+        }
+    }
+    dafsa->_wordIds.swap(_wordIds);
+    dafsa->compress();
+
+    _nodes.clear();
+    _edges.clear();
+    _register.assign(initialRegisterSize, make_pair(0U, emptySlot));
+    _path[0]._isFinal = false;
+    _path[0]._edges.clear();
+    _pathSize = 1;
+    _previous.clear();
+
+    return dafsa;
+}
+
+void DafsaBuilder::minimize(std::size_t depth)
+{
+    for(size_t index = _pathSize - 1; index > depth; --index)
+    {
+        _path[index - 1]._edges.back().second = replaceOrRegister(_path[index]);
+    }
+
+    _pathSize = depth + 1;
+}
+
+std::uint32_t DafsaBuilder::replaceOrRegister(const PathNode& pathNode)
+{
+    if(_nodes.size() * 2 >= _register.size())
+    {
+        growRegister();
+    }
+
+    const Edge* const edges = pathNode._edges.data();
+    const size_t edgeCount = pathNode._edges.size();
+    const uint32_t nodeHash = hash(pathNode._isFinal, edges, edgeCount);
+    const size_t mask = _register.size() - 1;
+
+    // The hashes are kept in the table, so that the nodes are only compared on a probable hit.
+    size_t slot = nodeHash & mask;
+    for(; emptySlot != _register[slot].second; slot = (slot + 1) & mask)
+    {
+        if(_register[slot].first != nodeHash)
+        {
+            continue;
+        }
+
+        const Node& node = _nodes[_register[slot].second];
+        if(node._isFinal == pathNode._isFinal &&
+           node._edgeCount == edgeCount &&
+           equal(edges, edges + edgeCount, _edges.begin() + node._firstEdge))
+        {
+            return _register[slot].second;
+        }
+    }
+
+    const uint32_t index = static_cast<uint32_t>(_nodes.size());
+    _nodes.push_back(Node{static_cast<uint32_t>(_edges.size()),
+                          static_cast<uint32_t>(edgeCount),
+                          pathNode._isFinal});
+    _edges.insert(_edges.end(), edges, edges + edgeCount);
+    _register[slot] = make_pair(nodeHash, index);
+
+    return index;
+}
+
+std::uint32_t DafsaBuilder::hash(bool isFinal, const Edge* edges, std::size_t count)
+{
+    // FNV-1a over the characters and the next nodes.
+    uint32_t result = isFinal ? 2166136261U : 84696351U;
+    for(const Edge* edge = edges; edge != edges + count; ++edge)
+    {
+        result = (result ^ static_cast<uint32_t>(edge->first)) * 16777619U;
+        result = (result ^ edge->second) * 16777619U;
+    }
+
+    return result ^ (result >> 15);
+}
+
+void DafsaBuilder::growRegister()
+{
+    vector<pair<uint32_t, uint32_t>> slots(_register.size() * 2, make_pair(0U, emptySlot));
+    const size_t mask = slots.size() - 1;
+    for(const auto& entry : _register)
+    {
+        if(emptySlot == entry.second)
+        {
+            continue;
+        }
+
+        size_t slot = entry.first & mask;
+        while(emptySlot != slots[slot].second)
+        {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = entry;
+    }
+
+    _register.swap(slots);
+}
@@ -0,0 +1,544 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   dafsa.h
+ * @author Aludirk Wong
+ * @date   2017-08-07
+ */
+
+#ifndef __LAKOO_DAFSA_H__
+#define __LAKOO_DAFSA_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "numa_memory.h"
+#include "scan_buffer.h"
+#include "text_purifier.h"
+
+
+namespace lakoo
+{
+    //! The minimal acyclic automaton of the words, with shared prefixes and suffixes.
+    /**
+     * The nodes and edges are stored in flat arrays. As a node can be reached by many words, a
+     * word is identified by its rank in the sorted order instead: each edge holds the number of
+     * words ordered before the words through it, the sum along a path is the rank of the word
+     * ending there, which maps to the word ID.
+     *
+     * Each node picks a NodeKind when the automaton is built or loaded, as a radix tree adapts its
+     * nodes: the high fanout nodes near the root index their edges by character in a table, the
+     * nodes of a single edge compare it directly, and the others search a contiguous array of
+     * the characters of their edges.
+     *
+     * The chains of nodes of a single edge, which only one edge goes to and where no word ends,
+     * are not stored as nodes: the characters of each chain are a run in the chain labels, and a
+     * state inside a chain is numbered after the nodes by its position in the run. So a long word
+     * costs a character instead of a node and an edge per character, and a scan compares a chain
+     * against the text by blocks with Dafsa::follow. The image keeps all nodes.
+     */
+    class Dafsa final
+    {
+        friend class DafsaBuilder;
+
+    public:
+        //! How the edge of a character is found in a node, chosen by the edges of the node.
+        enum class NodeKind : std::uint8_t
+        {
+            //! The edges are sorted and searched, linearly if they are few.
+            Sorted,
+
+            //! The only edge is compared directly, as most deep nodes have.
+            Single,
+
+            //! The edges are indexed by the characters in a table, for nodes of high fanout.
+            Dense
+        };
+
+        //! A node, its edges are stored contiguously and sorted by the characters.
+        struct Node final
+        {
+            //! The index of the first edge.
+            std::uint32_t _firstEdge;
+
+            //! The number of edges.
+            std::uint32_t _edgeCount;
+
+            //! Whether a word ends at the node.
+            bool _isFinal;
+
+            //! The NodeKind.
+            NodeKind _kind;
+
+            //! The index of the table in the slots, for NodeKind::Dense.
+            std::uint32_t _table;
+        };
+
+        //! An edge to the next node.
+        struct Edge final
+        {
+            //! The character of the edge.
+            wchar_t _character;
+
+            //! The index of the next node.
+            std::uint32_t _target;
+
+            //! The number of words ordered before the words through the edge, from its node.
+            std::uint32_t _rank;
+        };
+
+        //! The array of the nodes.
+        typedef std::vector<Node, PageAllocator<Node>> NodeArray;
+
+        //! The array of the edges.
+        typedef std::vector<Edge, PageAllocator<Edge>> EdgeArray;
+
+        //! The array of the word IDs.
+        typedef std::vector<std::size_t, PageAllocator<std::size_t>> WordIdArray;
+
+        //! The array of the characters of the edges.
+        typedef std::vector<wchar_t, PageAllocator<wchar_t>> LabelArray;
+
+        //! The array of the tables of the dense nodes.
+        typedef std::vector<std::uint32_t, PageAllocator<std::uint32_t>> SlotArray;
+
+    public:
+        //! Default constructor.
+        /**
+         * The automaton without any word.
+         */
+        Dafsa();
+
+        //! Default destructor.
+        ~Dafsa() = default;
+
+        //! Deleted copy constructor.
+        Dafsa(const Dafsa&) = delete;
+
+        //! Deleted assignment operator.
+        Dafsa& operator=(const Dafsa&) = delete;
+
+    public:
+        //! The number of nodes, the states inside the chains included.
+        /**
+         * @return The number of nodes.
+         */
+        inline std::size_t nodeCount() const { return _nodes.size() + _chainTargets.size(); }
+
+        //! The number of words.
+        /**
+         * @return The number of words.
+         */
+        inline std::size_t wordCount() const { return _wordIds.size(); }
+
+        //! To get all nodes and edges with the chains expanded, as they are in the image.
+        /**
+         * The nodes are in a topological order, the root is the first one.
+         * @param [out] nodes The nodes.
+         * @param [out] edges The edges of all nodes.
+         */
+        void expand(NodeArray& nodes, EdgeArray& edges) const;
+
+        //! The word IDs by the ranks of the words.
+        /**
+         * @return The word IDs.
+         */
+        inline const WordIdArray& wordIds() const { return _wordIds; }
+
+        //! To add the bytes of the arrays to the usage by component.
+        /**
+         * The arrays are counted by their capacities, without the rounding to their pages.
+         * @param [in,out] usage The MemoryUsage to add to, without its total.
+         * @return               The number of bytes added.
+         */
+        std::size_t memoryUsage(MemoryUsage& usage) const;
+
+        //! Where the arrays are placed.
+        /**
+         * @return The PagePlacement.
+         */
+        inline PagePlacement placement() const { return _nodes.get_allocator().placement(); }
+
+        //! To copy the automaton into arrays of another placement.
+        /**
+         * The scan walks the arrays at random, so huge pages save most of its misses of the TLB,
+         * and a copy on the NUMA node of the scanning threads saves the remote reads.
+         * @param [in] placement The PagePlacement.
+         * @return               The copy.
+         */
+        std::shared_ptr<Dafsa> place(const PagePlacement& placement) const;
+
+        //! To copy the automaton with the nodes laid out by how often they are visited.
+        /**
+         * The nodes keep a topological order, the root first and every node before the nodes its
+         * edges go to, but of the nodes which can come next the most visited one is taken first.
+         * So the hot nodes near the root are packed into a few cache lines and pages instead of
+         * spread by the order of the words. The words and their IDs are not changed.
+         * @param [in] visits The number of visits of each node, as counted by VisitCounter.
+         * @return            The copy, nullptr if the number of counts is not the number of nodes.
+         */
+        std::shared_ptr<Dafsa> order(const std::vector<std::uint64_t>& visits) const;
+
+        //! The state of the root.
+        /**
+         * @return The state of the root.
+         */
+        inline AutomatonState root() const { return AutomatonState{0, 0}; }
+
+        //! To follow the edge of a character.
+        /**
+         * @param [in]  current   The current state.
+         * @param [in]  character The character of the edge.
+         * @param [out] next      The next state, unchanged if there is no such edge.
+         * @return                Whether the edge exists.
+         */
+        bool next(const AutomatonState& current, wchar_t character, AutomatonState& next) const;
+
+        //! To follow a chain as far as it matches the text, which is the characters after the
+        //! current state.
+        /**
+         * No word ends inside a chain, so the skipped states need no check. The text is compared
+         * 4 characters at a time, and a space never matches as a chain has none.
+         * @param [in,out] current The current state, moved to the last state matched.
+         * @param [in]     text    The text.
+         * @param [in]     size    The length of the text.
+         * @return                 The number of characters matched, 0 if the state is not in a
+         *                         chain.
+         */
+        std::size_t follow(AutomatonState& current, const wchar_t* text, std::size_t size) const;
+
+        //! Whether a word ends at the state.
+        /**
+         * @param [in] current The state.
+         * @return             Whether a word ends at the state.
+         */
+        inline bool isEnd(const AutomatonState& current) const
+        {
+            return current._node < _nodes.size() && _nodes[current._node]._isFinal;
+        }
+
+        //! The ID of the word which ends at the state.
+        /**
+         * @param [in] current The state, a word must end at it.
+         * @return             The word ID.
+         */
+        inline std::size_t wordId(const AutomatonState& current) const
+        {
+            return _wordIds[current._rank];
+        }
+
+        //! To visit all edges of a state.
+        /**
+         * @param [in] current The state.
+         * @param [in] visitor The callable with signature
+         *                     <tt>void(wchar_t character, const AutomatonState& next)</tt>.
+         */
+        template <typename _Visitor>
+        void forEachNext(const AutomatonState& current, _Visitor&& visitor) const;
+
+        //! To visit all words in the sorted order.
+        /**
+         * @param [in] visitor The callable with signature
+         *                     <tt>void(const std::wstring& word, std::size_t wordId)</tt>.
+         */
+        template <typename _Visitor>
+        void forEachWord(_Visitor&& visitor) const;
+
+        //! To append the image of the automaton, in the byte order of the host.
+        /**
+         * @param [in,out] image The image to append to.
+         */
+        void save(std::string& image) const;
+
+        //! To load an automaton from an image made by save.
+        /**
+         * The image is validated, the edges must go forward and the ranks must match the words
+         * below them, so that a scan never reads out of the arrays.
+         * @param [in]     data   The image.
+         * @param [in]     size   The number of bytes of the image.
+         * @param [in,out] offset The offset to read from, moved past the automaton.
+         * @return                The automaton, nullptr if the image is malformed.
+         */
+        static std::shared_ptr<Dafsa> load(const char* data, std::size_t size, std::size_t& offset);
+
+    private:
+        //! The flag of the chain label of the last state of a chain.
+        static const std::uint32_t chainEnd = 0x80000000;
+
+        //! The next state of a state inside a chain.
+        /**
+         * @param [in] current The state.
+         * @param [in] label   The chain label of the state.
+         * @return             The next state.
+         */
+        inline AutomatonState chainNext(const AutomatonState& current, std::uint32_t label) const
+        {
+            return AutomatonState{0 != (label & chainEnd)
+                                  ? _chainTargets[current._node - _nodes.size()]
+                                  : current._node + 1,
+                                  current._rank};
+        }
+
+        //! To move the chains out of the nodes and edges, which have all nodes expanded.
+        void compress();
+
+        //! To expand the chains in a given order of the nodes.
+        /**
+         * Each node is followed by the states of its chains.
+         * @param [in]  order The indices of the nodes, in a topological order.
+         * @param [out] nodes The nodes.
+         * @param [out] edges The edges of all nodes.
+         */
+        void expand(const std::vector<std::uint32_t>& order,
+                    NodeArray& nodes,
+                    EdgeArray& edges) const;
+
+        //! To choose the NodeKind of each node and build the labels and tables for them.
+        void classify();
+
+        //! To visit the words from a node.
+        /**
+         * @param [in]     node    The index of the node.
+         * @param [in]     rank    The rank of the path.
+         * @param [in,out] word    The characters of the path.
+         * @param [in]     visitor The callable to receive the words.
+         */
+        template <typename _Visitor>
+        void forEachWord(std::uint32_t node,
+                         std::size_t rank,
+                         std::wstring& word,
+                         _Visitor& visitor) const;
+
+    private:
+        //! The nodes, the root is the first one.
+        NodeArray _nodes;
+
+        //! The edges of all nodes.
+        EdgeArray _edges;
+
+        //! The word IDs by the ranks of the words.
+        WordIdArray _wordIds;
+
+        //! The characters of the edges, contiguous to be searched with SIMD.
+        LabelArray _labels;
+
+        //! The tables of the dense nodes, each is the first character, the number of entries and
+        //! an entry per character from the first, the index of its edge in the node plus 1.
+        SlotArray _slots;
+
+        //! The character out of each state inside the chains, with chainEnd at the last state of
+        //! a chain, padded by chainEnd to be compared by blocks.
+        SlotArray _chainLabels;
+
+        //! The node after each state inside the chains, only set at the last state of a chain.
+        SlotArray _chainTargets;
+    };
+
+
+    //! To build a Dafsa from the words in sorted order, one word at a time.
+    /**
+     * It is the incremental construction of Daciuk et al.: the nodes of the previous word which
+     * are not shared with the new word can no longer change, they are replaced by an equivalent
+     * registered node or registered themselves, so that the automaton is minimal at any time.
+     * Only the nodes of the path own memory, a registered node is a slice of the edge pool.
+     */
+    class DafsaBuilder final
+    {
+    public:
+        //! Default constructor.
+        DafsaBuilder();
+
+        //! Default destructor.
+        ~DafsaBuilder() = default;
+
+        //! Deleted copy constructor.
+        DafsaBuilder(const DafsaBuilder&) = delete;
+
+        //! Deleted assignment operator.
+        DafsaBuilder& operator=(const DafsaBuilder&) = delete;
+
+    public:
+        //! To add a word.
+        /**
+         * The words must be added in the sorted order, an empty word or a word not after the
+         * previous one is ignored.
+         * @param [in] word   The word.
+         * @param [in] wordId The ID of the word.
+         */
+        void add(const std::wstring& word, std::size_t wordId);
+
+        /**
+         * @overload
+         * @param [in] word   The characters of the word.
+         * @param [in] size   The length of the word.
+         * @param [in] wordId The ID of the word.
+         */
+        void add(const wchar_t* word, std::size_t size, std::size_t wordId);
+
+        //! To build the Dafsa of the added words, the builder is reset.
+        /**
+         * @return The Dafsa.
+         */
+        std::shared_ptr<Dafsa> build();
+
+    private:
+        //! An edge, the character with the index of the next node.
+        typedef std::pair<wchar_t, std::uint32_t> Edge;
+
+        //! A node of the path of the previous word, which can still change.
+        struct PathNode final
+        {
+            //! Whether a word ends at the node.
+            bool _isFinal;
+
+            //! The edges, sorted by the characters, the last one is to the next node of the path.
+            std::vector<Edge> _edges;
+        };
+
+        //! A registered node, which no longer changes.
+        struct Node final
+        {
+            //! The index of the first edge in the edge pool.
+            std::uint32_t _firstEdge;
+
+            //! The number of edges.
+            std::uint32_t _edgeCount;
+
+            //! Whether a word ends at the node.
+            bool _isFinal;
+        };
+
+    private:
+        //! To replace or register the nodes of the path deeper than a depth.
+        /**
+         * @param [in] depth The depth of the nodes kept in the path.
+         */
+        void minimize(std::size_t depth);
+
+        //! To find the registered node equivalent to a node of the path, or to register it.
+        /**
+         * @param [in] pathNode The node of the path.
+         * @return              The index of the registered node.
+         */
+        std::uint32_t replaceOrRegister(const PathNode& pathNode);
+
+        //! The hash of a node.
+        /**
+         * @param [in] isFinal Whether a word ends at the node.
+         * @param [in] edges   The edges of the node.
+         * @param [in] count   The number of edges.
+         * @return             The hash.
+         */
+        static std::uint32_t hash(bool isFinal, const Edge* edges, std::size_t count);
+
+        //! To double the size of the register.
+        void growRegister();
+
+    private:
+        //! The registered nodes, the children are always registered before their parents.
+        std::vector<Node> _nodes;
+
+        //! The edges of the registered nodes.
+        std::vector<Edge> _edges;
+
+        //! The open addressing table of the hashes and indices of the registered nodes.
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> _register;
+
+        //! The nodes of the path of the previous word, kept to reuse their memory.
+        std::vector<PathNode> _path;
+
+        //! The number of nodes in the path, the root included.
+        std::size_t _pathSize;
+
+        //! The previous word.
+        std::wstring _previous;
+
+        //! The word IDs by the ranks of the words.
+        Dafsa::WordIdArray _wordIds;
+    };
+
+
+    template <typename _Visitor>
+    void Dafsa::forEachNext(const AutomatonState& current, _Visitor&& visitor) const
+    {
+        if(current._node >= _nodes.size())
+        {
+            const std::uint32_t label = _chainLabels[current._node - _nodes.size()];
+            visitor(static_cast<wchar_t>(label & ~chainEnd), chainNext(current, label));
+            return;
+        }
+
+        const Node& node = _nodes[current._node];
+        const Edge* edge = _edges.data() + node._firstEdge;
+        for(const Edge* last = edge + node._edgeCount; edge != last; ++edge)
+        {
+            visitor(edge->_character, AutomatonState{edge->_target, current._rank + edge->_rank});
+        }
+    }
+
+    template <typename _Visitor>
+    void Dafsa::forEachWord(_Visitor&& visitor) const
+    {
+        std::wstring word;
+        forEachWord(0, 0, word, visitor);
+    }
+
+    template <typename _Visitor>
+    void Dafsa::forEachWord(std::uint32_t node,
+                            std::size_t rank,
+                            std::wstring& word,
+                            _Visitor& visitor) const
+    {
+        if(node >= _nodes.size())
+        {
+            // A chain goes on to a node with the same rank.
+            const std::size_t size = word.size();
+            AutomatonState state{node, rank};
+            while(state._node >= _nodes.size())
+            {
+                const std::uint32_t label = _chainLabels[state._node - _nodes.size()];
+                word.push_back(static_cast<wchar_t>(label & ~chainEnd));
+                state = chainNext(state, label);
+            }
+            forEachWord(static_cast<std::uint32_t>(state._node), rank, word, visitor);
+            word.resize(size);
+            return;
+        }
+
+        if(_nodes[node]._isFinal)
+        {
+            visitor(static_cast<const std::wstring&>(word), _wordIds[rank]);
+        }
+
+        const Edge* edge = _edges.data() + _nodes[node]._firstEdge;
+        for(const Edge* last = edge + _nodes[node]._edgeCount; edge != last; ++edge)
+        {
+            word.push_back(edge->_character);
+            forEachWord(edge->_target, rank + edge->_rank, word, visitor);
+            word.pop_back();
+        }
+    }
+} // namespace lakoo
+
+#endif // __LAKOO_DAFSA_H__
@@ -25,10 +25,22 @@
 
 #include "filter_list.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <limits>
+#include <new>
+
+#include <sys/stat.h>
 
 #include "char_node.h"
+#include "dafsa.h"
+#include "heap_size.h"
 #include "string_utils.h"
+#include "trie_automaton.h"
+#include "visit_counter.h"
+#include "word_loader.h"
 
 
 using namespace lakoo;
@@ -36,14 +48,64 @@ using namespace lakoo::StringUtils;
 using namespace std;
 
 
-WordSegment::WordSegment(std::wstring::size_type start, std::size_t length)
+namespace
+{
+    //! The magic number at the start of an image, with the version of the format.
+    const char imageMagic[8] = {'T', 'P', 'I', 'M', 'A', 'G', 'E', '1'};
+
+    //! The mark of the byte order of the host.
+    const uint32_t byteOrderMark = 0x01020304;
+
+    //! The flag of an image with patterns.
+    const uint32_t patternFlag = 1;
+
+    //! The bytes of the nodes of a trie.
+    /**
+     * @param [in] nodeCount The number of nodes.
+     * @return               The number of bytes.
+     */
+    inline size_t trieNodeBytes(size_t nodeCount)
+    {
+        // make_shared keeps each node in one block with its control block, the virtual table and
+        // the 2 counts.
+        return nodeCount * HeapSize::block(sizeof(CharNode) + sizeof(void*) + 2 * sizeof(int));
+    }
+
+    //! The bytes of the edges of a trie, each node but the root is in the map of its parent.
+    /**
+     * @param [in] nodeCount The number of nodes.
+     * @return               The number of bytes.
+     */
+    inline size_t trieEdgeBytes(size_t nodeCount)
+    {
+        return (nodeCount - 1) * HeapSize::treeNode<CharMap::value_type>();
+    }
+}
+
+
+WordSegment::WordSegment(std::wstring::size_type start, std::size_t length, std::size_t wordId)
 : _start(start)
 , _length(length)
+, _wordId(wordId)
 {
 }
 
 FilterList::FilterList()
 : _root(make_shared<CharNode>())
+, _trieNodeCount(1)
+, _wordCount(0)
+, _dafsa()
+, _options()
+, _isHugePage(false)
+, _isNumaReplicated(false)
+, _replicas()
+, _base()
+, _baseReplicas()
+, _baseWordCount(0)
+, _baseHasPattern(false)
+, _baseMaxLength(0)
+, _generation(0)
+, _memoryBudget(0)
 {
 }
 
@@ -71,22 +133,30 @@ FilterList::FilterList(const char* const* list, std::size_t count)
     add(list, count);
 }
 
+void FilterList::setHugePage(bool isHugePage)
+{
+    _isHugePage = isHugePage;
+    place();
+}
+
+void FilterList::setNumaReplicated(bool isNumaReplicated)
+{
+    if(nullptr != _dafsa)
+    {
+        checkBudget(*_dafsa, isNumaReplicated);
+    }
+
+    _isNumaReplicated = isNumaReplicated;
+    place();
+}
+
 void FilterList::add(const std::wstring& str)
 {
     wstring cleanUpStr = replace(str, L" ", L"");
     cleanUpStr = trim(cleanUpStr);
     cleanUpStr = toLowerCase(cleanUpStr);
 
-    auto node = _root;
-    for(auto character : cleanUpStr)
-    {
-        node = node->add(character);
-    }
-
-    if(node != _root)
-    {
-        node->markEndNode();
-    }
+    insert(cleanUpStr);
 }
 
 void FilterList::add(const std::string& str)
@@ -136,47 +206,503 @@ void FilterList::add(const char* const* list, std::size_t count)
     }
 }
 
-std::list<WordSegment> FilterList::find(const std::wstring& str) const
+bool FilterList::addFile(const std::string& path, std::size_t threadCount)
 {
-    list<WordSegment> result;
+    string data;
+    if(!readFile(path, data))
+    {
+        return false;
+    }
+
+    addWords(data.data(), data.size(), threadCount);
+    return true;
+}
+
+void FilterList::addWords(const char* data, std::size_t size, std::size_t threadCount)
+{
+    WordLoader loader(data, size, threadCount);
+    const vector<LoadedWord>& words = loader.words();
 
-    wstring charList = toLowerCase(str);
-    wstring::size_type size = charList.size();
-    for(size_t charIndex = 0; charIndex < size; ++charIndex)
+    // The new words get their IDs in the order of their first lines, the words already added
+    // keep their IDs.
+    const size_t noWord = numeric_limits<size_t>::max();
+    vector<size_t> wordIds(loader.lineCount(), noWord);
+    size_t wordCount = _wordCount;
+    size_t maxLength = _options._maxLength;
+    TrieAutomaton trie(_root.get());
+    for(const LoadedWord& word : words)
     {
-        if(L' ' == charList.at(charIndex))
+        const bool isAdded = nullptr != _dafsa
+                             ? contains(*_dafsa, word._characters, word._length)
+                             : contains(trie, word._characters, word._length);
+        if(!isAdded)
         {
-            continue;
+            wordIds[word._line] = 0;
         }
+        maxLength = max(maxLength, word._length);
+    }
 
-        auto nextNode = _root;
-        size_t end = numeric_limits<size_t>::max();
+    for(size_t& wordId : wordIds)
+    {
+        if(noWord != wordId)
+        {
+            wordId = wordCount++;
+        }
+    }
 
-        for(size_t findIndex = charIndex; findIndex < size; ++findIndex)
+    // Merge the sorted words with the words already added into the automaton, a word already
+    // added is ignored by the builder as it is not after the previous one.
+    DafsaBuilder builder;
+    auto next = words.begin();
+    forEachWord([&](const wstring& word, size_t wordId)
+    {
+        for(; words.end() != next &&
+              WordLoader::compare(next->_characters, next->_length, word.data(), word.size()) < 0;
+            ++next)
         {
-            wchar_t ch = charList.at(findIndex);
-            if(L' ' == ch)
-            {
-                continue;
-            }
+            builder.add(next->_characters, next->_length, wordIds[next->_line]);
+        }
+        builder.add(word, wordId);
+    });
 
-            nextNode = nextNode->nextNode(ch);
-            if(!nextNode)
-            {
-                break;
-            }
+    for(; words.end() != next; ++next)
+    {
+        builder.add(next->_characters, next->_length, wordIds[next->_line]);
+    }
+
+    shared_ptr<const Dafsa> dafsa = builder.build();
+    checkBudget(*dafsa, _isNumaReplicated);
+
+    _dafsa = dafsa;
+    _root = make_shared<CharNode>();
+    _trieNodeCount = 1;
+    place();
+    _wordCount = wordCount;
+    _options._maxLength = maxLength;
+    ++_generation;
+}
+
+void FilterList::addPattern(const std::wstring& str)
+{
+    wstring cleanUpStr = replace(str, L" ", L"");
+    cleanUpStr = trim(cleanUpStr);
+    cleanUpStr = toLowerCase(cleanUpStr);
 
-            if(nextNode->isEndNode())
+    // A gap at either end matches nothing more, and consecutive gaps are the same as one gap.
+    wstring pattern;
+    bool hasCharacter = false;
+    for(wchar_t character : cleanUpStr)
+    {
+        if(L'*' == character)
+        {
+            if(!pattern.empty() && CharNode::gapCharacter != pattern.back())
             {
-                end = findIndex;
+                pattern.push_back(CharNode::gapCharacter);
             }
         }
+        else if(L'?' == character)
+        {
+            pattern.push_back(CharNode::anyCharacter);
+        }
+        else
+        {
+            pattern.push_back(character);
+            hasCharacter = true;
+        }
+    }
+
+    while(!pattern.empty() && CharNode::gapCharacter == pattern.back())
+    {
+        pattern.pop_back();
+    }
+
+    if(hasCharacter)
+    {
+        insert(pattern);
+        _options._hasPattern = true;
+    }
+}
+
+void FilterList::addPattern(const std::string& str)
+{
+    addPattern(strToWStr(str));
+}
+
+void FilterList::addPattern(const wchar_t* str)
+{
+    addPattern(wstring(str));
+}
+
+void FilterList::addPattern(const char* str)
+{
+    addPattern(cStrToWStr(str));
+}
+
+std::list<WordSegment> FilterList::find(const std::wstring& str) const
+{
+    list<WordSegment> result;
+    find(str, [&result](size_t start, size_t length, size_t wordId)
+    {
+        result.emplace_back(start, length, wordId);
+        return true;
+    });
+
+    return result;
+}
+
+void FilterList::compile()
+{
+    if(nullptr != _dafsa)
+    {
+        return;
+    }
+
+    DafsaBuilder builder;
+    forEachWord([&builder](const wstring& word, size_t wordId)
+    {
+        builder.add(word, wordId);
+    });
 
-        if(numeric_limits<size_t>::max() != end)
+    shared_ptr<const Dafsa> dafsa = builder.build();
+    checkBudget(*dafsa, _isNumaReplicated);
+
+    _dafsa = dafsa;
+    _root = make_shared<CharNode>();
+    _trieNodeCount = 1;
+    place();
+}
+
+void FilterList::saveImage(std::string& image) const
+{
+    image.append(imageMagic, sizeof(imageMagic));
+
+    const uint32_t flags = _options._hasPattern ? patternFlag : 0;
+    const uint64_t wordCount = _wordCount;
+    const uint64_t maxLength = _options._maxLength;
+    image.append(reinterpret_cast<const char*>(&byteOrderMark), sizeof(byteOrderMark));
+    image.append(reinterpret_cast<const char*>(&flags), sizeof(flags));
+    image.append(reinterpret_cast<const char*>(&wordCount), sizeof(wordCount));
+    image.append(reinterpret_cast<const char*>(&maxLength), sizeof(maxLength));
+
+    if(nullptr != _dafsa)
+    {
+        _dafsa->save(image);
+        return;
+    }
+
+    DafsaBuilder builder;
+    forEachWord([&builder](const wstring& word, size_t wordId)
+    {
+        builder.add(word, wordId);
+    });
+    builder.build()->save(image);
+}
+
+bool FilterList::loadImage(const char* data, std::size_t size)
+{
+    uint32_t byteOrder = 0;
+    uint32_t flags = 0;
+    uint64_t wordCount = 0;
+    uint64_t maxLength = 0;
+    const size_t headerSize = sizeof(imageMagic) + sizeof(byteOrder) + sizeof(flags) +
+                              sizeof(wordCount) + sizeof(maxLength);
+    if(size < headerSize || 0 != memcmp(data, imageMagic, sizeof(imageMagic)))
+    {
+        return false;
+    }
+
+    size_t offset = sizeof(imageMagic);
+    memcpy(&byteOrder, data + offset, sizeof(byteOrder));
+    offset += sizeof(byteOrder);
+    memcpy(&flags, data + offset, sizeof(flags));
+    offset += sizeof(flags);
+    memcpy(&wordCount, data + offset, sizeof(wordCount));
+    offset += sizeof(wordCount);
+    memcpy(&maxLength, data + offset, sizeof(maxLength));
+    offset += sizeof(maxLength);
+    if(byteOrderMark != byteOrder)
+    {
+        return false;
+    }
+
+    shared_ptr<Dafsa> dafsa = Dafsa::load(data, size, offset);
+    if(nullptr == dafsa || offset != size)
+    {
+        return false;
+    }
+
+    checkBudget(*dafsa, _isNumaReplicated);
+    _root = make_shared<CharNode>();
+    _trieNodeCount = 1;
+    _dafsa = dafsa;
+    place();
+    _wordCount = max(static_cast<size_t>(wordCount), dafsa->wordCount());
+    _options._hasPattern = 0 != (flags & patternFlag);
+    _options._maxLength = static_cast<size_t>(maxLength);
+    ++_generation;
+    return true;
+}
+
+bool FilterList::recordVisits(const wchar_t* str,
+                              std::size_t size,
+                              ScanBuffer& buffer,
+                              std::vector<std::uint64_t>& visits) const
+{
+    if(nullptr == _dafsa)
+    {
+        return false;
+    }
+
+    if(_dafsa->nodeCount() != visits.size())
+    {
+        visits.assign(_dafsa->nodeCount(), 0);
+    }
+
+    VisitCounter counter(*_dafsa, visits);
+    Scanner<VisitCounter> scanner(counter, _options, buffer);
+    scanner.scan(str, size, [](size_t, size_t, size_t)
+    {
+        return true;
+    });
+    return true;
+}
+
+bool FilterList::orderNodes(const std::vector<std::uint64_t>& visits)
+{
+    if(nullptr == _dafsa)
+    {
+        return false;
+    }
+
+    shared_ptr<Dafsa> dafsa = _dafsa->order(visits);
+    if(nullptr == dafsa)
+    {
+        return false;
+    }
+
+    checkBudget(*dafsa, _isNumaReplicated);
+    _dafsa = dafsa;
+    place();
+    return true;
+}
+
+bool FilterList::setBase(const FilterList& base)
+{
+    if(nullptr == base._dafsa)
+    {
+        return false;
+    }
+
+    _base = base._dafsa;
+    _baseReplicas = base._replicas;
+    _baseWordCount = base._wordCount;
+    _baseHasPattern = base._options._hasPattern;
+    _baseMaxLength = base._options._maxLength;
+    ++_generation;
+    return true;
+}
+
+void FilterList::clearBase()
+{
+    _base.reset();
+    _baseReplicas.clear();
+    _baseWordCount = 0;
+    _baseHasPattern = false;
+    _baseMaxLength = 0;
+    ++_generation;
+}
+
+bool FilterList::readFile(const std::string& path, std::string& data)
+{
+    // A directory opens as a stream too, but it has no size to read.
+    struct stat status;
+    if(0 != stat(path.c_str(), &status) || !S_ISREG(status.st_mode))
+    {
+        return false;
+    }
+
+    ifstream file(path, ios::binary);
+    if(!file)
+    {
+        return false;
+    }
+
+    file.seekg(0, ios::end);
+    const streamoff size = file.tellg();
+    if(0 > size)
+    {
+        return false;
+    }
+
+    data.resize(static_cast<size_t>(size));
+    file.seekg(0, ios::beg);
+    return data.empty() || static_cast<bool>(file.read(&data[0], data.size()));
+}
+
+std::size_t FilterList::nodeCount() const
+{
+    return nullptr != _dafsa ? _dafsa->nodeCount() : _trieNodeCount;
+}
+
+void FilterList::memoryUsage(MemoryUsage& usage) const
+{
+    usage._metadata += HeapSize::block(sizeof(FilterList));
+    if(nullptr == _dafsa)
+    {
+        usage._nodes += trieNodeBytes(_trieNodeCount);
+        usage._edges += trieEdgeBytes(_trieNodeCount);
+        return;
+    }
+
+    if(_replicas.empty())
+    {
+        _dafsa->memoryUsage(usage);
+        return;
+    }
+
+    for(const shared_ptr<const Dafsa>& replica : _replicas)
+    {
+        replica->memoryUsage(usage);
+    }
+}
+
+void FilterList::insert(const std::wstring& str)
+{
+    // The nodes which the word adds are counted before anything is changed, a prefix which is
+    // already in the words shares their nodes.
+    size_t nodeCount = 0;
+    if(nullptr != _dafsa)
+    {
+        nodeCount = decompiledNodeCount() + str.size() - prefixLength(*_dafsa, str);
+    }
+    else
+    {
+        nodeCount = _trieNodeCount + str.size() - prefixLength(TrieAutomaton(_root.get()), str);
+    }
+    checkBudget(trieNodeBytes(nodeCount) + trieEdgeBytes(nodeCount));
+
+    if(nullptr != _dafsa)
+    {
+        decompile();
+    }
+    _trieNodeCount = nodeCount;
+
+    auto node = _root;
+    size_t length = 0;
+    for(auto character : str)
+    {
+        node = node->add(character);
+        if(CharNode::gapCharacter != character)
         {
-            result.emplace_back(charIndex, end - charIndex + 1);
+            ++length;
         }
     }
+    _options._maxLength = max(_options._maxLength, length);
+    ++_generation;
+
+    if(node != _root && !node->isEndNode())
+    {
+        node->markEndNode(_wordCount++);
+    }
+}
+
+void FilterList::forEachWord(
+    const std::function<void(const std::wstring&, std::size_t)>& visitor) const
+{
+    if(nullptr != _dafsa)
+    {
+        _dafsa->forEachWord(visitor);
+        return;
+    }
+
+    // The children of a CharNode are sorted, so the words are visited in the sorted order.
+    wstring word;
+    function<void(const CharNode*)> visit = [&](const CharNode* node)
+    {
+        if(node->isEndNode())
+        {
+            visitor(word, node->wordId());
+        }
+
+        for(const auto& next : node->nextNodes())
+        {
+            word.push_back(next.first);
+            visit(next.second.get());
+            word.pop_back();
+        }
+    };
+    visit(_root.get());
+}
+
+void FilterList::decompile()
+{
+    _dafsa->forEachWord([this](const wstring& word, size_t wordId)
+    {
+        auto node = _root;
+        for(auto character : word)
+        {
+            node = node->add(character);
+        }
+        node->markEndNode(wordId);
+    });
+
+    _dafsa.reset();
+    _replicas.clear();
+}
+
+std::size_t FilterList::decompiledNodeCount() const
+{
+    // The words are sorted, so each word adds the nodes after its common prefix with the
+    // previous word.
+    size_t result = 1;
+    wstring previous;
+    _dafsa->forEachWord([&](const wstring& word, size_t)
+    {
+        const auto common = mismatch(previous.begin(),
+                                     previous.begin() + min(previous.size(), word.size()),
+                                     word.begin());
+        result += static_cast<size_t>(word.end() - common.second);
+        previous = word;
+    });
 
     return result;
 }
+
+void FilterList::checkBudget(std::size_t bytes) const
+{
+    if(0 != _memoryBudget && bytes > _memoryBudget)
+    {
+        throw bad_alloc();
+    }
+}
+
+void FilterList::checkBudget(const Dafsa& dafsa, bool isNumaReplicated) const
+{
+    const size_t replicaCount = isNumaReplicated ? max<size_t>(1, NumaMemory::nodeCount()) : 1;
+    MemoryUsage usage{0, 0, 0, 0, 0, 0};
+    checkBudget(dafsa.memoryUsage(usage) * replicaCount);
+}
+
+void FilterList::place()
+{
+    _replicas.clear();
+    if(nullptr == _dafsa)
+    {
+        return;
+    }
+
+    // A host without NUMA only needs the automaton on huge pages.
+    const size_t nodeCount = _isNumaReplicated ? NumaMemory::nodeCount() : 1;
+    if(1 < nodeCount)
+    {
+        for(size_t node = 0; node < nodeCount; ++node)
+        {
+            _replicas.push_back(_dafsa->place(PagePlacement{_isHugePage, static_cast<int>(node)}));
+        }
+        _dafsa = _replicas[0];
+    }
+    else if(PagePlacement{_isHugePage, -1} != _dafsa->placement())
+    {
+        _dafsa = _dafsa->place(PagePlacement{_isHugePage, -1});
+    }
+}
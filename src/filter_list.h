@@ -26,16 +26,27 @@
 #ifndef __LAKOO_FILTER_LIST_H__
 #define __LAKOO_FILTER_LIST_H__
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <list>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "char_node.h"
+#include "dafsa.h"
+#include "layered_automaton.h"
+#include "numa_memory.h"
+#include "scan_buffer.h"
+#include "scanner.h"
+#include "text_purifier.h"
+#include "trie_automaton.h"
 
 
 namespace lakoo
 {
-    class CharNode;
-
-
     //! The data structure to indicate the word segment.
     struct WordSegment final
     {
@@ -46,13 +57,17 @@ namespace lakoo
         //! The length of the word segment.
         std::size_t _length;
 
+        //! The ID of the matched word.
+        std::size_t _wordId;
+
     public:
         //! Constructor.
         /**
          * @param [in] start  The start poition of a word segment.
          * @param [in] length The length of the word segment.
+         * @param [in] wordId The ID of the matched word.
          */
-        WordSegment(std::wstring::size_type start, std::size_t length);
+        WordSegment(std::wstring::size_type start, std::size_t length, std::size_t wordId);
 
         //! Default destructor.
         ~WordSegment() = default;
@@ -107,6 +122,108 @@ namespace lakoo
         //! Deleted assignment operator.
         FilterList& operator=(const FilterList&) = delete;
 
+    public:
+        //! To set the semantics of reporting the word segments.
+        /**
+         * @param [in] mode The MatchMode.
+         */
+        inline void setMatchMode(MatchMode mode)
+        {
+            _options._matchMode = mode;
+            ++_generation;
+        }
+
+        //! The semantics of reporting the word segments.
+        /**
+         * @return The MatchMode.
+         */
+        inline MatchMode matchMode() const { return _options._matchMode; }
+
+        //! To set whether the words of alphabetic scripts must match on word boundaries.
+        /**
+         * @param [in] isWordBoundary Whether to match on word boundaries.
+         */
+        inline void setWordBoundary(bool isWordBoundary)
+        {
+            _options._isWordBoundary = isWordBoundary;
+            ++_generation;
+        }
+
+        //! Whether the words of alphabetic scripts must match on word boundaries.
+        /**
+         * @return Whether to match on word boundaries.
+         */
+        inline bool isWordBoundary() const { return _options._isWordBoundary; }
+
+        //! To set the maximum number of characters a gap in patterns can match.
+        /**
+         * @param [in] maxGap The maximum number of characters.
+         */
+        inline void setMaxGap(std::size_t maxGap)
+        {
+            _options._maxGap = maxGap;
+            ++_generation;
+        }
+
+        //! The maximum number of characters a gap in patterns can match.
+        /**
+         * @return The maximum number of characters.
+         */
+        inline std::size_t maxGap() const { return _options._maxGap; }
+
+        //! To set the maximum edit distance of approximate matching.
+        /**
+         * @param [in] maxDistance The maximum edit distance, 0 for exact matching.
+         */
+        inline void setMaxDistance(std::size_t maxDistance)
+        {
+            _options._maxDistance = maxDistance;
+            ++_generation;
+        }
+
+        //! The maximum edit distance of approximate matching.
+        /**
+         * @return The maximum edit distance.
+         */
+        inline std::size_t maxDistance() const { return _options._maxDistance; }
+
+        //! To set whether the compiled automaton is placed on huge pages.
+        /**
+         * @param [in] isHugePage Whether to use huge pages.
+         */
+        void setHugePage(bool isHugePage);
+
+        //! Whether the compiled automaton is placed on huge pages.
+        /**
+         * @return Whether to use huge pages.
+         */
+        inline bool isHugePage() const { return _isHugePage; }
+
+        //! To set whether the compiled automaton is copied to each NUMA node.
+        /**
+         * @param [in] isNumaReplicated Whether to copy to each NUMA node.
+         * @throw std::bad_alloc The copies would exceed the memory budget.
+         */
+        void setNumaReplicated(bool isNumaReplicated);
+
+        //! Whether the compiled automaton is copied to each NUMA node.
+        /**
+         * @return Whether to copy to each NUMA node.
+         */
+        inline bool isNumaReplicated() const { return _isNumaReplicated; }
+
+        //! To set the maximum bytes of the trie or the compiled automaton.
+        /**
+         * @param [in] bytes The maximum number of bytes, 0 for no budget.
+         */
+        inline void setMemoryBudget(std::size_t bytes) { _memoryBudget = bytes; }
+
+        //! The maximum bytes of the trie or the compiled automaton.
+        /**
+         * @return The maximum number of bytes, 0 for no budget.
+         */
+        inline std::size_t memoryBudget() const { return _memoryBudget; }
+
     public:
         //! To add a word to the list.
         /**
@@ -158,6 +275,53 @@ namespace lakoo
          */
         void add(const char* const* list, std::size_t count);
 
+        //! To add the words of a word file to the list.
+        /**
+         * The file has one word per line in UTF-8. The words are normalized the same way as
+         * FilterList::add, then they are deduplicated and sorted in parallel and compiled with
+         * the words already added. The new words get their IDs in the order of their first lines.
+         * @param [in] path        The path of the word file.
+         * @param [in] threadCount The number of threads, 0 to use the number of cores.
+         * @return                 \c false if the file cannot be read.
+         */
+        bool addFile(const std::string& path, std::size_t threadCount);
+
+        //! To add the words of the content of a word file to the list.
+        /**
+         * @param [in] data        The content with one word per line in UTF-8.
+         * @param [in] size        The number of bytes of the content.
+         * @param [in] threadCount The number of threads, 0 to use the number of cores.
+         * @sa FilterList::addFile
+         */
+        void addWords(const char* data, std::size_t size, std::size_t threadCount);
+
+        //! To add a pattern to the list.
+        /**
+         * In a pattern, \c ? matches any single character and \c * matches up to maxGap()
+         * arbitrary characters, spaces in the text are skipped as usual. A pattern without any
+         * other character is ignored.
+         * @param [in] str The std::wstring pattern to add.
+         */
+        void addPattern(const std::wstring& str);
+
+        /**
+         * @overload
+         * @param [in] str The std::string pattern to add.
+         */
+        void addPattern(const std::string& str);
+
+        /**
+         * @overload
+         * @param [in] str The wchar_t string pattern to add.
+         */
+        void addPattern(const wchar_t* str);
+
+        /**
+         * @overload
+         * @param [in] str The char string pattern to add.
+         */
+        void addPattern(const char* str);
+
         //! To find all word segments to filter.
         /**
          * @param [in] str The std::wstring to check.
@@ -165,10 +329,332 @@ namespace lakoo
          */
         std::list<WordSegment> find(const std::wstring& str) const;
 
+        //! To visit all word segments to filter.
+        /**
+         * The word segments are visited in the order of their start positions, without building
+         * any container for them.
+         * @param [in] str     The std::wstring to check.
+         * @param [in] visitor The callable with signature
+         *                     <tt>bool(std::size_t start, std::size_t length, std::size_t wordId)</tt>,
+         *                     returns \c false to stop the scan.
+         * @return             \c false if the scan is stopped by the visitor.
+         */
+        template <typename _Visitor>
+        bool find(const std::wstring& str, _Visitor&& visitor) const;
+
+        /**
+         * @overload
+         * @param [in]     str     The wchar_t string to check.
+         * @param [in]     size    The length of the string.
+         * @param [in,out] buffer  The scratch buffers, their memory is reused.
+         * @param [in]     visitor The callable to receive the word segments.
+         */
+        template <typename _Visitor>
+        bool find(const wchar_t* str,
+                  std::size_t size,
+                  ScanBuffer& buffer,
+                  _Visitor&& visitor) const;
+
+        //! The number of words in the list.
+        /**
+         * @return The number of words, which is also the next word ID.
+         */
+        inline std::size_t size() const { return _wordCount; }
+
+        //! To compile the words into a minimal automaton sharing the prefixes and suffixes.
+        /**
+         * The trie is released after compiling, adding a word afterwards restores it first.
+         */
+        void compile();
+
+        //! Whether the words are compiled.
+        /**
+         * @return Whether the words are compiled.
+         */
+        inline bool isCompiled() const { return nullptr != _dafsa; }
+
+        //! The number of nodes of the trie or the compiled automaton.
+        /**
+         * @return The number of nodes, including the root.
+         */
+        std::size_t nodeCount() const;
+
+        //! To add the bytes of the trie or the compiled automaton to the usage by component.
+        /**
+         * Each copy on the NUMA nodes is counted, the base list is not.
+         * @param [in,out] usage The MemoryUsage to add to, without its total.
+         */
+        void memoryUsage(MemoryUsage& usage) const;
+
+        //! To append the image of the compiled words, they are compiled for it if they are not.
+        /**
+         * The image has the automaton, the number of words and whether there are patterns, but
+         * not the options of scanning. It is in the byte order of the host.
+         * @param [in,out] image The image to append to.
+         */
+        void saveImage(std::string& image) const;
+
+        //! To replace all the words by an image made by saveImage.
+        /**
+         * @param [in] data The image.
+         * @param [in] size The number of bytes of the image.
+         * @return          \c false if the image is malformed, the words are not changed.
+         */
+        bool loadImage(const char* data, std::size_t size);
+
+        //! To read a whole file.
+        /**
+         * @param [in]  path The path of the file.
+         * @param [out] data The content of the file.
+         * @return           \c false if the file cannot be read.
+         */
+        static bool readFile(const std::string& path, std::string& data);
+
+        //! To count the visits of the nodes of the compiled automaton by scanning a text.
+        /**
+         * The text is scanned with the options of the list, without the words of the base.
+         * @param [in]     str    The wchar_t string to scan.
+         * @param [in]     size   The length of the string.
+         * @param [in,out] buffer The scratch buffers, their memory is reused.
+         * @param [in,out] visits The number of visits of each node to add to, reset first if it
+         *                        does not have a count per node.
+         * @return                \c false if the words are not compiled.
+         */
+        bool recordVisits(const wchar_t* str,
+                          std::size_t size,
+                          ScanBuffer& buffer,
+                          std::vector<std::uint64_t>& visits) const;
+
+        //! To lay out the nodes of the compiled automaton by their visits, the hot ones first.
+        /**
+         * @param [in] visits The number of visits of each node by recordVisits.
+         * @return            \c false if the words are not compiled or the counts are not of
+         *                    the current nodes.
+         * @sa Dafsa::order
+         */
+        bool orderNodes(const std::vector<std::uint64_t>& visits);
+
+        //! To scan the words of a shared base list together with the words of this list.
+        /**
+         * The compiled automaton of the base is shared, not copied, and walked together with the
+         * automaton of this list, so a text is scanned once for the words of both. The options of
+         * this list apply. The word IDs of the base are kept, the word IDs of this list follow
+         * them. Later changes to the base list do not affect this list.
+         * @param [in] base The base list.
+         * @return          \c false if the base is not compiled, the base is not changed.
+         */
+        bool setBase(const FilterList& base);
+
+        //! To scan the words of this list only.
+        void clearBase();
+
+        //! Whether there is a base list.
+        /**
+         * @return Whether there is a base list.
+         */
+        inline bool hasBase() const { return nullptr != _base; }
+
+        //! The generation of the list, which changes with the words and options.
+        /**
+         * @return The generation.
+         */
+        inline std::uint64_t generation() const { return _generation; }
+
+    private:
+        //! To insert a cleaned up word or pattern into the trie.
+        /**
+         * @param [in] str The word or pattern, wildcards are already translated to
+         *                 CharNode::anyCharacter and CharNode::gapCharacter.
+         * @throw std::bad_alloc The trie would exceed the memory budget, nothing is changed.
+         */
+        void insert(const std::wstring& str);
+
+        //! To restore the trie from the compiled automaton.
+        void decompile();
+
+        //! The number of nodes of the trie which decompile would restore.
+        /**
+         * @return The number of nodes, including the root.
+         */
+        std::size_t decompiledNodeCount() const;
+
+        //! To reject a change which would take more bytes than the memory budget.
+        /**
+         * @param [in] bytes The number of bytes after the change.
+         * @throw std::bad_alloc There is a budget and the bytes exceed it.
+         */
+        void checkBudget(std::size_t bytes) const;
+
+        //! To reject a compiled automaton which would take more bytes than the memory budget.
+        /**
+         * @param [in] dafsa            The automaton.
+         * @param [in] isNumaReplicated Whether it is copied to each NUMA node.
+         * @throw std::bad_alloc There is a budget and the copies exceed it.
+         */
+        void checkBudget(const Dafsa& dafsa, bool isNumaReplicated) const;
+
+        //! To place the compiled automaton by the options, after it is built or loaded.
+        void place();
+
+        //! The copy of an automaton on the NUMA node of the calling thread.
+        /**
+         * @param [in] dafsa    The automaton.
+         * @param [in] replicas The copies on each NUMA node, empty if it is not replicated.
+         * @return              The copy to scan.
+         */
+        static inline const Dafsa& local(
+            const std::shared_ptr<const Dafsa>& dafsa,
+            const std::vector<std::shared_ptr<const Dafsa>>& replicas)
+        {
+            return replicas.empty()
+                   ? *dafsa
+                   : *replicas[NumaMemory::currentNode() % replicas.size()];
+        }
+
+        //! To visit all words and patterns in the sorted order.
+        /**
+         * @param [in] visitor The callable to receive the words and their IDs.
+         */
+        void forEachWord(
+            const std::function<void(const std::wstring&, std::size_t)>& visitor) const;
+
+        //! Whether a word is in an automaton.
+        /**
+         * @param [in] automaton The automaton.
+         * @param [in] word      The characters of the word.
+         * @param [in] size      The length of the word.
+         * @return               Whether the word is in the automaton.
+         */
+        template <typename _Automaton>
+        static bool contains(const _Automaton& automaton, const wchar_t* word, std::size_t size);
+
+        //! The length of the longest prefix of a word which is in an automaton.
+        /**
+         * @param [in] automaton The automaton.
+         * @param [in] word      The word.
+         * @return               The number of characters of the prefix.
+         */
+        template <typename _Automaton>
+        static std::size_t prefixLength(const _Automaton& automaton, const std::wstring& word);
+
     private:
         //! The root CharNode of the filter list.
         std::shared_ptr<CharNode> _root;
+
+        //! The number of nodes of the trie, including the root.
+        std::size_t _trieNodeCount;
+
+        //! The number of words added, used to assign word IDs.
+        std::size_t _wordCount;
+
+        //! The compiled automaton, nullptr if the words are not compiled.
+        std::shared_ptr<const Dafsa> _dafsa;
+
+        //! The options of scanning.
+        ScanOptions _options;
+
+        //! Whether the compiled automaton is placed on huge pages.
+        bool _isHugePage;
+
+        //! Whether the compiled automaton is copied to each NUMA node.
+        bool _isNumaReplicated;
+
+        //! The copies of the compiled automaton on each NUMA node, the first one is _dafsa.
+        std::vector<std::shared_ptr<const Dafsa>> _replicas;
+
+        //! The compiled automaton of the base list, nullptr if there is no base.
+        std::shared_ptr<const Dafsa> _base;
+
+        //! The copies of the base on each NUMA node, as the base list places them.
+        std::vector<std::shared_ptr<const Dafsa>> _baseReplicas;
+
+        //! The number of words of the base list, the offset of the word IDs of this list.
+        std::size_t _baseWordCount;
+
+        //! Whether the base list has any pattern.
+        bool _baseHasPattern;
+
+        //! The maximum number of characters of the words of the base list.
+        std::size_t _baseMaxLength;
+
+        //! The generation of the list, increased on every change of the words and options.
+        std::uint64_t _generation;
+
+        //! The maximum bytes of the trie or the compiled automaton, 0 for no budget.
+        std::size_t _memoryBudget;
     };
+
+
+    template <typename _Visitor>
+    bool FilterList::find(const std::wstring& str, _Visitor&& visitor) const
+    {
+        ScanBuffer buffer;
+        return find(str.data(), str.size(), buffer, std::forward<_Visitor>(visitor));
+    }
+
+    template <typename _Automaton>
+    bool FilterList::contains(const _Automaton& automaton, const wchar_t* word, std::size_t size)
+    {
+        AutomatonState state = automaton.root();
+        for(std::size_t index = 0; index < size; ++index)
+        {
+            if(!automaton.next(state, word[index], state))
+            {
+                return false;
+            }
+        }
+
+        return automaton.isEnd(state);
+    }
+
+    template <typename _Automaton>
+    std::size_t FilterList::prefixLength(const _Automaton& automaton, const std::wstring& word)
+    {
+        AutomatonState state = automaton.root();
+        std::size_t length = 0;
+        while(length < word.size() && automaton.next(state, word[length], state))
+        {
+            ++length;
+        }
+
+        return length;
+    }
+
+    template <typename _Visitor>
+    bool FilterList::find(const wchar_t* str,
+                          std::size_t size,
+                          ScanBuffer& buffer,
+                          _Visitor&& visitor) const
+    {
+        if(nullptr != _base)
+        {
+            ScanOptions options(_options);
+            options._hasPattern = options._hasPattern || _baseHasPattern;
+            options._maxLength = std::max(options._maxLength, _baseMaxLength);
+            const Dafsa& base = local(_base, _baseReplicas);
+            if(nullptr != _dafsa)
+            {
+                LayeredAutomaton<Dafsa> automaton(base, _baseWordCount, local(_dafsa, _replicas));
+                Scanner<LayeredAutomaton<Dafsa>> scanner(automaton, options, buffer);
+                return scanner.scan(str, size, std::forward<_Visitor>(visitor));
+            }
+
+            TrieAutomaton trie(_root.get());
+            LayeredAutomaton<TrieAutomaton> automaton(base, _baseWordCount, trie);
+            Scanner<LayeredAutomaton<TrieAutomaton>> scanner(automaton, options, buffer);
+            return scanner.scan(str, size, std::forward<_Visitor>(visitor));
+        }
+
+        if(nullptr != _dafsa)
+        {
+            Scanner<Dafsa> scanner(local(_dafsa, _replicas), _options, buffer);
+            return scanner.scan(str, size, std::forward<_Visitor>(visitor));
+        }
+
+        TrieAutomaton trie(_root.get());
+        Scanner<TrieAutomaton> scanner(trie, _options, buffer);
+        return scanner.scan(str, size, std::forward<_Visitor>(visitor));
+    }
 } // namespace lakoo
 
 #endif // __LAKOO_FILTER_LIST_H__
@@ -0,0 +1,115 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   heap_size.h
+ * @author Aludirk Wong
+ * @date   2017-08-23
+ */
+
+#ifndef __LAKOO_HEAP_SIZE_H__
+#define __LAKOO_HEAP_SIZE_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace lakoo
+{
+    //! The bytes which the heap takes for the standard containers, the overhead included.
+    /**
+     * The sizes follow the common layouts of the containers and of malloc, a header of a pointer
+     * and the blocks aligned to 2 pointers, so they are estimates, not measurements.
+     */
+    namespace HeapSize
+    {
+        //! The bytes of a heap block.
+        /**
+         * @param [in] size The number of bytes requested.
+         * @return          The bytes taken, 0 for no block.
+         */
+        inline std::size_t block(std::size_t size)
+        {
+            const std::size_t alignment = 2 * sizeof(void*);
+            return 0 == size ? 0 : (size + sizeof(void*) + alignment - 1) / alignment * alignment;
+        }
+
+        //! The bytes of a node of std::map, a color and 3 links before the value.
+        /**
+         * @tparam _Value The type of the values.
+         * @return        The bytes of a node.
+         */
+        template <typename _Value>
+        inline std::size_t treeNode()
+        {
+            return block(4 * sizeof(void*) + sizeof(_Value));
+        }
+
+        //! The bytes of a node of std::list, 2 links before the value.
+        /**
+         * @tparam _Value The type of the values.
+         * @return        The bytes of a node.
+         */
+        template <typename _Value>
+        inline std::size_t listNode()
+        {
+            return block(2 * sizeof(void*) + sizeof(_Value));
+        }
+
+        //! The bytes of a node of std::unordered_map, a link before the value.
+        /**
+         * @tparam _Value The type of the values.
+         * @return        The bytes of a node.
+         */
+        template <typename _Value>
+        inline std::size_t hashNode()
+        {
+            return block(sizeof(void*) + sizeof(_Value));
+        }
+
+        //! The bytes of the characters of a string, 0 if they are kept in the string itself.
+        /**
+         * @param [in] str The string.
+         * @return         The bytes on the heap.
+         */
+        template <typename _Char>
+        inline std::size_t string(const std::basic_string<_Char>& str)
+        {
+            const char* data = reinterpret_cast<const char*>(str.data());
+            const char* self = reinterpret_cast<const char*>(&str);
+            return data >= self && data < self + sizeof(str)
+                   ? 0
+                   : block((str.capacity() + 1) * sizeof(_Char));
+        }
+
+        //! The bytes of the values of a vector.
+        /**
+         * @param [in] values The vector.
+         * @return            The bytes on the heap.
+         */
+        template <typename _Value, typename _Allocator>
+        inline std::size_t vector(const std::vector<_Value, _Allocator>& values)
+        {
+            return block(values.capacity() * sizeof(_Value));
+        }
+    } // namespace HeapSize
+} // namespace lakoo
+
+#endif // __LAKOO_HEAP_SIZE_H__
@@ -0,0 +1,142 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   hit_sketch.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-16
+ */
+
+#include "hit_sketch.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+
+using namespace lakoo;
+using namespace std;
+
+
+HitSketch::HitSketch(std::size_t width)
+: _width(1)
+, _shift(64)
+, _shardSize(0)
+, _counters()
+{
+    while(_width < width)
+    {
+        _width <<= 1;
+        --_shift;
+    }
+
+    if(1 == _width)
+    {
+        // A shift of 64 bits is undefined, keep 2 columns.
+        _width = 2;
+        _shift = 63;
+    }
+
+    // 16 counters of padding fill a cache line of 64 bytes.
+    _shardSize = depth * _width + 16;
+    const size_t size = shardCount * _shardSize;
+    _counters.reset(new atomic<uint32_t>[size]);
+    for(size_t index = 0; index < size; ++index)
+    {
+        _counters[index].store(0, memory_order_relaxed);
+    }
+}
+
+std::uint64_t HitSketch::estimate(std::size_t wordId) const
+{
+    uint64_t result = numeric_limits<uint64_t>::max();
+    for(size_t row = 0; row < depth; ++row)
+    {
+        const size_t offset = row * _width + column(row, wordId);
+        uint64_t sum = 0;
+        for(size_t shard = 0; shard < shardCount; ++shard)
+        {
+            sum += _counters[shard * _shardSize + offset].load(memory_order_relaxed);
+        }
+        result = min(result, sum);
+    }
+
+    return result;
+}
+
+std::vector<lakoo::WordHits> HitSketch::top(std::size_t count, std::size_t wordCount) const
+{
+    const vector<uint64_t> rows = merge();
+    auto isMore = [](const WordHits& left, const WordHits& right)
+    {
+        return left._hits > right._hits ||
+               (left._hits == right._hits && left._wordId < right._wordId);
+    };
+
+    // A min-heap of the best words so far.
+    priority_queue<WordHits, vector<WordHits>, decltype(isMore)> heap(isMore);
+    for(size_t wordId = 0; 0 != count && wordId < wordCount; ++wordId)
+    {
+        uint64_t hits = numeric_limits<uint64_t>::max();
+        for(size_t row = 0; row < depth; ++row)
+        {
+            hits = min(hits, rows[row * _width + column(row, wordId)]);
+        }
+
+        if(0 == hits)
+        {
+            continue;
+        }
+
+        const WordHits word = {wordId, hits};
+        if(heap.size() < count)
+        {
+            heap.push(word);
+        }
+        else if(isMore(word, heap.top()))
+        {
+            heap.pop();
+            heap.push(word);
+        }
+    }
+
+    vector<WordHits> result(heap.size());
+    for(auto word = result.rbegin(); word != result.rend(); ++word)
+    {
+        *word = heap.top();
+        heap.pop();
+    }
+
+    return result;
+}
+
+std::vector<std::uint64_t> HitSketch::merge() const
+{
+    vector<uint64_t> rows(depth * _width, 0);
+    for(size_t shard = 0; shard < shardCount; ++shard)
+    {
+        const atomic<uint32_t>* counters = _counters.get() + shard * _shardSize;
+        for(size_t index = 0; index < rows.size(); ++index)
+        {
+            rows[index] += counters[index].load(memory_order_relaxed);
+        }
+    }
+
+    return rows;
+}
@@ -0,0 +1,181 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   hit_sketch.h
+ * @author Aludirk Wong
+ * @date   2017-08-16
+ */
+
+#ifndef __LAKOO_HIT_SKETCH_H__
+#define __LAKOO_HIT_SKETCH_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "heap_size.h"
+#include "statistics_counters.h"
+#include "text_purifier.h"
+
+
+namespace lakoo
+{
+    //! To add 1 to a counter unless it is already at its maximum, instead of wrapping to 0.
+    /**
+     * @param [in,out] counter The counter.
+     */
+    template <typename _Type>
+    inline void saturatingIncrement(std::atomic<_Type>& counter)
+    {
+        _Type value = counter.load(std::memory_order_relaxed);
+        while(std::numeric_limits<_Type>::max() != value &&
+              !counter.compare_exchange_weak(value,
+                                             static_cast<_Type>(value + 1),
+                                             std::memory_order_relaxed))
+        {
+        }
+    }
+
+    //! The count-min sketch of the number of hits of each word ID.
+    /**
+     * The sketch has #depth rows of counters, a hit adds 1 to one counter of every row picked by
+     * a different hash of the word ID, and the estimate is the minimum of them, so it is never
+     * less than the real number. Each thread adds to its own copy of the rows, the copies are
+     * only summed up by the queries, so the threads do not share any cache line while scanning.
+     * The memory is fixed to <tt>shardCount * depth * width</tt> counters. A counter stops at
+     * 2^32 - 1 rather than wrapping, the threads after the first #shardCount share the copies.
+     */
+    class HitSketch final
+    {
+    public:
+        //! The number of rows.
+        static const std::size_t depth = 4;
+
+        //! The number of copies of the rows.
+        static const std::size_t shardCount = 16;
+
+    public:
+        //! Constructor.
+        /**
+         * @param [in] width The number of counters in a row, rounded up to a power of 2.
+         */
+        explicit HitSketch(std::size_t width);
+
+        //! Default destructor.
+        ~HitSketch() = default;
+
+        //! Deleted copy constructor.
+        HitSketch(const HitSketch&) = delete;
+
+        //! Deleted assignment operator.
+        HitSketch& operator=(const HitSketch&) = delete;
+
+    public:
+        //! The number of counters in a row.
+        /**
+         * @return The width.
+         */
+        inline std::size_t width() const { return _width; }
+
+        //! To add a hit of a word from the current thread.
+        /**
+         * @param [in] wordId The word ID.
+         */
+        inline void add(std::size_t wordId)
+        {
+            std::atomic<std::uint32_t>* counters =
+                _counters.get() + (threadIndex() % shardCount) * _shardSize;
+            for(std::size_t row = 0; row < depth; ++row, counters += _width)
+            {
+                saturatingIncrement(counters[column(row, wordId)]);
+            }
+        }
+
+        //! The estimated number of hits of a word.
+        /**
+         * @param [in] wordId The word ID.
+         * @return            The estimated number of hits, never less than the real number
+         *                    unless a counter has stopped at its maximum.
+         */
+        std::uint64_t estimate(std::size_t wordId) const;
+
+        //! The words of the most hits.
+        /**
+         * @param [in] count     The maximum number of words to return.
+         * @param [in] wordCount The number of word IDs to consider.
+         * @return               The words with hits, in descending order of the hits.
+         */
+        std::vector<WordHits> top(std::size_t count, std::size_t wordCount) const;
+
+        //! The bytes of the sketch on the heap, the sketch itself included.
+        /**
+         * @return The number of bytes, estimated by HeapSize.
+         */
+        inline std::size_t memoryUsage() const
+        {
+            return HeapSize::block(sizeof(HitSketch)) +
+                   HeapSize::block(shardCount * _shardSize * sizeof(std::atomic<std::uint32_t>));
+        }
+
+    private:
+        //! The column of a word ID in a row.
+        /**
+         * @param [in] row    The row.
+         * @param [in] wordId The word ID.
+         * @return            The column.
+         */
+        inline std::size_t column(std::size_t row, std::size_t wordId) const
+        {
+            // Multiply-shift hashing, one odd multiplier for each row.
+            static const std::uint64_t multipliers[depth] = {
+                0x9E3779B97F4A7C15ULL,
+                0xC2B2AE3D27D4EB4FULL,
+                0x165667B19E3779F9ULL,
+                0xD6E8FEB86659FD93ULL
+            };
+            return static_cast<std::size_t>(
+                ((static_cast<std::uint64_t>(wordId) + 1) * multipliers[row]) >> _shift);
+        }
+
+        //! To sum up the rows of all the copies.
+        /**
+         * @return The summed rows, #depth rows of #width counters.
+         */
+        std::vector<std::uint64_t> merge() const;
+
+    private:
+        //! The number of counters in a row.
+        std::size_t _width;
+
+        //! The shift of the hash to the range of the columns.
+        unsigned _shift;
+
+        //! The distance between two copies of the rows, padded to separate cache lines.
+        std::size_t _shardSize;
+
+        //! The counters.
+        std::unique_ptr<std::atomic<std::uint32_t>[]> _counters;
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_HIT_SKETCH_H__
@@ -0,0 +1,113 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   latency_histogram.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-17
+ */
+
+#include "latency_histogram.h"
+
+
+using namespace lakoo;
+using namespace std;
+
+
+LatencyHistogram::LatencyHistogram()
+: _counts()
+{
+    clear();
+}
+
+void LatencyHistogram::mergeTo(std::vector<std::uint64_t>& counts) const
+{
+    for(size_t index = 0; index < bucketCount; ++index)
+    {
+        counts[index] += _counts[index].load(memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::clear()
+{
+    for(atomic<uint32_t>& count : _counts)
+    {
+        count.store(0, memory_order_relaxed);
+    }
+}
+
+lakoo::LatencyStatistics LatencyHistogram::summarize(const std::vector<std::uint64_t>& counts,
+                                                     double tickLength)
+{
+    LatencyStatistics statistics = {0, 0, 0, 0, 0, 0};
+    for(uint64_t count : counts)
+    {
+        statistics._count += count;
+    }
+
+    if(0 == statistics._count)
+    {
+        return statistics;
+    }
+
+    struct Percentile
+    {
+        uint64_t _rank;
+        uint64_t* _value;
+    };
+
+    // The rank of a percentile is the smallest count covering it, so p99.9 of 10 values is the
+    // maximum.
+    const uint64_t total = statistics._count;
+    const Percentile percentiles[] = {
+        {(total * 500 + 999) / 1000, &statistics._p50},
+        {(total * 900 + 999) / 1000, &statistics._p90},
+        {(total * 990 + 999) / 1000, &statistics._p99},
+        {(total * 999 + 999) / 1000, &statistics._p999},
+        {total, &statistics._max}
+    };
+
+    uint64_t seen = 0;
+    size_t next = 0;
+    for(size_t index = 0; index < bucketCount && next < 5; ++index)
+    {
+        seen += counts[index];
+        const uint64_t value =
+            static_cast<uint64_t>(static_cast<double>(highestValue(index)) * tickLength);
+        while(next < 5 && seen >= percentiles[next]._rank)
+        {
+            *percentiles[next]._value = value;
+            ++next;
+        }
+    }
+
+    return statistics;
+}
+
+std::uint64_t LatencyHistogram::highestValue(std::size_t index)
+{
+    if(index < 64)
+    {
+        return index;
+    }
+
+    const size_t shift = index / 32 - 1;
+    const uint64_t subBucket = index % 32 + 32;
+    return ((subBucket + 1) << shift) - 1;
+}
@@ -0,0 +1,133 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   latency_histogram.h
+ * @author Aludirk Wong
+ * @date   2017-08-17
+ */
+
+#ifndef __LAKOO_LATENCY_HISTOGRAM_H__
+#define __LAKOO_LATENCY_HISTOGRAM_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "text_purifier.h"
+
+
+namespace lakoo
+{
+    //! The histogram of latencies in ticks with a bounded relative error, like HdrHistogram.
+    /**
+     * The values below 64 have their own buckets. Above that, each power of 2 is split into 32
+     * buckets, so a value is reported within 1/32 of the real one, up to 2^36 ticks, about 20
+     * seconds of the time stamp counter. The histogram takes 4 KB whatever the values are.
+     */
+    class LatencyHistogram final
+    {
+    public:
+        //! The number of buckets.
+        static const std::size_t bucketCount = 1024;
+
+    public:
+        //! Default constructor.
+        LatencyHistogram();
+
+        //! Default destructor.
+        ~LatencyHistogram() = default;
+
+        //! Deleted copy constructor.
+        LatencyHistogram(const LatencyHistogram&) = delete;
+
+        //! Deleted assignment operator.
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    public:
+        //! To record a value.
+        /**
+         * @param [in] value The value in ticks.
+         */
+        inline void add(std::uint64_t value)
+        {
+            _counts[index(value)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //! To add the counts of the buckets to the given counts.
+        /**
+         * @param [in,out] counts The counts of #bucketCount buckets.
+         */
+        void mergeTo(std::vector<std::uint64_t>& counts) const;
+
+        //! To reset all the buckets to 0.
+        void clear();
+
+        //! To summarize the counts of the buckets.
+        /**
+         * @param [in] counts     The counts of #bucketCount buckets.
+         * @param [in] tickLength The nanoseconds per tick.
+         * @return                The LatencyStatistics in nanoseconds.
+         */
+        static LatencyStatistics summarize(const std::vector<std::uint64_t>& counts,
+                                           double tickLength);
+
+    private:
+        //! The bucket of a value.
+        /**
+         * @param [in] value The value.
+         * @return           The index of the bucket.
+         */
+        static inline std::size_t index(std::uint64_t value)
+        {
+            const std::uint64_t maxValue = (std::uint64_t(1) << 36) - 1;
+            if(value > maxValue)
+            {
+                value = maxValue;
+            }
+
+#if defined(__GNUC__)
+            const std::size_t length = 64 - __builtin_clzll(value | 1);
+            const std::size_t shift = length > 6 ? length - 6 : 0;
+#else
+            std::size_t shift = 0;
+            while((value >> shift) >= 64)
+            {
+                ++shift;
+            }
+#endif
+
+            return shift * 32 + static_cast<std::size_t>(value >> shift);
+        }
+
+        //! The highest value of a bucket.
+        /**
+         * @param [in] index The index of the bucket.
+         * @return           The highest value in the bucket.
+         */
+        static std::uint64_t highestValue(std::size_t index);
+
+    private:
+        //! The counts of the buckets.
+        std::atomic<std::uint32_t> _counts[bucketCount];
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_LATENCY_HISTOGRAM_H__
@@ -0,0 +1,256 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   layered_automaton.h
+ * @author Aludirk Wong
+ * @date   2017-08-22
+ */
+
+#ifndef __LAKOO_LAYERED_AUTOMATON_H__
+#define __LAKOO_LAYERED_AUTOMATON_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "dafsa.h"
+#include "scan_buffer.h"
+#include "trie_automaton.h"
+
+
+namespace lakoo
+{
+    //! The union of a shared base Dafsa and an overlay automaton, walked together by the Scanner.
+    /**
+     * A state is the pair of the states of both layers: the base state is packed into
+     * AutomatonState::_node and the overlay state into AutomatonState::_rank, a layer which has
+     * no edge for the text any more is marked dead. So the text is scanned once for the words of
+     * both layers, with the same options and match semantics as a single list. The word IDs of
+     * the base are kept, the word IDs of the overlay follow them.
+     * @tparam _Overlay The overlay automaton, Dafsa or TrieAutomaton.
+     */
+    template <typename _Overlay>
+    class LayeredAutomaton final
+    {
+    public:
+        //! Constructor.
+        /**
+         * @param [in] base          The base automaton.
+         * @param [in] baseWordCount The number of word IDs of the base.
+         * @param [in] overlay       The overlay automaton.
+         */
+        LayeredAutomaton(const Dafsa& base, std::size_t baseWordCount, const _Overlay& overlay)
+        : _base(base)
+        , _baseWordCount(baseWordCount)
+        , _overlay(overlay)
+        {
+        }
+
+        //! Default destructor.
+        ~LayeredAutomaton() = default;
+
+        //! Deleted copy constructor.
+        LayeredAutomaton(const LayeredAutomaton&) = delete;
+
+        //! Deleted assignment operator.
+        LayeredAutomaton& operator=(const LayeredAutomaton&) = delete;
+
+    public:
+        //! The state of the root.
+        /**
+         * @return The state of the root.
+         */
+        inline AutomatonState root() const
+        {
+            return AutomatonState{pack(_base, _base.root()), pack(_overlay, _overlay.root())};
+        }
+
+        //! To follow the edge of a character in both layers.
+        /**
+         * @param [in]  current   The current state.
+         * @param [in]  character The character of the edge.
+         * @param [out] next      The next state, unchanged if neither layer has such edge.
+         * @return                Whether the edge exists in any layer.
+         */
+        inline bool next(const AutomatonState& current,
+                         wchar_t character,
+                         AutomatonState& next) const
+        {
+            AutomatonState state;
+            const std::uint64_t base =
+                dead != current._node && _base.next(unpack(_base, current._node), character, state)
+                ? pack(_base, state)
+                : dead;
+            const std::uint64_t overlay =
+                dead != current._rank &&
+                _overlay.next(unpack(_overlay, current._rank), character, state)
+                ? pack(_overlay, state)
+                : dead;
+            if(dead == base && dead == overlay)
+            {
+                return false;
+            }
+
+            next = AutomatonState{base, overlay};
+            return true;
+        }
+
+        //! To follow a chain of single edges at once, while only one layer is alive.
+        /**
+         * @param [in,out] current The current state.
+         * @param [in]     text    The text after the current state.
+         * @param [in]     size    The length of the text.
+         * @return                 The number of characters matched.
+         */
+        inline std::size_t follow(AutomatonState& current,
+                                  const wchar_t* text,
+                                  std::size_t size) const
+        {
+            if(dead == current._rank)
+            {
+                AutomatonState state = unpack(_base, current._node);
+                const std::size_t count = _base.follow(state, text, size);
+                current._node = pack(_base, state);
+                return count;
+            }
+
+            if(dead == current._node)
+            {
+                AutomatonState state = unpack(_overlay, current._rank);
+                const std::size_t count = _overlay.follow(state, text, size);
+                current._rank = pack(_overlay, state);
+                return count;
+            }
+
+            return 0;
+        }
+
+        //! Whether a word of any layer ends at the state.
+        /**
+         * @param [in] current The state.
+         * @return             Whether a word ends at the state.
+         */
+        inline bool isEnd(const AutomatonState& current) const
+        {
+            return (dead != current._node && _base.isEnd(unpack(_base, current._node))) ||
+                   (dead != current._rank && _overlay.isEnd(unpack(_overlay, current._rank)));
+        }
+
+        //! The ID of the word which ends at the state, the base word if both layers have one.
+        /**
+         * @param [in] current The state, a word must end at it.
+         * @return             The word ID.
+         */
+        inline std::size_t wordId(const AutomatonState& current) const
+        {
+            if(dead != current._node && _base.isEnd(unpack(_base, current._node)))
+            {
+                return _base.wordId(unpack(_base, current._node));
+            }
+
+            return _baseWordCount + _overlay.wordId(unpack(_overlay, current._rank));
+        }
+
+        //! To visit all edges of a state, the edges of the same character in both layers once.
+        /**
+         * @param [in] current The state.
+         * @param [in] visitor The callable with signature
+         *                     <tt>void(wchar_t character, const AutomatonState& next)</tt>.
+         */
+        template <typename _Visitor>
+        void forEachNext(const AutomatonState& current, _Visitor&& visitor) const
+        {
+            const bool isBaseAlive = dead != current._node;
+            const bool isOverlayAlive = dead != current._rank;
+            const AutomatonState base =
+                isBaseAlive ? unpack(_base, current._node) : AutomatonState{};
+            const AutomatonState overlay =
+                isOverlayAlive ? unpack(_overlay, current._rank) : AutomatonState{};
+
+            if(isBaseAlive)
+            {
+                _base.forEachNext(base, [&](wchar_t character, const AutomatonState& next)
+                {
+                    AutomatonState state;
+                    const std::uint64_t overlayNext =
+                        isOverlayAlive && _overlay.next(overlay, character, state)
+                        ? pack(_overlay, state)
+                        : dead;
+                    visitor(character, AutomatonState{pack(_base, next), overlayNext});
+                });
+            }
+
+            if(isOverlayAlive)
+            {
+                _overlay.forEachNext(overlay, [&](wchar_t character, const AutomatonState& next)
+                {
+                    AutomatonState state;
+                    if(!isBaseAlive || !_base.next(base, character, state))
+                    {
+                        visitor(character, AutomatonState{dead, pack(_overlay, next)});
+                    }
+                });
+            }
+        }
+
+    private:
+        //! The mark of a layer without any path for the text.
+        static const std::uint64_t dead = ~static_cast<std::uint64_t>(0);
+
+        //! To pack a Dafsa state, the node index and the rank both fit in 32 bits.
+        static inline std::uint64_t pack(const Dafsa&, const AutomatonState& state)
+        {
+            return state._node | (state._rank << 32);
+        }
+
+        //! To pack a TrieAutomaton state, its rank is always 0.
+        static inline std::uint64_t pack(const TrieAutomaton&, const AutomatonState& state)
+        {
+            return state._node;
+        }
+
+        //! To unpack a Dafsa state.
+        static inline AutomatonState unpack(const Dafsa&, std::uint64_t value)
+        {
+            return AutomatonState{value & 0xFFFFFFFF, value >> 32};
+        }
+
+        //! To unpack a TrieAutomaton state.
+        static inline AutomatonState unpack(const TrieAutomaton&, std::uint64_t value)
+        {
+            return AutomatonState{value, 0};
+        }
+
+    private:
+        //! The base automaton.
+        const Dafsa& _base;
+
+        //! The number of word IDs of the base, the offset of the word IDs of the overlay.
+        const std::size_t _baseWordCount;
+
+        //! The overlay automaton.
+        const _Overlay& _overlay;
+    };
+
+
+    template <typename _Overlay>
+    const std::uint64_t LayeredAutomaton<_Overlay>::dead;
+} // namespace lakoo
+
+#endif // __LAKOO_LAYERED_AUTOMATON_H__
@@ -0,0 +1,116 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   mask_policy.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-23
+ */
+
+#include "mask_policy.h"
+
+#include "string_utils.h"
+
+
+using namespace lakoo;
+using namespace lakoo::StringUtils;
+using namespace std;
+
+
+namespace
+{
+    //! To convert a UTF-16 mask to a wide string.
+    inline wstring toWStr(const u16string& mask)
+    {
+        wstring result;
+        utf16ToWStr(mask.data(), mask.size(), result);
+        return result;
+    }
+}
+
+
+MaskTable::MaskTable(const std::vector<std::size_t>& categories,
+                     const std::vector<std::wstring>& masks,
+                     bool isMatchSize)
+: _masks()
+, _categories(categories)
+, _isMatchSize(isMatchSize)
+, _callback(nullptr)
+, _context(nullptr)
+{
+    for(const wstring& mask : masks)
+    {
+        Mask prepared;
+        prepared._wide = isMatchSize ? mask.substr(0, 1) : mask;
+        wStrToUtf8(prepared._wide.data(), prepared._wide.size(), prepared._utf8);
+        wStrToUtf16(prepared._wide.data(), prepared._wide.size(), prepared._utf16);
+        _masks.push_back(move(prepared));
+    }
+
+    if(_masks.empty())
+    {
+        _masks.emplace_back();
+    }
+}
+
+MaskTable::MaskTable(MaskPolicy::MaskCallback callback, void* context)
+: _masks(1)
+, _categories()
+, _isMatchSize(false)
+, _callback(callback)
+, _context(context)
+{
+}
+
+MaskPolicy::MaskPolicy(const std::wstring& mask)
+: _table(unique_ptr<MaskTable>(new MaskTable(vector<size_t>(), vector<wstring>{mask}, false)))
+{
+}
+
+MaskPolicy::MaskPolicy(const std::string& mask)
+: MaskPolicy(strToWStr(mask))
+{
+}
+
+MaskPolicy::MaskPolicy(const std::u16string& mask)
+: MaskPolicy(toWStr(mask))
+{
+}
+
+MaskPolicy::MaskPolicy(wchar_t mask)
+: _table(unique_ptr<MaskTable>(
+      new MaskTable(vector<size_t>(), vector<wstring>{wstring(1, mask)}, true)))
+{
+}
+
+MaskPolicy::MaskPolicy(const std::vector<std::size_t>& categories,
+                       const std::vector<std::wstring>& masks,
+                       bool isMatchSize)
+: _table(unique_ptr<MaskTable>(new MaskTable(categories, masks, isMatchSize)))
+{
+}
+
+MaskPolicy::MaskPolicy(MaskCallback callback, void* context)
+: _table(unique_ptr<MaskTable>(new MaskTable(callback, context)))
+{
+}
+
+MaskPolicy::~MaskPolicy()
+{
+}
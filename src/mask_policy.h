@@ -0,0 +1,120 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   mask_policy.h
+ * @author Aludirk Wong
+ * @date   2017-08-23
+ */
+
+#ifndef __LAKOO_MASK_POLICY_H__
+#define __LAKOO_MASK_POLICY_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "text_purifier.h"
+
+
+namespace lakoo
+{
+    //! The masks of a MaskPolicy, prepared in each encoding of the output.
+    struct MaskTable final
+    {
+    public:
+        //! A mask in each encoding.
+        struct Mask final
+        {
+            //! The wide mask.
+            std::wstring _wide;
+
+            //! The UTF-8 mask.
+            std::string _utf8;
+
+            //! The UTF-16 mask.
+            std::u16string _utf16;
+        };
+
+    public:
+        //! The mask of each category, there is at least one.
+        std::vector<Mask> _masks;
+
+        //! The category of each word ID.
+        std::vector<std::size_t> _categories;
+
+        //! Whether a mask is repeated for each character of a span, the masks are cut to their
+        //! first characters then.
+        bool _isMatchSize;
+
+        //! The callback to write the masks instead, nullptr if there is none.
+        MaskPolicy::MaskCallback _callback;
+
+        //! The user context passed to the callback.
+        void* _context;
+
+    public:
+        //! Constructor.
+        /**
+         * @param [in] categories  The category of each word ID.
+         * @param [in] masks       The mask of each category.
+         * @param [in] isMatchSize Whether a mask is repeated for each character of a span.
+         */
+        MaskTable(const std::vector<std::size_t>& categories,
+                  const std::vector<std::wstring>& masks,
+                  bool isMatchSize);
+
+        //! Constructor of the masks written by a callback.
+        /**
+         * @param [in] callback The callback.
+         * @param [in] context  The user context passed to the callback.
+         */
+        MaskTable(MaskPolicy::MaskCallback callback, void* context);
+
+        //! Default destructor.
+        ~MaskTable() = default;
+
+        //! Deleted copy constructor.
+        MaskTable(const MaskTable&) = delete;
+
+        //! Deleted assignment operator.
+        MaskTable& operator=(const MaskTable&) = delete;
+
+    public:
+        //! The mask of the word of a span.
+        /**
+         * @param [in] wordId The word ID.
+         * @return            The mask of its category, the mask of the category 0 if the category
+         *                    has none.
+         */
+        inline const Mask& mask(std::size_t wordId) const
+        {
+            const std::size_t category = wordId < _categories.size() ? _categories[wordId] : 0;
+            return category < _masks.size() ? _masks[category] : _masks[0];
+        }
+
+        //! Whether the results can be cached as the results of a plain mask.
+        /**
+         * @return Whether there is a single mask and no callback.
+         */
+        inline bool isCacheable() const { return nullptr == _callback && 1 == _masks.size(); }
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_MASK_POLICY_H__
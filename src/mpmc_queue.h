@@ -0,0 +1,206 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   mpmc_queue.h
+ * @author Aludirk Wong
+ * @date   2017-08-21
+ */
+
+#ifndef __LAKOO_MPMC_QUEUE_H__
+#define __LAKOO_MPMC_QUEUE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+
+namespace lakoo
+{
+    //! The bounded lock-free queue of many producers and many consumers.
+    /**
+     * The values are kept in a ring of cells, each with a sequence number telling whether it is
+     * free for the producer of a position or filled for the consumer of it. A producer or a
+     * consumer only contends on its own end with a compare-and-swap, and never waits for a lock.
+     * @tparam _Type The type of the values, default constructible and movable.
+     */
+    template <typename _Type>
+    class MpmcQueue final
+    {
+    public:
+        //! Constructor.
+        /**
+         * @param [in] capacity The maximum number of values, rounded up to a power of 2.
+         */
+        explicit MpmcQueue(std::size_t capacity)
+        : _cells()
+        , _mask(1)
+        , _head()
+        , _tail()
+        {
+            while(_mask + 1 < capacity)
+            {
+                _mask = (_mask << 1) | 1;
+            }
+
+            _cells.reset(new Cell[_mask + 1]);
+            for(std::size_t index = 0; index <= _mask; ++index)
+            {
+                _cells[index]._sequence.store(index, std::memory_order_relaxed);
+            }
+            _head._position.store(0, std::memory_order_relaxed);
+            _tail._position.store(0, std::memory_order_relaxed);
+        }
+
+        //! Default destructor.
+        ~MpmcQueue() = default;
+
+        //! Deleted copy constructor.
+        MpmcQueue(const MpmcQueue&) = delete;
+
+        //! Deleted assignment operator.
+        MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    public:
+        //! The maximum number of values.
+        /**
+         * @return The maximum number of values.
+         */
+        inline std::size_t capacity() const
+        {
+            return _mask + 1;
+        }
+
+        //! To push a value if the queue is not full.
+        /**
+         * @param [in,out] value The value, moved into the queue if it is pushed.
+         * @return               \c false if the queue is full.
+         */
+        bool tryPush(_Type& value)
+        {
+            std::size_t position = _head._position.load(std::memory_order_relaxed);
+            Cell* cell = nullptr;
+            for(;;)
+            {
+                cell = &_cells[position & _mask];
+                const std::size_t sequence = cell->_sequence.load(std::memory_order_acquire);
+                const std::intptr_t difference =
+                    static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+                if(0 == difference)
+                {
+                    if(_head._position.compare_exchange_weak(position,
+                                                             position + 1,
+                                                             std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if(difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = _head._position.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->_value = std::move(value);
+            cell->_sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        //! To pop a value if the queue is not empty.
+        /**
+         * @param [out] value The value popped.
+         * @return            \c false if the queue is empty.
+         */
+        bool tryPop(_Type& value)
+        {
+            std::size_t position = _tail._position.load(std::memory_order_relaxed);
+            Cell* cell = nullptr;
+            for(;;)
+            {
+                cell = &_cells[position & _mask];
+                const std::size_t sequence = cell->_sequence.load(std::memory_order_acquire);
+                const std::intptr_t difference =
+                    static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+                if(0 == difference)
+                {
+                    if(_tail._position.compare_exchange_weak(position,
+                                                             position + 1,
+                                                             std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if(difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = _tail._position.load(std::memory_order_relaxed);
+                }
+            }
+
+            value = std::move(cell->_value);
+            cell->_sequence.store(position + _mask + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        //! A slot of the ring.
+        struct Cell
+        {
+            //! The position it is free for plus 1 once it is filled.
+            std::atomic<std::size_t> _sequence;
+
+            //! The value.
+            _Type _value;
+        };
+
+        //! An end of the queue, on a cache line of its own.
+        struct End
+        {
+            //! The padding to keep the end out of the cache line of the previous member.
+            char _padding[64];
+
+            //! The next position.
+            std::atomic<std::size_t> _position;
+        };
+
+    private:
+        //! The ring of cells.
+        std::unique_ptr<Cell[]> _cells;
+
+        //! The capacity minus 1.
+        std::size_t _mask;
+
+        //! The end to push.
+        End _head;
+
+        //! The end to pop.
+        End _tail;
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_MPMC_QUEUE_H__
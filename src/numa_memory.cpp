@@ -0,0 +1,274 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   numa_memory.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-23
+ */
+
+#include "numa_memory.h"
+
+#include <algorithm>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+using namespace lakoo;
+using namespace std;
+
+
+namespace
+{
+    //! The path of the NUMA topology.
+    const string nodePath = "/sys/devices/system/node/";
+
+    //! The NUMA topology of the host.
+    struct Topology final
+    {
+        //! The number of NUMA nodes.
+        size_t _nodeCount;
+
+        //! The NUMA node of each core.
+        vector<size_t> _nodes;
+    };
+
+    //! To parse a list of ranges such as "0-3,8,10-11".
+    /**
+     * @param [in] text The list.
+     * @return          The numbers.
+     */
+    vector<size_t> parseList(const string& text)
+    {
+        vector<size_t> result;
+        istringstream stream(text);
+        string range;
+        while(getline(stream, range, ','))
+        {
+            const size_t dash = range.find('-');
+            try
+            {
+                const size_t first = stoul(range.substr(0, dash));
+                const size_t last = string::npos != dash ? stoul(range.substr(dash + 1)) : first;
+                for(size_t number = first; number <= last; ++number)
+                {
+                    result.push_back(number);
+                }
+            }
+            catch(const exception&)
+            {
+                // A malformed range is skipped.
+            }
+        }
+        return result;
+    }
+
+    //! To read the list of a file of the topology.
+    /**
+     * @param [in] path The path of the file.
+     * @return          The numbers, empty if the file cannot be read.
+     */
+    vector<size_t> readList(const string& path)
+    {
+        ifstream file(path);
+        string text;
+        getline(file, text);
+        return parseList(text);
+    }
+
+    //! To read the topology of the host.
+    /**
+     * @return The Topology.
+     */
+    Topology readTopology()
+    {
+        Topology topology{1, vector<size_t>()};
+        const vector<size_t> nodes = readList(nodePath + "online");
+        if(nodes.empty())
+        {
+            return topology;
+        }
+
+        // The nodes are numbered by their maximum, a gap is an offline node without cores.
+        topology._nodeCount = *max_element(nodes.begin(), nodes.end()) + 1;
+        for(size_t node : nodes)
+        {
+            for(size_t core : readList(nodePath + "node" + to_string(node) + "/cpulist"))
+            {
+                if(topology._nodes.size() <= core)
+                {
+                    topology._nodes.resize(core + 1, 0);
+                }
+                topology._nodes[core] = node;
+            }
+        }
+        return topology;
+    }
+
+    //! The topology of the host, read once.
+    /**
+     * @return The Topology.
+     */
+    const Topology& topology()
+    {
+        static const Topology result = readTopology();
+        return result;
+    }
+
+    //! Whether the memory of a placement is mapped on its own pages instead of operator new.
+    /**
+     * @param [in] placement The PagePlacement.
+     * @return               Whether it is mapped.
+     */
+    inline bool isMapped(const PagePlacement& placement)
+    {
+#ifdef __linux__
+        return placement._isHugePage || 0 <= placement._numaNode;
+#else
+        (void)placement;
+        return false;
+#endif
+    }
+
+#ifdef __linux__
+    //! Whether an allocation uses huge pages.
+    /**
+     * @param [in] size      The number of bytes.
+     * @param [in] placement The PagePlacement.
+     * @return               Whether it uses huge pages.
+     */
+    inline bool isHugePage(size_t size, const PagePlacement& placement)
+    {
+        return placement._isHugePage && size >= NumaMemory::hugePageSize / 2;
+    }
+
+    //! The number of bytes mapped for an allocation.
+    /**
+     * @param [in] size      The number of bytes.
+     * @param [in] placement The PagePlacement.
+     * @return               The number of bytes rounded up to the pages.
+     */
+    inline size_t mappedSize(size_t size, const PagePlacement& placement)
+    {
+        const size_t pageSize = isHugePage(size, placement)
+                                ? NumaMemory::hugePageSize
+                                : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return (max<size_t>(size, 1) + pageSize - 1) / pageSize * pageSize;
+    }
+
+    //! To prefer a NUMA node for the pages of a mapping, before they are touched.
+    /**
+     * @param [in] data The mapping.
+     * @param [in] size The number of bytes of the mapping.
+     * @param [in] node The NUMA node.
+     */
+    void bindNode(void* data, size_t size, size_t node)
+    {
+        // The policy of mbind(2), without depending on libnuma.
+        const int preferredPolicy = 1;
+        const size_t bitsPerWord = sizeof(unsigned long) * 8;
+        vector<unsigned long> mask(node / bitsPerWord + 1, 0);
+        mask[node / bitsPerWord] |= 1UL << (node % bitsPerWord);
+
+        // It only fails on hosts without NUMA, where the placement does not matter.
+        syscall(SYS_mbind, data, size, preferredPolicy, mask.data(),
+                mask.size() * bitsPerWord + 1, 0);
+    }
+#endif
+}
+
+
+std::size_t NumaMemory::nodeCount()
+{
+    return topology()._nodeCount;
+}
+
+std::size_t NumaMemory::currentNode()
+{
+#ifdef __linux__
+    const vector<size_t>& nodes = topology()._nodes;
+    const int core = sched_getcpu();
+    if(0 <= core && static_cast<size_t>(core) < nodes.size())
+    {
+        return nodes[core];
+    }
+#endif
+    return 0;
+}
+
+void* NumaMemory::allocate(std::size_t size, const PagePlacement& placement)
+{
+    if(!isMapped(placement))
+    {
+        return ::operator new(size);
+    }
+
+#ifdef __linux__
+    const size_t length = mappedSize(size, placement);
+    void* data = MAP_FAILED;
+    if(isHugePage(size, placement))
+    {
+        data = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if(MAP_FAILED == data)
+    {
+        data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(MAP_FAILED == data)
+        {
+            throw bad_alloc();
+        }
+        if(isHugePage(size, placement))
+        {
+            madvise(data, length, MADV_HUGEPAGE);
+        }
+    }
+
+    if(0 <= placement._numaNode)
+    {
+        bindNode(data, length, static_cast<size_t>(placement._numaNode));
+    }
+    return data;
+#else
+    return ::operator new(size);
+#endif
+}
+
+void NumaMemory::deallocate(void* data, std::size_t size, const PagePlacement& placement)
+{
+    if(!isMapped(placement))
+    {
+        ::operator delete(data);
+        return;
+    }
+
+#ifdef __linux__
+    munmap(data, mappedSize(size, placement));
+#endif
+}
@@ -0,0 +1,216 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   numa_memory.h
+ * @author Aludirk Wong
+ * @date   2017-08-23
+ */
+
+#ifndef __LAKOO_NUMA_MEMORY_H__
+#define __LAKOO_NUMA_MEMORY_H__
+
+#include <cstddef>
+#include <type_traits>
+
+
+namespace lakoo
+{
+    //! Where the pages of an allocation are placed.
+    struct PagePlacement final
+    {
+        //! Whether to back the allocation by huge pages.
+        bool _isHugePage;
+
+        //! The NUMA node to place the pages on, -1 for the default policy of the thread.
+        int _numaNode;
+    };
+
+    //! To compare two placements.
+    /**
+     * @param [in] left  The placement.
+     * @param [in] right The other placement.
+     * @return           Whether they are the same.
+     */
+    inline bool operator==(const PagePlacement& left, const PagePlacement& right)
+    {
+        return left._isHugePage == right._isHugePage && left._numaNode == right._numaNode;
+    }
+
+    //! To compare two placements.
+    /**
+     * @param [in] left  The placement.
+     * @param [in] right The other placement.
+     * @return           Whether they differ.
+     */
+    inline bool operator!=(const PagePlacement& left, const PagePlacement& right)
+    {
+        return !(left == right);
+    }
+
+
+    //! The NUMA topology of the host and the memory placed on it.
+    namespace NumaMemory
+    {
+        //! The size of a huge page.
+        const std::size_t hugePageSize = 2 * 1024 * 1024;
+
+        //! The number of NUMA nodes, 1 if the host has no NUMA or it is not Linux.
+        /**
+         * The topology is read from /sys/devices/system/node once.
+         * @return The number of NUMA nodes.
+         */
+        std::size_t nodeCount();
+
+        //! The NUMA node of the core which the calling thread runs on.
+        /**
+         * @return The NUMA node, 0 if it is unknown.
+         */
+        std::size_t currentNode();
+
+        //! To allocate memory by a placement.
+        /**
+         * The default placement is plain operator new. Otherwise the memory is mapped on its own
+         * pages: huge pages are taken from the reserved pool first, then from transparent huge
+         * pages by madvise, and an allocation of less than half a huge page keeps normal pages
+         * not to waste the rest of the huge page. The pages prefer the NUMA node and fall back to
+         * the other nodes if it is full. Any of them which the host does not support is skipped.
+         * @param [in] size      The number of bytes.
+         * @param [in] placement The PagePlacement.
+         * @return               The memory.
+         * @throw std::bad_alloc The memory is exhausted.
+         */
+        void* allocate(std::size_t size, const PagePlacement& placement);
+
+        //! To free memory from allocate.
+        /**
+         * @param [in] data      The memory.
+         * @param [in] size      The number of bytes given to allocate.
+         * @param [in] placement The PagePlacement given to allocate.
+         */
+        void deallocate(void* data, std::size_t size, const PagePlacement& placement);
+    } // namespace NumaMemory
+
+
+    //! The allocator of the standard containers, placing their memory by a PagePlacement.
+    /**
+     * It is not final, as the containers derive from their allocators.
+     * @tparam _Type The type of the values.
+     */
+    template <typename _Type>
+    class PageAllocator
+    {
+        template <typename _Other>
+        friend class PageAllocator;
+
+    public:
+        //! The type of the values.
+        typedef _Type value_type;
+
+        //! The placement goes with the values when a container is assigned.
+        typedef std::true_type propagate_on_container_copy_assignment;
+
+        //! The placement goes with the values when a container is moved.
+        typedef std::true_type propagate_on_container_move_assignment;
+
+        //! The placement goes with the values when containers are swapped.
+        typedef std::true_type propagate_on_container_swap;
+
+    public:
+        //! Default constructor, with the default placement.
+        PageAllocator()
+        : _placement{false, -1}
+        {
+        }
+
+        //! Constructor.
+        /**
+         * @param [in] placement The PagePlacement.
+         */
+        explicit PageAllocator(const PagePlacement& placement)
+        : _placement(placement)
+        {
+        }
+
+        //! Constructor from the allocator of another type.
+        /**
+         * @param [in] other The allocator.
+         */
+        template <typename _Other>
+        PageAllocator(const PageAllocator<_Other>& other)
+        : _placement(other._placement)
+        {
+        }
+
+    public:
+        //! The placement.
+        /**
+         * @return The PagePlacement.
+         */
+        inline const PagePlacement& placement() const { return _placement; }
+
+        //! To allocate values.
+        /**
+         * @param [in] count The number of values.
+         * @return           The memory of the values.
+         */
+        inline _Type* allocate(std::size_t count)
+        {
+            return static_cast<_Type*>(NumaMemory::allocate(count * sizeof(_Type), _placement));
+        }
+
+        //! To free values.
+        /**
+         * @param [in] data  The memory of the values.
+         * @param [in] count The number of values.
+         */
+        inline void deallocate(_Type* data, std::size_t count)
+        {
+            NumaMemory::deallocate(data, count * sizeof(_Type), _placement);
+        }
+
+        //! To compare with another allocator, the memory of either can be freed by the other.
+        /**
+         * @param [in] other The allocator.
+         * @return           Whether they have the same placement.
+         */
+        template <typename _Other>
+        inline bool operator==(const PageAllocator<_Other>& other) const
+        {
+            return _placement == other._placement;
+        }
+
+        //! To compare with another allocator.
+        /**
+         * @param [in] other The allocator.
+         * @return           Whether they have different placements.
+         */
+        template <typename _Other>
+        inline bool operator!=(const PageAllocator<_Other>& other) const
+        {
+            return _placement != other._placement;
+        }
+
+    private:
+        //! The placement.
+        PagePlacement _placement;
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_NUMA_MEMORY_H__
@@ -0,0 +1,63 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   phase_clock.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-17
+ */
+
+#include "phase_clock.h"
+
+
+using namespace lakoo;
+using namespace std;
+
+
+namespace
+{
+    //! To measure the length of a tick by spinning for 2 milliseconds.
+    double measureTickLength()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        const uint64_t startTick = PhaseClock::now();
+        chrono::steady_clock::time_point end;
+        do
+        {
+            end = chrono::steady_clock::now();
+        } while(end - start < chrono::milliseconds(2));
+        const uint64_t endTick = PhaseClock::now();
+
+        const chrono::nanoseconds time = chrono::duration_cast<chrono::nanoseconds>(end - start);
+        return endTick > startTick
+               ? static_cast<double>(time.count()) / static_cast<double>(endTick - startTick)
+               : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+}
+
+
+double PhaseClock::tickLength()
+{
+    static const double length = measureTickLength();
+    return length;
+}
@@ -0,0 +1,77 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   phase_clock.h
+ * @author Aludirk Wong
+ * @date   2017-08-17
+ */
+
+#ifndef __LAKOO_PHASE_CLOCK_H__
+#define __LAKOO_PHASE_CLOCK_H__
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+namespace lakoo
+{
+    //! The monotonic clock to time the phases of a call.
+    namespace PhaseClock
+    {
+        //! The current tick.
+        /**
+         * On x86 it is the time stamp counter, which is constant rate and monotonic on the
+         * processors of the last decade and costs a few nanoseconds to read, otherwise it is
+         * std::chrono::steady_clock in nanoseconds.
+         * @return The current tick.
+         */
+        inline std::uint64_t now()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+
+        //! The length of a tick in nanoseconds, measured against std::chrono::steady_clock once.
+        /**
+         * @return The nanoseconds per tick.
+         */
+        double tickLength();
+
+        //! To convert ticks to nanoseconds.
+        /**
+         * @param [in] ticks The ticks.
+         * @return           The nanoseconds.
+         */
+        inline std::uint64_t toNanoseconds(std::uint64_t ticks)
+        {
+            return static_cast<std::uint64_t>(static_cast<double>(ticks) * tickLength());
+        }
+    } // namespace PhaseClock
+} // namespace lakoo
+
+#endif // __LAKOO_PHASE_CLOCK_H__
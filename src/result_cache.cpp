@@ -0,0 +1,282 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   result_cache.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-14
+ */
+
+#include "result_cache.h"
+
+#include <algorithm>
+
+#include "heap_size.h"
+
+
+using namespace lakoo;
+using namespace std;
+
+
+namespace
+{
+    //! To mix a value into a hash.
+    inline uint64_t mix(uint64_t hash, uint64_t value)
+    {
+        return (hash ^ value) * 0x100000001B3ULL;
+    }
+}
+
+
+ResultCache::ResultCache()
+: _shards()
+, _capacity(0)
+{
+    for(Shard& shard : _shards)
+    {
+        shard._hits = 0;
+        shard._misses = 0;
+    }
+}
+
+void ResultCache::setCapacity(std::size_t capacity)
+{
+    for(Shard& shard : _shards)
+    {
+        lock_guard<mutex> lock(shard._mutex);
+        shard._entries.clear();
+        shard._index.clear();
+        shard._hits = 0;
+        shard._misses = 0;
+    }
+
+    _capacity = capacity;
+}
+
+std::size_t ResultCache::capacity() const
+{
+    return _capacity;
+}
+
+bool ResultCache::findCheck(const wchar_t* str,
+                            std::size_t size,
+                            std::uint64_t generation,
+                            bool& isFound,
+                            std::vector<std::size_t>& wordIds)
+{
+    const Key key = makeKey(str, size, nullptr, 0, false);
+    Shard& keyShard = shard(key);
+    lock_guard<mutex> lock(keyShard._mutex);
+
+    const Entry* entry = find(keyShard, key, generation);
+    if(nullptr == entry)
+    {
+        return false;
+    }
+
+    isFound = entry->_isFound;
+    wordIds.assign(entry->_wordIds.begin(), entry->_wordIds.end());
+    return true;
+}
+
+void ResultCache::storeCheck(const wchar_t* str,
+                             std::size_t size,
+                             std::uint64_t generation,
+                             bool isFound,
+                             const std::vector<std::size_t>& wordIds)
+{
+    const Key key = makeKey(str, size, nullptr, 0, false);
+    Shard& keyShard = shard(key);
+    lock_guard<mutex> lock(keyShard._mutex);
+
+    Entry& entry = insert(keyShard, key);
+    entry._generation = generation;
+    entry._isFound = isFound;
+    entry._result.clear();
+    entry._wordIds.assign(wordIds.begin(), wordIds.end());
+}
+
+bool ResultCache::findPurify(const wchar_t* str,
+                             std::size_t size,
+                             const wchar_t* mask,
+                             std::size_t maskSize,
+                             bool isMatchSize,
+                             std::uint64_t generation,
+                             std::wstring& result,
+                             std::vector<std::size_t>& wordIds)
+{
+    const Key key = makeKey(str, size, mask, maskSize, isMatchSize);
+    Shard& keyShard = shard(key);
+    lock_guard<mutex> lock(keyShard._mutex);
+
+    const Entry* entry = find(keyShard, key, generation);
+    if(nullptr == entry)
+    {
+        return false;
+    }
+
+    result.assign(entry->_result);
+    wordIds.assign(entry->_wordIds.begin(), entry->_wordIds.end());
+    return true;
+}
+
+void ResultCache::storePurify(const wchar_t* str,
+                              std::size_t size,
+                              const wchar_t* mask,
+                              std::size_t maskSize,
+                              bool isMatchSize,
+                              std::uint64_t generation,
+                              const std::wstring& result,
+                              const std::vector<std::size_t>& wordIds)
+{
+    const Key key = makeKey(str, size, mask, maskSize, isMatchSize);
+    Shard& keyShard = shard(key);
+    lock_guard<mutex> lock(keyShard._mutex);
+
+    Entry& entry = insert(keyShard, key);
+    entry._generation = generation;
+    entry._isFound = false;
+    entry._result.assign(result);
+    entry._wordIds.assign(wordIds.begin(), wordIds.end());
+}
+
+lakoo::CacheStatistics ResultCache::statistics() const
+{
+    CacheStatistics result{0, 0, 0};
+    for(const Shard& shard : _shards)
+    {
+        lock_guard<mutex> lock(shard._mutex);
+        result._hits += shard._hits;
+        result._misses += shard._misses;
+        result._size += shard._entries.size();
+    }
+
+    return result;
+}
+
+std::size_t ResultCache::memoryUsage() const
+{
+    typedef decltype(Shard::_index) Index;
+    size_t result = HeapSize::block(sizeof(ResultCache));
+    for(const Shard& shard : _shards)
+    {
+        lock_guard<mutex> lock(shard._mutex);
+        for(const Entry& entry : shard._entries)
+        {
+            result += HeapSize::listNode<Entry>() + HeapSize::string(entry._text) +
+                      HeapSize::string(entry._mask) + HeapSize::string(entry._result) +
+                      HeapSize::vector(entry._wordIds);
+        }
+        result += shard._index.size() * HeapSize::hashNode<Index::value_type>() +
+                  HeapSize::block(shard._index.bucket_count() * sizeof(void*));
+    }
+
+    return result;
+}
+
+ResultCache::Key ResultCache::makeKey(const wchar_t* str,
+                                      std::size_t size,
+                                      const wchar_t* mask,
+                                      std::size_t maskSize,
+                                      bool isMatchSize)
+{
+    // FNV-1a over the code points of the string and the mask.
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for(const wchar_t* ch = str; ch != str + size; ++ch)
+    {
+        hash = mix(hash, static_cast<uint64_t>(*ch));
+    }
+
+    hash = mix(hash, nullptr == mask ? 0 : (isMatchSize ? 1 : 2));
+    for(const wchar_t* ch = mask; ch != mask + maskSize; ++ch)
+    {
+        hash = mix(hash, static_cast<uint64_t>(*ch));
+    }
+
+    // The high bits select the shard, so spread the low bits up.
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 32;
+
+    return Key{str, size, mask, maskSize, isMatchSize, hash};
+}
+
+ResultCache::Entry* ResultCache::find(Shard& shard, const Key& key, std::uint64_t generation)
+{
+    auto iter = shard._index.find(key._hash);
+    if(shard._index.end() != iter)
+    {
+        // The hashes may collide, so the inputs are compared.
+        Entry& entry = *iter->second;
+        const bool isCheck = nullptr == key._mask;
+        bool isSame = entry._isCheck == isCheck &&
+                      0 == entry._text.compare(0, entry._text.size(), key._text, key._size);
+        if(isSame && !isCheck)
+        {
+            isSame = entry._isMatchSize == key._isMatchSize &&
+                     0 == entry._mask.compare(0, entry._mask.size(), key._mask, key._maskSize);
+        }
+
+        if(isSame && entry._generation == generation)
+        {
+            shard._entries.splice(shard._entries.begin(), shard._entries, iter->second);
+            ++shard._hits;
+            return &entry;
+        }
+    }
+
+    ++shard._misses;
+    return nullptr;
+}
+
+ResultCache::Entry& ResultCache::insert(Shard& shard, const Key& key)
+{
+    auto iter = shard._index.find(key._hash);
+    if(shard._index.end() != iter)
+    {
+        // The entry of the same hash is outdated or collides, it is replaced.
+        shard._entries.splice(shard._entries.begin(), shard._entries, iter->second);
+    }
+    else
+    {
+        const size_t shardCount = 1U << shardBits;
+        const size_t shardCapacity = max<size_t>(1, (_capacity + shardCount - 1) / shardCount);
+        if(shard._entries.size() >= shardCapacity)
+        {
+            // Reuse the least recently used entry, so that its memory is kept.
+            auto last = prev(shard._entries.end());
+            shard._index.erase(last->_hash);
+            shard._entries.splice(shard._entries.begin(), shard._entries, last);
+        }
+        else
+        {
+            shard._entries.emplace_front();
+        }
+        shard._index.emplace(key._hash, shard._entries.begin());
+    }
+
+    Entry& entry = shard._entries.front();
+    entry._hash = key._hash;
+    entry._text.assign(key._text, key._size);
+    entry._isCheck = nullptr == key._mask;
+    entry._mask.assign(nullptr == key._mask ? L"" : key._mask, key._maskSize);
+    entry._isMatchSize = key._isMatchSize;
+
+    return entry;
+}
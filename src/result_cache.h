@@ -0,0 +1,303 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   result_cache.h
+ * @author Aludirk Wong
+ * @date   2017-08-14
+ */
+
+#ifndef __LAKOO_RESULT_CACHE_H__
+#define __LAKOO_RESULT_CACHE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "text_purifier.h"
+
+
+namespace lakoo
+{
+    //! The bounded cache of the results of checking and purifying short strings.
+    /**
+     * The entries are spread over shards by the hash of the input, each shard has its own lock
+     * and evicts the least recently used entry. An entry records the generation of the
+     * FilterList it is computed with, it is a miss once the list has changed. An entry also
+     * keeps the IDs of the words its scan found, so that a hit can replay them into the
+     * HitSketch.
+     */
+    class ResultCache final
+    {
+    public:
+        //! The maximum length of a string to cache, longer strings are rarely repeated.
+        static const std::size_t maxLength = 256;
+
+    public:
+        //! Default constructor.
+        /**
+         * The cache is disabled.
+         */
+        ResultCache();
+
+        //! Default destructor.
+        ~ResultCache() = default;
+
+        //! Deleted copy constructor.
+        ResultCache(const ResultCache&) = delete;
+
+        //! Deleted assignment operator.
+        ResultCache& operator=(const ResultCache&) = delete;
+
+    public:
+        //! To set the maximum number of entries, the entries and counters are cleared.
+        /**
+         * @param [in] capacity The maximum number of entries, 0 to disable the cache.
+         */
+        void setCapacity(std::size_t capacity);
+
+        //! The maximum number of entries.
+        /**
+         * @return The maximum number of entries.
+         */
+        std::size_t capacity() const;
+
+        //! Whether a string of the length can be cached.
+        /**
+         * @param [in] size The length of the string.
+         * @return          Whether the string can be cached.
+         */
+        inline bool isCacheable(std::size_t size) const
+        {
+            return size <= maxLength && 0 != _capacity.load(std::memory_order_relaxed);
+        }
+
+        //! To find the result of checking a string.
+        /**
+         * @param [in]  str        The string.
+         * @param [in]  size       The length of the string.
+         * @param [in]  generation The generation of the FilterList.
+         * @param [out] isFound    Whether any word is found in the string.
+         * @param [out] wordIds    The IDs of the words found by the scan.
+         * @return                 Whether the result is cached.
+         */
+        bool findCheck(const wchar_t* str,
+                       std::size_t size,
+                       std::uint64_t generation,
+                       bool& isFound,
+                       std::vector<std::size_t>& wordIds);
+
+        //! To store the result of checking a string.
+        /**
+         * @param [in] str        The string.
+         * @param [in] size       The length of the string.
+         * @param [in] generation The generation of the FilterList.
+         * @param [in] isFound    Whether any word is found in the string.
+         * @param [in] wordIds    The IDs of the words found by the scan.
+         */
+        void storeCheck(const wchar_t* str,
+                        std::size_t size,
+                        std::uint64_t generation,
+                        bool isFound,
+                        const std::vector<std::size_t>& wordIds);
+
+        //! To find the result of purifying a string.
+        /**
+         * @param [in]  str         The string.
+         * @param [in]  size        The length of the string.
+         * @param [in]  mask        The mask.
+         * @param [in]  maskSize    The length of the mask.
+         * @param [in]  isMatchSize Whether the mask is repeated to the size of the words.
+         * @param [in]  generation  The generation of the FilterList.
+         * @param [out] result      The purified string.
+         * @param [out] wordIds     The IDs of the words found by the scan.
+         * @return                  Whether the result is cached.
+         */
+        bool findPurify(const wchar_t* str,
+                        std::size_t size,
+                        const wchar_t* mask,
+                        std::size_t maskSize,
+                        bool isMatchSize,
+                        std::uint64_t generation,
+                        std::wstring& result,
+                        std::vector<std::size_t>& wordIds);
+
+        //! To store the result of purifying a string.
+        /**
+         * @param [in] str         The string.
+         * @param [in] size        The length of the string.
+         * @param [in] mask        The mask.
+         * @param [in] maskSize    The length of the mask.
+         * @param [in] isMatchSize Whether the mask is repeated to the size of the words.
+         * @param [in] generation  The generation of the FilterList.
+         * @param [in] result      The purified string.
+         * @param [in] wordIds     The IDs of the words found by the scan.
+         */
+        void storePurify(const wchar_t* str,
+                         std::size_t size,
+                         const wchar_t* mask,
+                         std::size_t maskSize,
+                         bool isMatchSize,
+                         std::uint64_t generation,
+                         const std::wstring& result,
+                         const std::vector<std::size_t>& wordIds);
+
+        //! The counters of the cache.
+        /**
+         * @return The CacheStatistics.
+         */
+        CacheStatistics statistics() const;
+
+        //! The bytes of the cache on the heap, the cache itself included.
+        /**
+         * @return The number of bytes, estimated by HeapSize.
+         */
+        std::size_t memoryUsage() const;
+
+    private:
+        //! The input of a result.
+        struct Key final
+        {
+            //! The string.
+            const wchar_t* _text;
+
+            //! The length of the string.
+            std::size_t _size;
+
+            //! The mask, nullptr for checking.
+            const wchar_t* _mask;
+
+            //! The length of the mask.
+            std::size_t _maskSize;
+
+            //! Whether the mask is repeated to the size of the words.
+            bool _isMatchSize;
+
+            //! The hash of all the above.
+            std::uint64_t _hash;
+        };
+
+        //! A cached result.
+        struct Entry final
+        {
+            //! The hash of the input.
+            std::uint64_t _hash;
+
+            //! The generation of the FilterList.
+            std::uint64_t _generation;
+
+            //! The string.
+            std::wstring _text;
+
+            //! Whether it is the result of checking.
+            bool _isCheck;
+
+            //! The mask.
+            std::wstring _mask;
+
+            //! Whether the mask is repeated to the size of the words.
+            bool _isMatchSize;
+
+            //! Whether any word is found, for checking.
+            bool _isFound;
+
+            //! The purified string, for purifying.
+            std::wstring _result;
+
+            //! The IDs of the words found by the scan.
+            std::vector<std::size_t> _wordIds;
+        };
+
+        //! A part of the cache with its own lock.
+        struct Shard final
+        {
+            //! The lock of the shard.
+            mutable std::mutex _mutex;
+
+            //! The entries, the most recently used one first.
+            std::list<Entry> _entries;
+
+            //! The entries by the hashes of their inputs.
+            std::unordered_map<std::uint64_t, std::list<Entry>::iterator> _index;
+
+            //! The number of hits.
+            std::size_t _hits;
+
+            //! The number of misses.
+            std::size_t _misses;
+        };
+
+    private:
+        //! To make the key of an input.
+        /**
+         * @param [in] str         The string.
+         * @param [in] size        The length of the string.
+         * @param [in] mask        The mask, nullptr for checking.
+         * @param [in] maskSize    The length of the mask.
+         * @param [in] isMatchSize Whether the mask is repeated to the size of the words.
+         * @return                 The key.
+         */
+        static Key makeKey(const wchar_t* str,
+                           std::size_t size,
+                           const wchar_t* mask,
+                           std::size_t maskSize,
+                           bool isMatchSize);
+
+        //! The shard of a key.
+        /**
+         * @param [in] key The key.
+         * @return         The shard.
+         */
+        inline Shard& shard(const Key& key) { return _shards[key._hash >> (64 - shardBits)]; }
+
+        //! To find the entry of a key and mark it as the most recently used, the shard is locked.
+        /**
+         * @param [in,out] shard      The shard of the key.
+         * @param [in]     key        The key.
+         * @param [in]     generation The generation of the FilterList.
+         * @return                    The entry, nullptr if it is a miss.
+         */
+        Entry* find(Shard& shard, const Key& key, std::uint64_t generation);
+
+        //! To insert or replace the entry of a key, the shard is locked.
+        /**
+         * @param [in,out] shard The shard of the key.
+         * @param [in]     key   The key.
+         * @return               The entry to fill.
+         */
+        Entry& insert(Shard& shard, const Key& key);
+
+    private:
+        //! The number of bits of the hash to select a shard.
+        static const unsigned shardBits = 4;
+
+        //! The shards.
+        Shard _shards[1U << shardBits];
+
+        //! The maximum number of entries.
+        std::atomic<std::size_t> _capacity;
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_RESULT_CACHE_H__
@@ -0,0 +1,177 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   scan_buffer.h
+ * @author Aludirk Wong
+ * @date   2017-08-02
+ */
+
+#ifndef __LAKOO_SCAN_BUFFER_H__
+#define __LAKOO_SCAN_BUFFER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "heap_size.h"
+
+
+namespace lakoo
+{
+    //! The state of walking a dictionary automaton.
+    /**
+     * Both fields are 64 bits on every target, so that LayeredAutomaton can pack the states of
+     * its two layers into them.
+     */
+    struct AutomatonState final
+    {
+    public:
+        //! The node of the automaton, its pointer or index depending on the automaton.
+        std::uint64_t _node;
+
+        //! The number of words ordered before the path, for the automata sharing the nodes.
+        std::uint64_t _rank;
+
+    public:
+        //! Whether two states are the same.
+        /**
+         * @param [in] other The other state.
+         * @return           Whether the states are the same.
+         */
+        inline bool operator==(const AutomatonState& other) const
+        {
+            return _node == other._node && _rank == other._rank;
+        }
+    };
+
+
+    //! The state of matching a pattern, an AutomatonState with the number of characters left in
+    //! the gap.
+    typedef std::pair<AutomatonState, std::size_t> PatternState;
+
+
+    //! The scratch buffers behind a ScanContext.
+    struct ScanBuffer final
+    {
+    public:
+        //! The buffer for the transcoded input.
+        std::wstring _text;
+
+        //! The buffer for the lower case input.
+        std::wstring _lowerText;
+
+        //! The buffer for the transcoded mask.
+        std::wstring _mask;
+
+        //! The buffer for the purified std::wstring.
+        std::wstring _result;
+
+        //! The buffer for the purified std::string.
+        std::string _output;
+
+        //! The buffer for the purified std::u16string.
+        std::u16string _utf16Output;
+
+        //! The active states of matching patterns.
+        std::vector<PatternState> _states;
+
+        //! The next states of matching patterns.
+        std::vector<PatternState> _nextStates;
+
+        //! The positions of the characters in the window of approximate matching.
+        std::vector<std::size_t> _positions;
+
+        //! The rows of edit distances of approximate matching, one row for each depth.
+        std::vector<std::size_t> _rows;
+
+        //! The word segments of the last scan, collected if the phases are timed or for a
+        //! MaskPolicy.
+        std::vector<std::pair<std::size_t, std::size_t>> _segments;
+
+        //! The word IDs of the word segments, collected for a MaskPolicy or the ResultCache.
+        std::vector<std::size_t> _wordIds;
+
+        //! The number of transitions taken by the last scan, counted with the statistics only.
+        std::uint64_t _transitions;
+
+        //! The number of word segments found by the last scan, counted with the statistics only.
+        std::uint64_t _matches;
+
+        //! Whether the last purify found any word segment.
+        bool _isFound;
+
+        //! Whether the scan records the end of folding the case.
+        bool _isTimed;
+
+        //! The tick the last scan ends folding the case, recorded only if #_isTimed.
+        std::uint64_t _foldEnd;
+
+    public:
+        //! Default constructor.
+        ScanBuffer()
+        : _transitions(0)
+        , _matches(0)
+        , _isFound(false)
+        , _isTimed(false)
+        , _foldEnd(0)
+        {
+        }
+
+        //! Default destructor.
+        ~ScanBuffer() = default;
+
+        //! Deleted copy constructor.
+        ScanBuffer(const ScanBuffer&) = delete;
+
+        //! Deleted assignment operator.
+        ScanBuffer& operator=(const ScanBuffer&) = delete;
+
+    public:
+        //! The total capacity of the buffers, to tell whether any of them has grown.
+        /**
+         * @return The sum of the capacities in elements.
+         */
+        inline std::size_t capacity() const
+        {
+            return _text.capacity() + _lowerText.capacity() + _mask.capacity() +
+                   _result.capacity() + _output.capacity() + _utf16Output.capacity() +
+                   _states.capacity() + _nextStates.capacity() + _positions.capacity() +
+                   _rows.capacity() + _segments.capacity() + _wordIds.capacity();
+        }
+
+        //! The bytes of the buffers on the heap.
+        /**
+         * @return The number of bytes, estimated by HeapSize.
+         */
+        inline std::size_t memoryUsage() const
+        {
+            return HeapSize::string(_text) + HeapSize::string(_lowerText) +
+                   HeapSize::string(_mask) + HeapSize::string(_result) +
+                   HeapSize::string(_output) + HeapSize::string(_utf16Output) +
+                   HeapSize::vector(_states) + HeapSize::vector(_nextStates) +
+                   HeapSize::vector(_positions) + HeapSize::vector(_rows) +
+                   HeapSize::vector(_segments) + HeapSize::vector(_wordIds);
+        }
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_SCAN_BUFFER_H__
@@ -0,0 +1,552 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   scanner.h
+ * @author Aludirk Wong
+ * @date   2017-08-07
+ */
+
+#ifndef __LAKOO_SCANNER_H__
+#define __LAKOO_SCANNER_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "char_node.h"
+#include "phase_clock.h"
+#include "scan_buffer.h"
+#include "statistics_counters.h"
+#include "string_utils.h"
+#include "text_purifier.h"
+
+
+namespace lakoo
+{
+    //! The options of scanning a text.
+    struct ScanOptions final
+    {
+    public:
+        //! The semantics of reporting the word segments.
+        MatchMode _matchMode;
+
+        //! Whether the words of alphabetic scripts must match on word boundaries.
+        bool _isWordBoundary;
+
+        //! Whether any pattern has been added.
+        bool _hasPattern;
+
+        //! The maximum number of characters a gap in patterns can match.
+        std::size_t _maxGap;
+
+        //! The maximum edit distance of approximate matching.
+        std::size_t _maxDistance;
+
+        //! The maximum number of characters of the words, excluding gaps.
+        std::size_t _maxLength;
+
+    public:
+        //! Default constructor.
+        ScanOptions()
+        : _matchMode(MatchMode::All)
+        , _isWordBoundary(false)
+        , _hasPattern(false)
+        , _maxGap(3)
+        , _maxDistance(0)
+        , _maxLength(0)
+        {
+        }
+    };
+
+
+    //! To scan a text for the words of a dictionary automaton.
+    /**
+     * The automaton provides the interface of TrieAutomaton: \c root, \c next, \c follow,
+     * \c isEnd, \c wordId and \c forEachNext over AutomatonState, so that the same scan runs on
+     * every representation of the dictionary.
+     */
+    template <typename _Automaton>
+    class Scanner final
+    {
+    public:
+        //! Constructor.
+        /**
+         * @param [in]     automaton The dictionary automaton.
+         * @param [in]     options   The options of scanning.
+         * @param [in,out] buffer    The scratch buffers, their memory is reused.
+         */
+        Scanner(const _Automaton& automaton, const ScanOptions& options, ScanBuffer& buffer);
+
+        //! Default destructor.
+        ~Scanner() = default;
+
+        //! Deleted copy constructor.
+        Scanner(const Scanner&) = delete;
+
+        //! Deleted assignment operator.
+        Scanner& operator=(const Scanner&) = delete;
+
+    public:
+        //! To visit all word segments to filter.
+        /**
+         * @param [in] str     The wchar_t string to check.
+         * @param [in] size    The length of the string.
+         * @param [in] visitor The callable with signature
+         *                     <tt>bool(std::size_t start, std::size_t length, std::size_t wordId)</tt>,
+         *                     returns \c false to stop the scan.
+         * @return             \c false if the scan is stopped by the visitor.
+         */
+        template <typename _Visitor>
+        bool scan(const wchar_t* str, std::size_t size, _Visitor&& visitor);
+
+    private:
+        //! To add a pattern state, the states of the same AutomatonState are merged.
+        /**
+         * @param [in,out] states The pattern states.
+         * @param [in]     state  The AutomatonState.
+         * @param [in]     gap    The number of characters left in the gap.
+         */
+        static void addState(std::vector<PatternState>& states,
+                             const AutomatonState& state,
+                             std::size_t gap);
+
+        //! To add a pattern state of entering an AutomatonState, including the gap starting there.
+        /**
+         * @param [in,out] states The pattern states.
+         * @param [in]     state  The AutomatonState entered.
+         */
+        void enterState(std::vector<PatternState>& states, const AutomatonState& state) const;
+
+        //! To find the best approximate match from a start position.
+        /**
+         * The first character of a word must match exactly, the other characters can be
+         * substituted, inserted or deleted. A word of \c n characters tolerates at most
+         * <tt>(n - 1) / 2</tt> edits, so that short words do not match everything.
+         * @param [in]  charIndex The start position.
+         * @param [out] end       The end position of the best match, unchanged if none.
+         * @param [out] wordId    The word ID of the best match.
+         */
+        void findApproximate(std::size_t charIndex, std::size_t& end, std::size_t& wordId);
+
+        //! To search the automaton for approximate matches by rows of edit distances.
+        /**
+         * @param [in]     state    The AutomatonState reached.
+         * @param [in]     depth    The depth of the state.
+         * @param [in]     width    The number of characters in the window.
+         * @param [in,out] distance The edit distance of the best match.
+         * @param [in,out] end      The end position of the best match.
+         * @param [in,out] wordId   The word ID of the best match.
+         */
+        void searchApproximate(const AutomatonState& state,
+                               std::size_t depth,
+                               std::size_t width,
+                               std::size_t& distance,
+                               std::size_t& end,
+                               std::size_t& wordId);
+
+    private:
+        //! The dictionary automaton.
+        const _Automaton& _automaton;
+
+        //! The options of scanning.
+        const ScanOptions& _options;
+
+        //! The scratch buffers.
+        ScanBuffer& _buffer;
+
+        //! The lower case string.
+        const wchar_t* _charList;
+
+        //! The length of the string.
+        std::size_t _size;
+    };
+
+
+    template <typename _Automaton>
+    Scanner<_Automaton>::Scanner(const _Automaton& automaton,
+                                 const ScanOptions& options,
+                                 ScanBuffer& buffer)
+    : _automaton(automaton)
+    , _options(options)
+    , _buffer(buffer)
+    , _charList(nullptr)
+    , _size(0)
+    {
+    }
+
+    template <typename _Automaton>
+    template <typename _Visitor>
+    bool Scanner<_Automaton>::scan(const wchar_t* str, std::size_t size, _Visitor&& visitor)
+    {
+        StringUtils::toLowerCase(str, size, _buffer._lowerText);
+        LAKOO_STATISTICS(if(_buffer._isTimed) { _buffer._foldEnd = PhaseClock::now(); })
+        _charList = _buffer._lowerText.data();
+        _size = size;
+
+        const wchar_t* const charList = _charList;
+        const AutomatonState root = _automaton.root();
+        const bool isLongest = MatchMode::LeftmostFirst != _options._matchMode;
+        const bool isOverlapped = MatchMode::All == _options._matchMode;
+        const bool isWordBoundary = _options._isWordBoundary;
+        const bool hasPattern = _options._hasPattern;
+        const bool isApproximate = _options._maxDistance > 0;
+        std::vector<PatternState>& states = _buffer._states;
+        std::vector<PatternState>& nextStates = _buffer._nextStates;
+
+        std::size_t end = std::numeric_limits<std::size_t>::max();
+        std::size_t wordId = 0;
+        auto accept = [&](const AutomatonState& state, std::size_t findIndex)
+        {
+            if(!_automaton.isEnd(state))
+            {
+                return;
+            }
+
+            // A word ending with a word character cannot end in the middle of a word.
+            if(isWordBoundary && !StringUtils::isWordBoundary(charList, size, findIndex + 1))
+            {
+                return;
+            }
+
+            const std::size_t stateWordId = _automaton.wordId(state);
+            if(isLongest || std::numeric_limits<std::size_t>::max() == end || stateWordId < wordId)
+            {
+                end = findIndex;
+                wordId = stateWordId;
+            }
+        };
+
+        for(std::size_t charIndex = 0; charIndex < size; ++charIndex)
+        {
+            if(L' ' == charList[charIndex])
+            {
+                continue;
+            }
+
+            // A word starting with a word character cannot start in the middle of a word.
+            if(isWordBoundary && !StringUtils::isWordBoundary(charList, size, charIndex))
+            {
+                continue;
+            }
+
+            end = std::numeric_limits<std::size_t>::max();
+
+            if(isApproximate)
+            {
+                findApproximate(charIndex, end, wordId);
+            }
+            else if(!hasPattern)
+            {
+                AutomatonState state = root;
+                for(std::size_t findIndex = charIndex; findIndex < size; ++findIndex)
+                {
+                    wchar_t ch = charList[findIndex];
+                    if(L' ' == ch)
+                    {
+                        continue;
+                    }
+
+                    if(!_automaton.next(state, ch, state))
+                    {
+                        break;
+                    }
+
+                    LAKOO_STATISTICS(++_buffer._transitions;)
+                    accept(state, findIndex);
+
+                    // No word ends inside a chain of single edges, so it is matched at once.
+                    const std::size_t count =
+                        _automaton.follow(state, charList + findIndex + 1, size - findIndex - 1);
+                    LAKOO_STATISTICS(_buffer._transitions += count;)
+                    findIndex += count;
+                }
+            }
+            else
+            {
+                // Simulate the pattern automaton, the states are bounded by the dictionary, not by
+                // the number of texts the patterns can expand to.
+                states.clear();
+                states.emplace_back(root, 0);
+                for(std::size_t findIndex = charIndex; findIndex < size; ++findIndex)
+                {
+                    wchar_t ch = charList[findIndex];
+                    if(L' ' == ch)
+                    {
+                        continue;
+                    }
+
+                    nextStates.clear();
+                    for(const PatternState& state : states)
+                    {
+                        AutomatonState nextState;
+                        if(_automaton.next(state.first, ch, nextState))
+                        {
+                            LAKOO_STATISTICS(++_buffer._transitions;)
+                            enterState(nextStates, nextState);
+                        }
+
+                        if(_automaton.next(state.first, CharNode::anyCharacter, nextState))
+                        {
+                            LAKOO_STATISTICS(++_buffer._transitions;)
+                            enterState(nextStates, nextState);
+                        }
+
+                        if(state.second > 0)
+                        {
+                            addState(nextStates, state.first, state.second - 1);
+                        }
+                    }
+
+                    if(nextStates.empty())
+                    {
+                        break;
+                    }
+
+                    states.swap(nextStates);
+                    for(const PatternState& state : states)
+                    {
+                        accept(state.first, findIndex);
+                    }
+                }
+            }
+
+            if(std::numeric_limits<std::size_t>::max() != end)
+            {
+                LAKOO_STATISTICS(++_buffer._matches;)
+                if(!visitor(charIndex, end - charIndex + 1, wordId))
+                {
+                    return false;
+                }
+
+                if(!isOverlapped)
+                {
+                    // Skip the positions covered by the reported word segment.
+                    charIndex = end;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    template <typename _Automaton>
+    void Scanner<_Automaton>::addState(std::vector<PatternState>& states,
+                                       const AutomatonState& state,
+                                       std::size_t gap)
+    {
+        for(PatternState& current : states)
+        {
+            if(current.first == state)
+            {
+                // The state with more characters left in the gap covers the other one.
+                current.second = std::max(current.second, gap);
+                return;
+            }
+        }
+
+        states.emplace_back(state, gap);
+    }
+
+    template <typename _Automaton>
+    void Scanner<_Automaton>::enterState(std::vector<PatternState>& states,
+                                         const AutomatonState& state) const
+    {
+        addState(states, state, 0);
+
+        AutomatonState gapState;
+        if(_automaton.next(state, CharNode::gapCharacter, gapState))
+        {
+            addState(states, gapState, _options._maxGap);
+        }
+    }
+
+    template <typename _Automaton>
+    void Scanner<_Automaton>::findApproximate(std::size_t charIndex,
+                                              std::size_t& end,
+                                              std::size_t& wordId)
+    {
+        const std::size_t maxLength = _options._maxLength;
+        if(0 == maxLength)
+        {
+            return;
+        }
+
+        // The window holds the positions of the characters a word can span, spaces are skipped.
+        std::vector<std::size_t>& positions = _buffer._positions;
+        positions.clear();
+        const std::size_t maxWidth = maxLength + _options._maxDistance;
+        for(std::size_t index = charIndex; index < _size && positions.size() < maxWidth; ++index)
+        {
+            if(L' ' != _charList[index])
+            {
+                positions.push_back(index);
+            }
+        }
+
+        const std::size_t width = positions.size();
+        std::vector<std::size_t>& rows = _buffer._rows;
+        if(rows.size() < (maxLength + 1) * (width + 1))
+        {
+            rows.resize((maxLength + 1) * (width + 1));
+        }
+
+        // The first character matches exactly, so the row of depth 1 is the same for every state.
+        std::size_t* row = rows.data() + (width + 1);
+        row[0] = 1;
+        for(std::size_t column = 1; column <= width; ++column)
+        {
+            row[column] = column - 1;
+        }
+
+        std::size_t distance = std::numeric_limits<std::size_t>::max();
+        const AutomatonState root = _automaton.root();
+        const wchar_t firstCharacters[] = {_charList[charIndex], CharNode::anyCharacter};
+        for(wchar_t character : firstCharacters)
+        {
+            AutomatonState state;
+            if(_automaton.next(root, character, state))
+            {
+                searchApproximate(state, 1, width, distance, end, wordId);
+            }
+        }
+    }
+
+    template <typename _Automaton>
+    void Scanner<_Automaton>::searchApproximate(const AutomatonState& state,
+                                                std::size_t depth,
+                                                std::size_t width,
+                                                std::size_t& distance,
+                                                std::size_t& end,
+                                                std::size_t& wordId)
+    {
+        const std::vector<std::size_t>& positions = _buffer._positions;
+        const std::size_t* row = _buffer._rows.data() + depth * (width + 1);
+        const std::size_t maxDistance = _options._maxDistance;
+        LAKOO_STATISTICS(++_buffer._transitions;)
+
+        if(_automaton.isEnd(state))
+        {
+            const std::size_t allowed = std::min(maxDistance, (depth - 1) / 2);
+            const std::size_t stateWordId = _automaton.wordId(state);
+            for(std::size_t column = 1; column <= width; ++column)
+            {
+                if(row[column] > allowed)
+                {
+                    continue;
+                }
+
+                const std::size_t findIndex = positions[column - 1];
+                if(_options._isWordBoundary &&
+                   !StringUtils::isWordBoundary(_charList, _size, findIndex + 1))
+                {
+                    continue;
+                }
+
+                const bool isBetter = std::numeric_limits<std::size_t>::max() == end ||
+                                      row[column] < distance ||
+                                      (row[column] == distance &&
+                                       (MatchMode::LeftmostFirst != _options._matchMode
+                                        ? findIndex > end
+                                        : stateWordId < wordId));
+                if(isBetter)
+                {
+                    distance = row[column];
+                    end = findIndex;
+                    wordId = stateWordId;
+                }
+            }
+        }
+
+        if(depth >= _options._maxLength)
+        {
+            return;
+        }
+
+        std::size_t minimum = std::numeric_limits<std::size_t>::max();
+        for(std::size_t column = 0; column <= width; ++column)
+        {
+            minimum = std::min(minimum, row[column]);
+        }
+
+        std::size_t* nextRow = _buffer._rows.data() + (depth + 1) * (width + 1);
+        auto search = [&](wchar_t character, const AutomatonState& nextState)
+        {
+            if(CharNode::gapCharacter == character)
+            {
+                return;
+            }
+
+            nextRow[0] = row[0] + 1;
+            std::size_t nextMinimum = nextRow[0];
+            for(std::size_t column = 1; column <= width; ++column)
+            {
+                const wchar_t ch = _charList[positions[column - 1]];
+                const std::size_t cost = (character == ch || CharNode::anyCharacter == character) ? 0 : 1;
+                nextRow[column] = std::min(std::min(row[column], nextRow[column - 1]) + 1,
+                                           row[column - 1] + cost);
+                nextMinimum = std::min(nextMinimum, nextRow[column]);
+            }
+
+            if(nextMinimum <= maxDistance)
+            {
+                searchApproximate(nextState, depth + 1, width, distance, end, wordId);
+            }
+        };
+
+        if(minimum < maxDistance)
+        {
+            _automaton.forEachNext(state, search);
+        }
+        else
+        {
+            // No edit is left, only the characters in the window can be followed, each character
+            // once however often it repeats in the window.
+            AutomatonState nextState;
+            for(std::size_t column = 0; column < width; ++column)
+            {
+                if(row[column] > maxDistance)
+                {
+                    continue;
+                }
+
+                const wchar_t ch = _charList[positions[column]];
+                bool isFollowed = false;
+                for(std::size_t previous = 0; previous < column && !isFollowed; ++previous)
+                {
+                    isFollowed = row[previous] <= maxDistance && ch == _charList[positions[previous]];
+                }
+
+                if(!isFollowed && _automaton.next(state, ch, nextState))
+                {
+                    search(ch, nextState);
+                }
+            }
+
+            if(_automaton.next(state, CharNode::anyCharacter, nextState))
+            {
+                search(CharNode::anyCharacter, nextState);
+            }
+        }
+    }
+} // namespace lakoo
+
+#endif // __LAKOO_SCANNER_H__
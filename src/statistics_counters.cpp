@@ -0,0 +1,149 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   statistics_counters.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-15
+ */
+
+#include "statistics_counters.h"
+
+#include <vector>
+
+#include "phase_clock.h"
+
+
+using namespace lakoo;
+using namespace std;
+
+
+StatisticsCounters::StatisticsCounters()
+: _shards()
+, _histograms()
+, _isEnabled(false)
+, _traceCallback(nullptr)
+, _traceContext(nullptr)
+{
+    reset();
+}
+
+void StatisticsCounters::setEnabled(bool isEnabled)
+{
+#ifdef TEXTPURIFIER_STATISTICS
+    if(isEnabled && nullptr == _histograms)
+    {
+        _histograms.reset(new LatencyHistogram[shardCount * phaseCount]);
+    }
+
+    // Measure the clock before the first call is timed.
+    PhaseClock::tickLength();
+    _isEnabled.store(isEnabled, memory_order_release);
+#else
+    (void)isEnabled;
+#endif
+}
+
+void StatisticsCounters::setTraceCallback(TextPurifier::TraceCallback callback, void* context)
+{
+#ifdef TEXTPURIFIER_STATISTICS
+    PhaseClock::tickLength();
+    _traceCallback = callback;
+    _traceContext = context;
+#else
+    (void)callback;
+    (void)context;
+#endif
+}
+
+void StatisticsCounters::addPhase(Phase phase, std::uint64_t start, std::uint64_t end)
+{
+    if(isEnabled())
+    {
+        const size_t shard = threadIndex() % shardCount;
+        _histograms[shard * phaseCount + static_cast<size_t>(phase)].add(end - start);
+    }
+
+    if(nullptr != _traceCallback)
+    {
+        _traceCallback(_traceContext,
+                       phase,
+                       PhaseClock::toNanoseconds(start),
+                       PhaseClock::toNanoseconds(end));
+    }
+}
+
+lakoo::RuntimeStatistics StatisticsCounters::snapshot() const
+{
+    uint64_t values[CounterCount] = {};
+    for(const Shard& shard : _shards)
+    {
+        for(size_t counter = 0; counter < CounterCount; ++counter)
+        {
+            values[counter] += shard._values[counter].load(memory_order_relaxed);
+        }
+    }
+
+    RuntimeStatistics statistics;
+    statistics._purifyCalls = values[PurifyCalls];
+    statistics._checkCalls = values[CheckCalls];
+    statistics._findCalls = values[FindCalls];
+    statistics._bytes = values[Bytes];
+    statistics._characters = values[Characters];
+    statistics._transitions = values[Transitions];
+    statistics._matches = values[Matches];
+    statistics._transcodingTime = values[TranscodingTime];
+    statistics._allocations = values[Allocations];
+    return statistics;
+}
+
+lakoo::LatencyStatistics StatisticsCounters::latency(Phase phase) const
+{
+    vector<uint64_t> counts(LatencyHistogram::bucketCount, 0);
+    if(nullptr == _histograms)
+    {
+        return LatencyHistogram::summarize(counts, 1.0);
+    }
+
+    for(size_t shard = 0; shard < shardCount; ++shard)
+    {
+        _histograms[shard * phaseCount + static_cast<size_t>(phase)].mergeTo(counts);
+    }
+
+    return LatencyHistogram::summarize(counts, PhaseClock::tickLength());
+}
+
+void StatisticsCounters::reset()
+{
+    for(Shard& shard : _shards)
+    {
+        for(atomic<uint64_t>& value : shard._values)
+        {
+            value.store(0, memory_order_relaxed);
+        }
+    }
+
+    if(nullptr != _histograms)
+    {
+        for(size_t index = 0; index < shardCount * phaseCount; ++index)
+        {
+            _histograms[index].clear();
+        }
+    }
+}
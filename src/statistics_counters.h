@@ -0,0 +1,247 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   statistics_counters.h
+ * @author Aludirk Wong
+ * @date   2017-08-15
+ */
+
+#ifndef __LAKOO_STATISTICS_COUNTERS_H__
+#define __LAKOO_STATISTICS_COUNTERS_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "heap_size.h"
+#include "latency_histogram.h"
+#include "text_purifier.h"
+
+
+//! To keep a statement only if the statistics are compiled in by --enable-statistics.
+#ifdef TEXTPURIFIER_STATISTICS
+#define LAKOO_STATISTICS(...) __VA_ARGS__
+#else
+#define LAKOO_STATISTICS(...)
+#endif
+
+
+namespace lakoo
+{
+    //! The index of the current thread, to spread the thread local counters over shards.
+    /**
+     * The threads are numbered in the order they first ask for it.
+     * @return The index of the thread.
+     */
+    inline std::size_t threadIndex()
+    {
+        static std::atomic<std::size_t> nextIndex(0);
+        static thread_local const std::size_t index =
+            nextIndex.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+
+    //! The runtime counters of TextPurifier.
+    /**
+     * The counters are spread over shards padded to separate cache lines, each thread adds to
+     * its own shard with relaxed atomics and the shards are only summed up for a snapshot. The
+     * latencies of the phases go to a LatencyHistogram of each shard and phase, allocated when
+     * the counters are first enabled. Unless the library is configured with --enable-statistics,
+     * isEnabled() and isTimed() are always \c false and every use of the counters is removed by
+     * the compiler.
+     */
+    class StatisticsCounters final
+    {
+    public:
+        //! The counters.
+        enum Counter
+        {
+            //! The number of calls to purify.
+            PurifyCalls,
+
+            //! The number of calls to check.
+            CheckCalls,
+
+            //! The number of calls to find.
+            FindCalls,
+
+            //! The number of bytes of UTF-8 or UTF-16 transcoded from the input.
+            Bytes,
+
+            //! The number of characters scanned.
+            Characters,
+
+            //! The number of automaton transitions taken.
+            Transitions,
+
+            //! The number of word segments found.
+            Matches,
+
+            //! The time of transcoding in nanoseconds.
+            TranscodingTime,
+
+            //! The number of times the scratch buffers grow.
+            Allocations,
+
+            //! The number of counters.
+            CounterCount
+        };
+
+    public:
+        //! Default constructor.
+        /**
+         * The counters are disabled.
+         */
+        StatisticsCounters();
+
+        //! Default destructor.
+        ~StatisticsCounters() = default;
+
+        //! Deleted copy constructor.
+        StatisticsCounters(const StatisticsCounters&) = delete;
+
+        //! Deleted assignment operator.
+        StatisticsCounters& operator=(const StatisticsCounters&) = delete;
+
+    public:
+        //! To enable or disable the counters, it is ignored if the statistics are compiled out.
+        /**
+         * @param [in] isEnabled Whether to enable the counters.
+         */
+        void setEnabled(bool isEnabled);
+
+        //! Whether the counters are enabled.
+        /**
+         * @return Whether the counters are enabled.
+         */
+        inline bool isEnabled() const
+        {
+#ifdef TEXTPURIFIER_STATISTICS
+            return _isEnabled.load(std::memory_order_acquire);
+#else
+            return false;
+#endif
+        }
+
+        //! Whether the phases are timed, for the counters or the trace callback.
+        /**
+         * @return Whether the phases are timed.
+         */
+        inline bool isTimed() const
+        {
+#ifdef TEXTPURIFIER_STATISTICS
+            return nullptr != _traceCallback || isEnabled();
+#else
+            return false;
+#endif
+        }
+
+        //! To set the callback to receive the time of every phase.
+        /**
+         * @param [in] callback The callback, nullptr to stop tracing.
+         * @param [in] context  The user context passed to the callback.
+         */
+        void setTraceCallback(TextPurifier::TraceCallback callback, void* context);
+
+        //! To add to a counter from the current thread.
+        /**
+         * @param [in] counter The counter.
+         * @param [in] value   The value to add.
+         */
+        inline void add(Counter counter, std::uint64_t value)
+        {
+            _shards[threadIndex() % shardCount]._values[counter].fetch_add(
+                value, std::memory_order_relaxed);
+        }
+
+        //! To record the time of a phase from the current thread, only if isTimed().
+        /**
+         * @param [in] phase The Phase.
+         * @param [in] start The tick the phase starts.
+         * @param [in] end   The tick the phase ends.
+         */
+        void addPhase(Phase phase, std::uint64_t start, std::uint64_t end);
+
+        //! To sum up the shards.
+        /**
+         * @return The RuntimeStatistics.
+         */
+        RuntimeStatistics snapshot() const;
+
+        //! To sum up the latencies of a phase.
+        /**
+         * @param [in] phase The Phase.
+         * @return           The LatencyStatistics.
+         */
+        LatencyStatistics latency(Phase phase) const;
+
+        //! The bytes of the counters on the heap, the counters themselves included.
+        /**
+         * @return The number of bytes, estimated by HeapSize.
+         */
+        inline std::size_t memoryUsage() const
+        {
+            return HeapSize::block(sizeof(StatisticsCounters)) +
+                   (nullptr != _histograms
+                    ? HeapSize::block(shardCount * phaseCount * sizeof(LatencyHistogram))
+                    : 0);
+        }
+
+        //! To reset all the counters and latencies to 0.
+        void reset();
+
+    private:
+        //! The counters of a shard.
+        struct Shard final
+        {
+            //! The values of the counters.
+            std::atomic<std::uint64_t> _values[CounterCount];
+
+            //! The padding to keep the next shard out of the cache lines of this shard.
+            char _padding[64];
+        };
+
+    private:
+        //! The number of shards.
+        static const std::size_t shardCount = 16;
+
+        //! The number of phases.
+        static const std::size_t phaseCount = static_cast<std::size_t>(Phase::Total) + 1;
+
+        //! The shards.
+        Shard _shards[shardCount];
+
+        //! The histograms of the latencies, #phaseCount for each shard, nullptr until enabled.
+        std::unique_ptr<LatencyHistogram[]> _histograms;
+
+        //! Whether the counters are enabled.
+        std::atomic<bool> _isEnabled;
+
+        //! The callback to receive the time of every phase.
+        TextPurifier::TraceCallback _traceCallback;
+
+        //! The user context passed to the trace callback.
+        void* _traceContext;
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_STATISTICS_COUNTERS_H__
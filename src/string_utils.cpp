@@ -26,9 +26,9 @@
 #include "string_utils.h"
 
 #include <algorithm>
-#include <clocale>
-#include <cstdlib>
+#include <cstdint>
 #include <cstring>
+#include <cwchar>
 
 
 using namespace lakoo;
@@ -36,6 +36,26 @@ using namespace lakoo::StringUtils;
 using namespace std;
 
 
+const std::uint32_t StringUtils::wordCharacterBitmap[] = {
+    0x00000000U, 0x03FF0000U, 0x87FFFFFEU, 0x07FFFFFEU,
+    0x00000000U, 0x762C0400U, 0xFF7FFFFFU, 0xFF7FFFFFU,
+    0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU,
+    0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU,
+    0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU,
+    0xFFFFFFFFU, 0xFFFFFFFFU, 0x0003FFC3U, 0x0000501FU,
+    0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU, 0xBCDFFFFFU,
+    0xFFFFD740U, 0xFFFFFFFBU, 0xFFFFFFFFU, 0xFFBFFFFFU,
+    0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU,
+    0xFFFFFCFBU, 0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU,
+    0xFFFFFFFFU, 0xFFFEFFFFU, 0x027FFFFFU, 0xFFFFFFFFU,
+    0xFFFE01FFU, 0xBFFFFFFFU, 0xFFFF00B6U, 0x000787FFU,
+    0x07FF0000U, 0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFC3FFU,
+    0xFFFFFFFFU, 0xFFFFFFFFU, 0x9FEFFFFFU, 0x9FFFFDFFU,
+    0xFFFF0000U, 0xFFFFFFFFU, 0xFFFFE7FFU, 0xFFFFFFFFU,
+    0xFFFFFFFFU, 0x0003FFFFU, 0xFFFFFFFFU, 0x243FFFFFU
+};
+
+
 std::wstring StringUtils::replace(std::wstring str, const std::wstring& from, const std::wstring& to)
 {
     wstring::size_type begin = 0UL;
@@ -69,30 +89,201 @@ std::wstring StringUtils::toLowerCase(std::wstring str)
     return str;
 }
 
+void StringUtils::toLowerCase(const wchar_t* str, std::size_t size, std::wstring& result)
+{
+    result.assign(str, size);
+    transform(result.begin(), result.end(), result.begin(), ::tolower);
+}
+
+void StringUtils::utf8ToWStr(const char* str, std::size_t size, std::wstring& result)
+{
+    // The number of characters never exceeds the number of bytes.
+    result.resize(size);
+
+    const unsigned char* input = reinterpret_cast<const unsigned char*>(str);
+    size_t length = 0UL;
+    size_t index = 0UL;
+    while(index < size)
+    {
+        const unsigned char lead = input[index];
+        if(lead < 0x80U)
+        {
+            result[length++] = static_cast<wchar_t>(lead);
+            ++index;
+            continue;
+        }
+
+        size_t trail = 0UL;
+        uint32_t codePoint = 0U;
+        uint32_t minimum = 0U;
+        if(0xC0U == (lead & 0xE0U))
+        {
+            trail = 1UL;
+            codePoint = lead & 0x1FU;
+            minimum = 0x80U;
+        }
+        else if(0xE0U == (lead & 0xF0U))
+        {
+            trail = 2UL;
+            codePoint = lead & 0x0FU;
+            minimum = 0x800U;
+        }
+        else if(0xF0U == (lead & 0xF8U))
+        {
+            trail = 3UL;
+            codePoint = lead & 0x07U;
+            minimum = 0x10000U;
+        }
+
+        size_t next = index + 1UL;
+        bool isValid = trail > 0UL && index + trail < size;
+        for(; isValid && next <= index + trail; ++next)
+        {
+            if(0x80U != (input[next] & 0xC0U))
+            {
+                isValid = false;
+                break;
+            }
+            codePoint = (codePoint << 6) | (input[next] & 0x3FU);
+        }
+
+        if(isValid &&
+           codePoint >= minimum &&
+           codePoint <= 0x10FFFFU &&
+           (codePoint < 0xD800U || codePoint > 0xDFFFU))
+        {
+            result[length++] = static_cast<wchar_t>(codePoint);
+        }
+        else
+        {
+            result[length++] = L'\xFFFD';
+        }
+        index = next;
+    }
+
+    result.resize(length);
+}
+
+void StringUtils::wStrToUtf8(const wchar_t* str, std::size_t size, std::string& result)
+{
+    result.clear();
+    appendUtf8(str, size, result);
+}
+
+void StringUtils::appendUtf8(const wchar_t* str, std::size_t size, std::string& result)
+{
+    // Each character takes at most 4 bytes.
+    size_t length = result.size();
+    result.resize(length + size * 4UL);
+
+    for(size_t index = 0UL; index < size; ++index)
+    {
+        const uint32_t codePoint = static_cast<uint32_t>(str[index]);
+        if(codePoint < 0x80U)
+        {
+            result[length++] = static_cast<char>(codePoint);
+        }
+        else if(codePoint < 0x800U)
+        {
+            result[length++] = static_cast<char>(0xC0U | (codePoint >> 6));
+            result[length++] = static_cast<char>(0x80U | (codePoint & 0x3FU));
+        }
+        else if(codePoint < 0x10000U)
+        {
+            result[length++] = static_cast<char>(0xE0U | (codePoint >> 12));
+            result[length++] = static_cast<char>(0x80U | ((codePoint >> 6) & 0x3FU));
+            result[length++] = static_cast<char>(0x80U | (codePoint & 0x3FU));
+        }
+        else
+        {
+            result[length++] = static_cast<char>(0xF0U | ((codePoint >> 18) & 0x07U));
+            result[length++] = static_cast<char>(0x80U | ((codePoint >> 12) & 0x3FU));
+            result[length++] = static_cast<char>(0x80U | ((codePoint >> 6) & 0x3FU));
+            result[length++] = static_cast<char>(0x80U | (codePoint & 0x3FU));
+        }
+    }
+
+    result.resize(length);
+}
+
+void StringUtils::utf16ToWStr(const char16_t* str, std::size_t size, std::wstring& result)
+{
+    // The number of characters never exceeds the number of code units.
+    result.resize(size);
+
+    size_t length = 0UL;
+    for(size_t index = 0UL; index < size; ++index)
+    {
+        const uint32_t unit = str[index];
+        if(unit >= 0xD800U && unit <= 0xDBFFU && index + 1UL < size &&
+           str[index + 1UL] >= 0xDC00U && str[index + 1UL] <= 0xDFFFU)
+        {
+            result[length++] = static_cast<wchar_t>(
+                0x10000U + ((unit - 0xD800U) << 10) + (str[index + 1UL] - 0xDC00U));
+            ++index;
+        }
+        else
+        {
+            result[length++] = static_cast<wchar_t>(unit);
+        }
+    }
+
+    result.resize(length);
+}
+
+void StringUtils::wStrToUtf16(const wchar_t* str, std::size_t size, std::u16string& result)
+{
+    result.clear();
+    appendUtf16(str, size, result);
+}
+
+void StringUtils::appendUtf16(const wchar_t* str, std::size_t size, std::u16string& result)
+{
+    // Each character takes at most 2 code units.
+    size_t length = result.size();
+    result.resize(length + size * 2UL);
+
+    for(size_t index = 0UL; index < size; ++index)
+    {
+        const uint32_t codePoint = static_cast<uint32_t>(str[index]);
+        if(codePoint < 0x10000U || codePoint > 0x10FFFFU)
+        {
+            // Beyond the range of Unicode, only the low 16 bits can be kept.
+            result[length++] = static_cast<char16_t>(codePoint);
+        }
+        else
+        {
+            result[length++] = static_cast<char16_t>(0xD800U + ((codePoint - 0x10000U) >> 10));
+            result[length++] = static_cast<char16_t>(0xDC00U + ((codePoint - 0x10000U) & 0x3FFU));
+        }
+    }
+
+    result.resize(length);
+}
+
 std::wstring StringUtils::strToWStr(const std::string& str)
 {
-    return cStrToWStr(str.c_str());
+    wstring wStr;
+    utf8ToWStr(str.data(), str.size(), wStr);
+
+    return wStr;
 }
 
 std::wstring StringUtils::cStrToWStr(const char* str)
 {
-    const wchar_t* wcStr = cStrToWcStr(str);
-    wstring wStr(wcStr);
-    freeWcStr(wcStr);
+    wstring wStr;
+    utf8ToWStr(str, strlen(str), wStr);
 
     return wStr;
 }
 
 const wchar_t* StringUtils::cStrToWcStr(const char* str)
 {
-    const char* const currentLocale = setlocale(LC_ALL, "C.UTF-8");
-    const size_t size = mbstowcs(nullptr, str, 0UL) + 1UL;
+    const wstring wStr = cStrToWStr(str);
+    const size_t size = wStr.length() + 1UL;
 
     wchar_t* wcStr = new wchar_t[size];
-    wmemset(wcStr, 0, size);
-    mbstowcs(wcStr, str, size);
-
-    setlocale(LC_ALL, currentLocale);
+    wmemcpy(wcStr, wStr.c_str(), size);
     return wcStr;
 }
 
@@ -106,23 +297,20 @@ void StringUtils::freeWcStr(const wchar_t* str)
 
 std::string StringUtils::wStrToStr(const std::wstring& str)
 {
-    const char* cStr = wcStrToCStr(str.c_str());
-    string sStr(cStr);
-    freeCStr(cStr);
+    string sStr;
+    wStrToUtf8(str.data(), str.size(), sStr);
 
     return sStr;
 }
 
 const char* StringUtils::wcStrToCStr(const wchar_t* str)
 {
-    const char* const currentLocale = setlocale(LC_ALL, "C.UTF-8");
-    const size_t size = wcstombs(nullptr, str, 0UL) + 1UL;
+    string sStr;
+    wStrToUtf8(str, wcslen(str), sStr);
+    const size_t size = sStr.length() + 1UL;
 
     char* cStr = new char[size];
-    memset(cStr, 0, size);
-    wcstombs(cStr, str, size);
-
-    setlocale(LC_ALL, currentLocale);
+    memcpy(cStr, sStr.c_str(), size);
     return cStr;
 }
 
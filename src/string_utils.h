@@ -26,6 +26,8 @@
 #ifndef __LAKOO_STRING_UTILS_H__
 #define __LAKOO_STRING_UTILS_H__
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 
@@ -57,6 +59,109 @@ namespace lakoo
          */
         std::wstring toLowerCase(std::wstring str);
 
+        /**
+         * @overload
+         * @param [in]  str    The string to transform.
+         * @param [in]  size   The length of the string.
+         * @param [out] result The buffer to receive the transformed string, its memory is reused.
+         */
+        void toLowerCase(const wchar_t* str, std::size_t size, std::wstring& result);
+
+        //! Convert UTF-8 string to std::wstring without touching the locale.
+        /**
+         * Invalid sequences are converted to U+FFFD.
+         * @param [in]  str    The UTF-8 string to convert.
+         * @param [in]  size   The length of the string in bytes.
+         * @param [out] result The buffer to receive the converted string, its memory is reused.
+         */
+        void utf8ToWStr(const char* str, std::size_t size, std::wstring& result);
+
+        //! Convert wchar_t string to UTF-8 string without touching the locale.
+        /**
+         * @param [in]  str    The wchar_t string to convert.
+         * @param [in]  size   The length of the string.
+         * @param [out] result The buffer to receive the converted string, its memory is reused.
+         */
+        void wStrToUtf8(const wchar_t* str, std::size_t size, std::string& result);
+
+        //! Convert wchar_t string to UTF-8 and append it to a string.
+        /**
+         * @param [in]     str    The wchar_t string to convert.
+         * @param [in]     size   The length of the string.
+         * @param [in,out] result The string to append the converted string to.
+         */
+        void appendUtf8(const wchar_t* str, std::size_t size, std::string& result);
+
+        //! Convert UTF-16 string to std::wstring, joining the surrogate pairs.
+        /**
+         * A lone surrogate is kept as it is, so that the string converts back unchanged.
+         * @param [in]  str    The UTF-16 string to convert.
+         * @param [in]  size   The length of the string in code units.
+         * @param [out] result The buffer to receive the converted string, its memory is reused.
+         */
+        void utf16ToWStr(const char16_t* str, std::size_t size, std::wstring& result);
+
+        //! Convert wchar_t string to UTF-16 string, splitting the supplementary characters.
+        /**
+         * @param [in]  str    The wchar_t string to convert.
+         * @param [in]  size   The length of the string.
+         * @param [out] result The buffer to receive the converted string, its memory is reused.
+         */
+        void wStrToUtf16(const wchar_t* str, std::size_t size, std::u16string& result);
+
+        //! Convert wchar_t string to UTF-16 and append it to a string.
+        /**
+         * @param [in]     str    The wchar_t string to convert.
+         * @param [in]     size   The length of the string.
+         * @param [in,out] result The string to append the converted string to.
+         */
+        void appendUtf16(const wchar_t* str, std::size_t size, std::u16string& result);
+
+        //! The number of characters covered by wordCharacterBitmap.
+        const std::size_t wordCharacterTableSize = 0x800UL;
+
+        //! The bitmap of word characters (letters, digits, marks and underscore) below U+0800.
+        /**
+         * It covers the alphabetic scripts such as Latin, Greek, Cyrillic, Hebrew and Arabic, it is
+         * generated from the Unicode character database.
+         */
+        extern const std::uint32_t wordCharacterBitmap[wordCharacterTableSize / 32UL];
+
+        //! Whether the character forms part of a word in an alphabetic script.
+        /**
+         * CJK characters are never word characters, so that words in CJK are matched as
+         * substrings.
+         * @param [in] ch The character to check.
+         * @return        Whether the character is a word character.
+         */
+        inline bool isWordCharacter(wchar_t ch)
+        {
+            const std::size_t index = static_cast<std::size_t>(ch);
+            if(index < wordCharacterTableSize)
+            {
+                return 0U != (wordCharacterBitmap[index / 32UL] & (1U << (index % 32UL)));
+            }
+
+            // Latin Extended Additional and Greek Extended.
+            return index >= 0x1E00UL && index <= 0x1FFFUL;
+        }
+
+        //! Whether there is a word boundary before the given position.
+        /**
+         * @param [in] str   The string to check.
+         * @param [in] size  The length of the string.
+         * @param [in] index The position to check, from 0 to size.
+         * @return           Whether the characters around the position are not both word
+         *                   characters.
+         */
+        inline bool isWordBoundary(const wchar_t* str, std::size_t size, std::size_t index)
+        {
+            return 0UL == index ||
+                   size <= index ||
+                   !isWordCharacter(str[index - 1UL]) ||
+                   !isWordCharacter(str[index]);
+        }
+
         //! Convert std::string to std::wstring.
         /**
          * @param [in] str The std::string to convert.
@@ -25,7 +25,21 @@
 
 #include "text_purifier.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <fstream>
+#include <functional>
+
 #include "filter_list.h"
+#include "heap_size.h"
+#include "hit_sketch.h"
+#include "mask_policy.h"
+#include "phase_clock.h"
+#include "result_cache.h"
+#include "scan_buffer.h"
+#include "statistics_counters.h"
 #include "string_utils.h"
 
 
@@ -34,28 +48,341 @@ using namespace lakoo::StringUtils;
 using namespace std;
 
 
+namespace
+{
+    //! The number of matched word segments handed over to the visitor of find at a time.
+    const size_t matchBatchSize = 64;
+
+    //! To time a phase till the end of the scope, if the phases are timed.
+    class PhaseTimer final
+    {
+    public:
+        //! Constructor.
+        /**
+         * @param [in,out] statistics The runtime counters.
+         * @param [in]     phase      The Phase.
+         */
+        PhaseTimer(StatisticsCounters& statistics, Phase phase)
+        : _statistics(statistics)
+        , _phase(phase)
+        , _isTimed(statistics.isTimed())
+        , _start(_isTimed ? PhaseClock::now() : 0)
+        {
+        }
+
+        //! Destructor.
+        ~PhaseTimer()
+        {
+            if(_isTimed)
+            {
+                _statistics.addPhase(_phase, _start, PhaseClock::now());
+            }
+        }
+
+        //! Deleted copy constructor.
+        PhaseTimer(const PhaseTimer&) = delete;
+
+        //! Deleted assignment operator.
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    private:
+        //! The runtime counters.
+        StatisticsCounters& _statistics;
+
+        //! The Phase.
+        const Phase _phase;
+
+        //! Whether the phase is timed.
+        const bool _isTimed;
+
+        //! The tick the phase starts.
+        const uint64_t _start;
+    };
+
+    //! To transcode UTF-8 to a wide string.
+    inline void toWStr(const char* str, size_t size, wstring& output)
+    {
+        utf8ToWStr(str, size, output);
+    }
+
+    //! To transcode UTF-16 to a wide string.
+    inline void toWStr(const char16_t* str, size_t size, wstring& output)
+    {
+        utf16ToWStr(str, size, output);
+    }
+
+    //! To copy a wide string.
+    inline void fromWStr(const wstring& str, wstring& output)
+    {
+        output.assign(str);
+    }
+
+    //! To transcode a wide string to UTF-8.
+    inline void fromWStr(const wstring& str, string& output)
+    {
+        wStrToUtf8(str.data(), str.size(), output);
+    }
+
+    //! To transcode a wide string to UTF-16.
+    inline void fromWStr(const wstring& str, u16string& output)
+    {
+        wStrToUtf16(str.data(), str.size(), output);
+    }
+
+    //! To copy a string out of the result it points into, so that the result can be rewritten.
+    /**
+     * @param [in]  str    The string.
+     * @param [in]  size   The length of the string.
+     * @param [in]  result The result to be rewritten.
+     * @param [out] copy   The copy of the string, if it points into the result.
+     * @return             The string, or the copy if it points into the result.
+     */
+    inline const wchar_t* unaliased(const wchar_t* str,
+                                    size_t size,
+                                    const wstring& result,
+                                    wstring& copy)
+    {
+        const less<const wchar_t*> isBefore;
+        if(isBefore(str, result.data()) || !isBefore(str, result.data() + result.size() + 1))
+        {
+            return str;
+        }
+
+        copy.assign(str, size);
+        return copy.data();
+    }
+
+    //! To transcode the UTF-8 or UTF-16 input, timed if the phases are timed.
+    template <typename _Char>
+    void decode(StatisticsCounters& statistics, const _Char* str, size_t size, wstring& output)
+    {
+        if(!statistics.isTimed())
+        {
+            toWStr(str, size, output);
+            return;
+        }
+
+        const size_t capacity = output.capacity();
+        const uint64_t start = PhaseClock::now();
+        toWStr(str, size, output);
+        const uint64_t end = PhaseClock::now();
+
+        statistics.addPhase(Phase::TranscodeIn, start, end);
+        if(statistics.isEnabled())
+        {
+            statistics.add(StatisticsCounters::Bytes, size * sizeof(_Char));
+            statistics.add(StatisticsCounters::TranscodingTime,
+                           PhaseClock::toNanoseconds(end - start));
+            if(output.capacity() > capacity)
+            {
+                statistics.add(StatisticsCounters::Allocations, 1);
+            }
+        }
+    }
+
+    //! To transcode the purified string to UTF-8 or UTF-16, timed if the phases are timed.
+    template <typename _String>
+    void encode(StatisticsCounters& statistics, const wstring& str, _String& output)
+    {
+        if(!statistics.isTimed())
+        {
+            fromWStr(str, output);
+            return;
+        }
+
+        const size_t capacity = output.capacity();
+        const uint64_t start = PhaseClock::now();
+        fromWStr(str, output);
+        const uint64_t end = PhaseClock::now();
+
+        statistics.addPhase(Phase::TranscodeOut, start, end);
+        if(statistics.isEnabled())
+        {
+            statistics.add(StatisticsCounters::TranscodingTime,
+                           PhaseClock::toNanoseconds(end - start));
+            if(output.capacity() > capacity)
+            {
+                statistics.add(StatisticsCounters::Allocations, 1);
+            }
+        }
+    }
+
+    //! To add the hits of the words of a cached result to the HitSketch, if there is one.
+    inline void replayHits(HitSketch* hitSketch, const vector<size_t>& wordIds)
+    {
+        if(nullptr != hitSketch)
+        {
+            for(size_t wordId : wordIds)
+            {
+                hitSketch->add(wordId);
+            }
+        }
+    }
+
+    //! To append wide text to a wide string.
+    inline void appendText(const wchar_t* str, size_t size, wstring& output)
+    {
+        output.append(str, size);
+    }
+
+    //! To append wide text to a UTF-8 string.
+    inline void appendText(const wchar_t* str, size_t size, string& output)
+    {
+        appendUtf8(str, size, output);
+    }
+
+    //! To append wide text to a UTF-16 string.
+    inline void appendText(const wchar_t* str, size_t size, u16string& output)
+    {
+        appendUtf16(str, size, output);
+    }
+
+    //! The wide mask.
+    inline const wstring& encoded(const MaskTable::Mask& mask, const wstring&)
+    {
+        return mask._wide;
+    }
+
+    //! The UTF-8 mask.
+    inline const string& encoded(const MaskTable::Mask& mask, const string&)
+    {
+        return mask._utf8;
+    }
+
+    //! The UTF-16 mask.
+    inline const u16string& encoded(const MaskTable::Mask& mask, const u16string&)
+    {
+        return mask._utf16;
+    }
+
+    //! To append the mask of a span by the masks of a MaskPolicy.
+    template <typename _String>
+    void appendMask(const MaskTable& table,
+                    size_t wordId,
+                    size_t length,
+                    wstring& callbackMask,
+                    _String& output)
+    {
+        if(nullptr != table._callback)
+        {
+            callbackMask.clear();
+            table._callback(table._context, wordId, length, callbackMask);
+            appendText(callbackMask.data(), callbackMask.size(), output);
+            return;
+        }
+
+        const _String& mask = encoded(table.mask(wordId), output);
+        if(!table._isMatchSize)
+        {
+            output.append(mask);
+            return;
+        }
+
+        for(size_t index = 0UL; index < length; ++index)
+        {
+            output.append(mask);
+        }
+    }
+
+    //! To find the word segments and time folding the case and scanning apart.
+    template <typename _Visitor>
+    bool findTimed(const FilterList& filterList,
+                   StatisticsCounters& statistics,
+                   const wchar_t* str,
+                   size_t size,
+                   ScanBuffer& buffer,
+                   _Visitor&& visitor)
+    {
+        const uint64_t start = PhaseClock::now();
+        buffer._isTimed = true;
+        buffer._foldEnd = start;
+        const bool isFinished = filterList.find(str, size, buffer, forward<_Visitor>(visitor));
+        buffer._isTimed = false;
+        const uint64_t end = PhaseClock::now();
+
+        statistics.addPhase(Phase::CaseFold, start, buffer._foldEnd);
+        statistics.addPhase(Phase::Scan, buffer._foldEnd, end);
+        return isFinished;
+    }
+
+    //! To add the counters of a scan.
+    void countScan(StatisticsCounters& statistics,
+                   const ScanBuffer& buffer,
+                   size_t size,
+                   size_t capacity)
+    {
+        statistics.add(StatisticsCounters::Characters, size);
+        statistics.add(StatisticsCounters::Transitions, buffer._transitions);
+        statistics.add(StatisticsCounters::Matches, buffer._matches);
+        if(buffer.capacity() > capacity)
+        {
+            statistics.add(StatisticsCounters::Allocations, 1);
+        }
+    }
+}
+
+
+ScanContext::ScanContext()
+: _buffer(unique_ptr<ScanBuffer>(new ScanBuffer()))
+{
+}
+
+ScanContext::~ScanContext()
+{
+}
+
+void ScanContext::clear()
+{
+    _buffer.reset(new ScanBuffer());
+}
+
+std::size_t ScanContext::memoryUsage() const
+{
+    return HeapSize::block(sizeof(ScanBuffer)) + _buffer->memoryUsage();
+}
+
+bool ScanContext::isFound() const
+{
+    return _buffer->_isFound;
+}
+
 TextPurifier::TextPurifier()
 : _filterList(unique_ptr<FilterList>(new FilterList()))
+, _cache(unique_ptr<ResultCache>(new ResultCache()))
+, _statistics(unique_ptr<StatisticsCounters>(new StatisticsCounters()))
+, _hitSketch()
 {
 }
 
 TextPurifier::TextPurifier(const std::list<std::wstring>& list)
 : _filterList(unique_ptr<FilterList>(new FilterList(list)))
+, _cache(unique_ptr<ResultCache>(new ResultCache()))
+, _statistics(unique_ptr<StatisticsCounters>(new StatisticsCounters()))
+, _hitSketch()
 {
 }
 
 TextPurifier::TextPurifier(const std::list<std::string>& list)
 : _filterList(unique_ptr<FilterList>(new FilterList(list)))
+, _cache(unique_ptr<ResultCache>(new ResultCache()))
+, _statistics(unique_ptr<StatisticsCounters>(new StatisticsCounters()))
+, _hitSketch()
 {
 }
 
 TextPurifier::TextPurifier(const wchar_t* const* list, std::size_t count)
 : _filterList(unique_ptr<FilterList>(new FilterList(list, count)))
+, _cache(unique_ptr<ResultCache>(new ResultCache()))
+, _statistics(unique_ptr<StatisticsCounters>(new StatisticsCounters()))
+, _hitSketch()
 {
 }
 
 TextPurifier::TextPurifier(const char* const* list, std::size_t count)
 : _filterList(unique_ptr<FilterList>(new FilterList(list, count)))
+, _cache(unique_ptr<ResultCache>(new ResultCache()))
+, _statistics(unique_ptr<StatisticsCounters>(new StatisticsCounters()))
+, _hitSketch()
 {
 }
 
@@ -63,6 +390,116 @@ TextPurifier::~TextPurifier()
 {
 }
 
+void TextPurifier::setMatchMode(MatchMode mode)
+{
+    _filterList->setMatchMode(mode);
+}
+
+MatchMode TextPurifier::matchMode() const
+{
+    return _filterList->matchMode();
+}
+
+void TextPurifier::setWordBoundary(bool isWordBoundary)
+{
+    _filterList->setWordBoundary(isWordBoundary);
+}
+
+bool TextPurifier::isWordBoundary() const
+{
+    return _filterList->isWordBoundary();
+}
+
+void TextPurifier::setMaxGap(std::size_t maxGap)
+{
+    _filterList->setMaxGap(maxGap);
+}
+
+std::size_t TextPurifier::maxGap() const
+{
+    return _filterList->maxGap();
+}
+
+void TextPurifier::setMaxDistance(std::size_t maxDistance)
+{
+    _filterList->setMaxDistance(maxDistance);
+}
+
+std::size_t TextPurifier::maxDistance() const
+{
+    return _filterList->maxDistance();
+}
+
+void TextPurifier::setCacheSize(std::size_t size)
+{
+    _cache->setCapacity(size);
+}
+
+std::size_t TextPurifier::cacheSize() const
+{
+    return _cache->capacity();
+}
+
+lakoo::CacheStatistics TextPurifier::cacheStatistics() const
+{
+    return _cache->statistics();
+}
+
+void TextPurifier::setStatisticsEnabled(bool isEnabled)
+{
+    _statistics->setEnabled(isEnabled);
+}
+
+bool TextPurifier::isStatisticsEnabled() const
+{
+    return _statistics->isEnabled();
+}
+
+lakoo::RuntimeStatistics TextPurifier::statistics() const
+{
+    return _statistics->snapshot();
+}
+
+void TextPurifier::resetStatistics()
+{
+    _statistics->reset();
+}
+
+lakoo::LatencyStatistics TextPurifier::latencyStatistics(Phase phase) const
+{
+    return _statistics->latency(phase);
+}
+
+void TextPurifier::setTraceCallback(TraceCallback callback, void* context)
+{
+    _statistics->setTraceCallback(callback, context);
+}
+
+void TextPurifier::setHitSketchWidth(std::size_t width)
+{
+    _hitSketch.reset(0 == width ? nullptr : new HitSketch(width));
+}
+
+std::size_t TextPurifier::hitSketchWidth() const
+{
+    return nullptr == _hitSketch ? 0 : _hitSketch->width();
+}
+
+std::uint64_t TextPurifier::wordHits(std::size_t wordId) const
+{
+    return nullptr == _hitSketch ? 0 : _hitSketch->estimate(wordId);
+}
+
+std::vector<lakoo::WordHits> TextPurifier::topWords(std::size_t count) const
+{
+    if(nullptr == _hitSketch)
+    {
+        return vector<WordHits>();
+    }
+
+    return _hitSketch->top(count, _filterList->size());
+}
+
 void TextPurifier::add(const std::wstring& str)
 {
     _filterList->add(str);
@@ -103,188 +540,1018 @@ void TextPurifier::add(const char* const* list, std::size_t count)
     _filterList->add(list, count);
 }
 
-std::wstring TextPurifier::purify(const std::wstring& str, const std::wstring& mask) const
+bool TextPurifier::addFile(const std::string& path)
 {
-    wstring result(str);
-    return purify(result, mask);
+    return _filterList->addFile(path, 0);
 }
 
-std::wstring TextPurifier::purify(const std::wstring& str, const wchar_t* mask) const
+bool TextPurifier::addFile(const std::string& path, std::size_t threadCount)
 {
-    return purify(str, wstring(mask));
+    return _filterList->addFile(path, threadCount);
 }
 
-std::wstring TextPurifier::purify(const std::wstring& str, wchar_t mask, bool isMatchSize) const
+void TextPurifier::addWords(const char* data, std::size_t size)
 {
-    wstring result(str);
-    return purify(result, mask, isMatchSize);
+    _filterList->addWords(data, size, 0);
 }
 
-std::wstring& TextPurifier::purify(std::wstring& str, const std::wstring& mask) const
+void TextPurifier::addWords(const char* data, std::size_t size, std::size_t threadCount)
 {
-    long offset = 0L;
-    for(const WordSegment& segment : _filterList->find(str))
-    {
-        str.replace(segment._start + offset, segment._length, mask);
-        offset += mask.length() - segment._length;
-    }
-    return str;
+    _filterList->addWords(data, size, threadCount);
 }
 
-std::wstring& TextPurifier::purify(std::wstring& str, const wchar_t* mask) const
+void TextPurifier::addPattern(const std::wstring& str)
 {
-    // cppcheck-suppress returnTempReference
-    return purify(str, wstring(mask));
+    _filterList->addPattern(str);
 }
 
-std::wstring& TextPurifier::purify(std::wstring& str, wchar_t mask, bool isMatchSize) const
+void TextPurifier::addPattern(const std::string& str)
 {
-    if(isMatchSize)
-    {
-        for(const WordSegment& segment : _filterList->find(str))
-        {
-            str.replace(segment._start, segment._length, segment._length, mask);
-        }
-        return str;
-    }
-    else
-    {
-        // cppcheck-suppress returnTempReference
-        return purify(str, wstring(1, mask));
-    }
+    _filterList->addPattern(str);
 }
 
-std::string TextPurifier::purify(const std::string& str, const std::string& mask) const
+void TextPurifier::addPattern(const wchar_t* str)
 {
-    wstring wStr = strToWStr(str);
-    purify(wStr, strToWStr(mask));
+    _filterList->addPattern(str);
+}
 
-    return wStrToStr(wStr);
+void TextPurifier::addPattern(const char* str)
+{
+    _filterList->addPattern(str);
 }
 
-std::string TextPurifier::purify(const std::string& str, const char* mask) const
+void TextPurifier::compile()
 {
-    return purify(str, string(mask));
+    _filterList->compile();
 }
 
-std::string TextPurifier::purify(const std::string& str, char mask, bool isMatchSize) const
+bool TextPurifier::isCompiled() const
 {
-    if(isMatchSize)
-    {
-        wstring wStr = strToWStr(str);
-        purify(wStr, strToWStr(string(1, mask))[0], isMatchSize);
+    return _filterList->isCompiled();
+}
 
-        return wStrToStr(wStr);
-    }
-    else
+std::size_t TextPurifier::nodeCount() const
+{
+    return _filterList->nodeCount();
+}
+
+lakoo::MemoryUsage TextPurifier::memoryUsage() const
+{
+    MemoryUsage result{0, 0, 0, 0, 0, 0};
+    _filterList->memoryUsage(result);
+    result._metadata += _statistics->memoryUsage();
+    if(nullptr != _hitSketch)
     {
-        return purify(str, string(1, mask));
+        result._metadata += _hitSketch->memoryUsage();
     }
+    result._cache = _cache->memoryUsage();
+    result._total = result._nodes + result._edges + result._tables + result._metadata +
+                    result._cache;
+    return result;
 }
 
-std::string& TextPurifier::purify(std::string& str, const std::string& mask) const
+void TextPurifier::setMemoryBudget(std::size_t bytes)
 {
-    str = purify(const_cast<const string&>(str), mask);
-    return str;
+    _filterList->setMemoryBudget(bytes);
 }
 
-std::string& TextPurifier::purify(std::string& str, const char* mask) const
+std::size_t TextPurifier::memoryBudget() const
 {
-    str = purify(const_cast<const string&>(str), string(mask));
-    return str;
+    return _filterList->memoryBudget();
 }
 
-std::string& TextPurifier::purify(std::string& str, char mask, bool isMatchSize) const
+bool TextPurifier::setBase(const TextPurifier& base)
 {
-    str = purify(const_cast<const string&>(str), mask, isMatchSize);
-    return str;
+    return _filterList->setBase(*base._filterList);
 }
 
-const wchar_t* TextPurifier::purify(const wchar_t* str, const wchar_t* mask) const
+void TextPurifier::clearBase()
 {
-    wstring wStr(str);
-    purify(wStr, wstring(mask));
+    _filterList->clearBase();
+}
 
-    size_t size = wStr.length() + 1;
-    wchar_t* wcStr = new wchar_t[size];
-    wmemset(wcStr, 0, size);
-    wcscpy(wcStr, wStr.c_str());
-    return wcStr;
+bool TextPurifier::hasBase() const
+{
+    return _filterList->hasBase();
 }
 
-const wchar_t* TextPurifier::purify(const wchar_t* str, wchar_t mask, bool isMatchSize) const
+bool TextPurifier::recordVisits(const std::string& text, std::vector<std::uint64_t>& visits) const
 {
-    if(isMatchSize)
-    {
-        wstring wStr(str);
-        purify(wStr, mask, isMatchSize);
+    ScanBuffer buffer;
+    utf8ToWStr(text.data(), text.size(), buffer._text);
+    return _filterList->recordVisits(buffer._text.data(), buffer._text.size(), buffer, visits);
+}
 
-        size_t size = wStr.length() + 1;
-        wchar_t* wcStr = new wchar_t[size];
-        wmemset(wcStr, 0, size);
-        wcscpy(wcStr, wStr.c_str());
-        return wcStr;
-    }
-    else
-    {
-        const wchar_t maskStr[2] = {mask, L'\0'};
-        return purify(str, maskStr);
-    }
+bool TextPurifier::orderNodes(const std::vector<std::uint64_t>& visits)
+{
+    return _filterList->orderNodes(visits);
 }
 
-void TextPurifier::freePurifiedString(const wchar_t* str) const
+bool TextPurifier::orderNodes(const std::list<std::string>& samples)
 {
-    if(nullptr != str)
+    vector<uint64_t> visits;
+    for(const string& sample : samples)
     {
-        delete [] str;
+        if(!recordVisits(sample, visits))
+        {
+            return false;
+        }
     }
+    return _filterList->orderNodes(visits);
 }
 
-const char* TextPurifier::purify(const char* str, const char* mask) const
+void TextPurifier::setHugePage(bool isHugePage)
 {
-    wstring wStr(cStrToWStr(str));
-    purify(wStr, cStrToWStr(mask));
-
-    return wcStrToCStr(wStr.c_str());
+    _filterList->setHugePage(isHugePage);
 }
 
-const char* TextPurifier::purify(const char* str, char mask, bool isMatchSize) const
+bool TextPurifier::isHugePage() const
 {
-    if(isMatchSize)
-    {
-        wstring wStr(cStrToWStr(str));
-        purify(wStr, strToWStr(string(1, mask))[0], isMatchSize);
+    return _filterList->isHugePage();
+}
 
-        return wcStrToCStr(wStr.c_str());
-    }
-    else
-    {
-        const char maskStr[2] = {mask, '\0'};
-        return purify(str, maskStr);
-    }
+void TextPurifier::setNumaReplicated(bool isNumaReplicated)
+{
+    _filterList->setNumaReplicated(isNumaReplicated);
 }
 
-void TextPurifier::freePurifiedString(const char* str) const
+bool TextPurifier::isNumaReplicated() const
 {
-    freeCStr(str);
+    return _filterList->isNumaReplicated();
 }
 
-bool TextPurifier::check(const std::wstring& str) const
+bool TextPurifier::saveImage(const std::string& path) const
 {
-    return _filterList->find(str).size() > 0;
+    string image;
+    _filterList->saveImage(image);
+
+    ofstream file(path, ios::binary | ios::trunc);
+    return file && file.write(image.data(), image.size()) && file.flush();
 }
 
-bool TextPurifier::check(const std::string& str) const
+bool TextPurifier::loadImage(const std::string& path)
 {
-    return check(strToWStr(str));
+    string image;
+    return FilterList::readFile(path, image) && loadImage(image.data(), image.size());
 }
 
-bool TextPurifier::check(const wchar_t* str) const
+bool TextPurifier::loadImage(const char* data, std::size_t size)
 {
-    return check(wstring(str));
+    return _filterList->loadImage(data, size);
 }
 
-bool TextPurifier::check(const char* str) const
+std::wstring TextPurifier::purify(const std::wstring& str, const std::wstring& mask) const
 {
-    return check(cStrToWStr(str));
+    ScanContext context;
+    purify(context, str, mask);
+    return move(context._buffer->_result);
+}
+
+std::wstring TextPurifier::purify(const std::wstring& str, const wchar_t* mask) const
+{
+    return purify(str, wstring(mask));
+}
+
+std::wstring TextPurifier::purify(const std::wstring& str, wchar_t mask, bool isMatchSize) const
+{
+    ScanContext context;
+    purify(context, str, mask, isMatchSize);
+    return move(context._buffer->_result);
+}
+
+std::wstring& TextPurifier::purify(std::wstring& str, const std::wstring& mask) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanContext context;
+    rewrite(*context._buffer, str.data(), str.size(), mask.data(), mask.size(), false);
+    str.swap(context._buffer->_result);
+    return str;
+}
+
+std::wstring& TextPurifier::purify(std::wstring& str, const wchar_t* mask) const
+{
+    // cppcheck-suppress returnTempReference
+    return purify(str, wstring(mask));
+}
+
+std::wstring& TextPurifier::purify(std::wstring& str, wchar_t mask, bool isMatchSize) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanContext context;
+    rewrite(*context._buffer, str.data(), str.size(), &mask, 1UL, isMatchSize);
+    str.swap(context._buffer->_result);
+    return str;
+}
+
+std::string TextPurifier::purify(const std::string& str, const std::string& mask) const
+{
+    ScanContext context;
+    purify(context, str, mask);
+    return move(context._buffer->_output);
+}
+
+std::string TextPurifier::purify(const std::string& str, const char* mask) const
+{
+    return purify(str, string(mask));
+}
+
+std::string TextPurifier::purify(const std::string& str, char mask, bool isMatchSize) const
+{
+    ScanContext context;
+    purify(context, str, mask, isMatchSize);
+    return move(context._buffer->_output);
+}
+
+std::string& TextPurifier::purify(std::string& str, const std::string& mask) const
+{
+    ScanContext context;
+    purify(context, str.data(), str.size(), mask.data(), mask.size());
+    str.swap(context._buffer->_output);
+    return str;
+}
+
+std::string& TextPurifier::purify(std::string& str, const char* mask) const
+{
+    ScanContext context;
+    purify(context, str.data(), str.size(), mask, strlen(mask));
+    str.swap(context._buffer->_output);
+    return str;
+}
+
+std::string& TextPurifier::purify(std::string& str, char mask, bool isMatchSize) const
+{
+    ScanContext context;
+    purify(context, str.data(), str.size(), mask, isMatchSize);
+    str.swap(context._buffer->_output);
+    return str;
+}
+
+std::u16string TextPurifier::purify(const std::u16string& str, const std::u16string& mask) const
+{
+    ScanContext context;
+    purify(context, str.data(), str.size(), mask.data(), mask.size());
+    return move(context._buffer->_utf16Output);
+}
+
+std::u16string TextPurifier::purify(const std::u16string& str,
+                                    char16_t mask,
+                                    bool isMatchSize) const
+{
+    ScanContext context;
+    purify(context, str.data(), str.size(), mask, isMatchSize);
+    return move(context._buffer->_utf16Output);
+}
+
+const wchar_t* TextPurifier::purify(const wchar_t* str, const wchar_t* mask) const
+{
+    ScanContext context;
+    purify(context, str, mask);
+
+    size_t size = context._buffer->_result.length() + 1;
+    wchar_t* wcStr = new wchar_t[size];
+    wmemcpy(wcStr, context._buffer->_result.c_str(), size);
+    return wcStr;
+}
+
+const wchar_t* TextPurifier::purify(const wchar_t* str, wchar_t mask, bool isMatchSize) const
+{
+    ScanContext context;
+    purify(context, str, mask, isMatchSize);
+
+    size_t size = context._buffer->_result.length() + 1;
+    wchar_t* wcStr = new wchar_t[size];
+    wmemcpy(wcStr, context._buffer->_result.c_str(), size);
+    return wcStr;
+}
+
+void TextPurifier::freePurifiedString(const wchar_t* str) const
+{
+    if(nullptr != str)
+    {
+        delete [] str;
+    }
+}
+
+const char* TextPurifier::purify(const char* str, const char* mask) const
+{
+    ScanContext context;
+    purify(context, str, mask);
+
+    size_t size = context._buffer->_output.length() + 1;
+    char* cStr = new char[size];
+    memcpy(cStr, context._buffer->_output.c_str(), size);
+    return cStr;
+}
+
+const char* TextPurifier::purify(const char* str, char mask, bool isMatchSize) const
+{
+    ScanContext context;
+    purify(context, str, mask, isMatchSize);
+
+    size_t size = context._buffer->_output.length() + 1;
+    char* cStr = new char[size];
+    memcpy(cStr, context._buffer->_output.c_str(), size);
+    return cStr;
+}
+
+void TextPurifier::freePurifiedString(const char* str) const
+{
+    freeCStr(str);
+}
+
+const std::wstring& TextPurifier::purify(ScanContext& context,
+                                         const std::wstring& str,
+                                         const std::wstring& mask) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    rewrite(buffer,
+            unaliased(str.data(), str.size(), buffer._result, buffer._text),
+            str.size(),
+            unaliased(mask.data(), mask.size(), buffer._result, buffer._mask),
+            mask.size(),
+            false);
+    return buffer._result;
+}
+
+const std::wstring& TextPurifier::purify(ScanContext& context,
+                                         const std::wstring& str,
+                                         wchar_t mask,
+                                         bool isMatchSize) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    rewrite(buffer,
+            unaliased(str.data(), str.size(), buffer._result, buffer._text),
+            str.size(),
+            &mask,
+            1UL,
+            isMatchSize);
+    return buffer._result;
+}
+
+const std::string& TextPurifier::purify(ScanContext& context,
+                                        const std::string& str,
+                                        const std::string& mask) const
+{
+    return purify(context, str.data(), str.size(), mask.data(), mask.size());
+}
+
+const std::string& TextPurifier::purify(ScanContext& context,
+                                        const std::string& str,
+                                        char mask,
+                                        bool isMatchSize) const
+{
+    return purify(context, str.data(), str.size(), mask, isMatchSize);
+}
+
+const wchar_t* TextPurifier::purify(ScanContext& context,
+                                    const wchar_t* str,
+                                    const wchar_t* mask) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    const size_t size = wcslen(str);
+    const size_t maskSize = wcslen(mask);
+    rewrite(buffer,
+            unaliased(str, size, buffer._result, buffer._text),
+            size,
+            unaliased(mask, maskSize, buffer._result, buffer._mask),
+            maskSize,
+            false);
+    return buffer._result.c_str();
+}
+
+const wchar_t* TextPurifier::purify(ScanContext& context,
+                                    const wchar_t* str,
+                                    wchar_t mask,
+                                    bool isMatchSize) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    const size_t size = wcslen(str);
+    rewrite(buffer,
+            unaliased(str, size, buffer._result, buffer._text),
+            size,
+            &mask,
+            1UL,
+            isMatchSize);
+    return buffer._result.c_str();
+}
+
+const char* TextPurifier::purify(ScanContext& context, const char* str, const char* mask) const
+{
+    return purify(context, str, strlen(str), mask, strlen(mask)).c_str();
+}
+
+const char* TextPurifier::purify(ScanContext& context,
+                                 const char* str,
+                                 char mask,
+                                 bool isMatchSize) const
+{
+    return purify(context, str, strlen(str), mask, isMatchSize).c_str();
+}
+
+const std::string& TextPurifier::purify(ScanContext& context,
+                                        const char* str,
+                                        std::size_t size,
+                                        const char* mask,
+                                        std::size_t maskSize) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    decode(*_statistics, str, size, buffer._text);
+    utf8ToWStr(mask, maskSize, buffer._mask);
+    rewrite(buffer,
+            buffer._text.data(),
+            buffer._text.size(),
+            buffer._mask.data(),
+            buffer._mask.size(),
+            false);
+
+    encode(*_statistics, buffer._result, buffer._output);
+    return buffer._output;
+}
+
+const std::string& TextPurifier::purify(ScanContext& context,
+                                        const char* str,
+                                        std::size_t size,
+                                        char mask,
+                                        bool isMatchSize) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    decode(*_statistics, str, size, buffer._text);
+    utf8ToWStr(&mask, 1UL, buffer._mask);
+    rewrite(buffer,
+            buffer._text.data(),
+            buffer._text.size(),
+            buffer._mask.data(),
+            buffer._mask.size(),
+            isMatchSize);
+
+    encode(*_statistics, buffer._result, buffer._output);
+    return buffer._output;
+}
+
+const std::u16string& TextPurifier::purify(ScanContext& context,
+                                           const char16_t* str,
+                                           std::size_t size,
+                                           const char16_t* mask,
+                                           std::size_t maskSize) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    decode(*_statistics, str, size, buffer._text);
+    utf16ToWStr(mask, maskSize, buffer._mask);
+    rewrite(buffer,
+            buffer._text.data(),
+            buffer._text.size(),
+            buffer._mask.data(),
+            buffer._mask.size(),
+            false);
+
+    encode(*_statistics, buffer._result, buffer._utf16Output);
+    return buffer._utf16Output;
+}
+
+const std::u16string& TextPurifier::purify(ScanContext& context,
+                                           const char16_t* str,
+                                           std::size_t size,
+                                           char16_t mask,
+                                           bool isMatchSize) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    decode(*_statistics, str, size, buffer._text);
+    utf16ToWStr(&mask, 1UL, buffer._mask);
+    rewrite(buffer,
+            buffer._text.data(),
+            buffer._text.size(),
+            buffer._mask.data(),
+            buffer._mask.size(),
+            isMatchSize);
+
+    encode(*_statistics, buffer._result, buffer._utf16Output);
+    return buffer._utf16Output;
+}
+
+std::wstring TextPurifier::purify(const std::wstring& str, const MaskPolicy& policy) const
+{
+    ScanContext context;
+    purify(context, str, policy);
+    return move(context._buffer->_result);
+}
+
+std::string TextPurifier::purify(const std::string& str, const MaskPolicy& policy) const
+{
+    ScanContext context;
+    purify(context, str.data(), str.size(), policy);
+    return move(context._buffer->_output);
+}
+
+std::u16string TextPurifier::purify(const std::u16string& str, const MaskPolicy& policy) const
+{
+    ScanContext context;
+    purify(context, str.data(), str.size(), policy);
+    return move(context._buffer->_utf16Output);
+}
+
+const std::wstring& TextPurifier::purify(ScanContext& context,
+                                         const std::wstring& str,
+                                         const MaskPolicy& policy) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    rewrite(buffer,
+            unaliased(str.data(), str.size(), buffer._result, buffer._text),
+            str.size(),
+            policy,
+            buffer._result);
+    return buffer._result;
+}
+
+const std::string& TextPurifier::purify(ScanContext& context,
+                                        const std::string& str,
+                                        const MaskPolicy& policy) const
+{
+    return purify(context, str.data(), str.size(), policy);
+}
+
+const std::string& TextPurifier::purify(ScanContext& context,
+                                        const char* str,
+                                        std::size_t size,
+                                        const MaskPolicy& policy) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    decode(*_statistics, str, size, buffer._text);
+    rewrite(buffer, buffer._text.data(), buffer._text.size(), policy, buffer._output);
+    return buffer._output;
+}
+
+const std::u16string& TextPurifier::purify(ScanContext& context,
+                                           const char16_t* str,
+                                           std::size_t size,
+                                           const MaskPolicy& policy) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    decode(*_statistics, str, size, buffer._text);
+    rewrite(buffer, buffer._text.data(), buffer._text.size(), policy, buffer._utf16Output);
+    return buffer._utf16Output;
+}
+
+bool TextPurifier::check(const std::wstring& str) const
+{
+    ScanContext context;
+    return check(context, str);
+}
+
+bool TextPurifier::check(const std::string& str) const
+{
+    ScanContext context;
+    return check(context, str);
+}
+
+bool TextPurifier::check(const wchar_t* str) const
+{
+    ScanContext context;
+    return check(context, str);
+}
+
+bool TextPurifier::check(const char* str) const
+{
+    ScanContext context;
+    return check(context, str);
+}
+
+bool TextPurifier::check(const std::u16string& str) const
+{
+    ScanContext context;
+    return check(context, str.data(), str.size());
+}
+
+bool TextPurifier::check(ScanContext& context, const std::wstring& str) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    return check(*context._buffer, str.data(), str.size());
+}
+
+bool TextPurifier::check(ScanContext& context, const std::string& str) const
+{
+    return check(context, str.data(), str.size());
+}
+
+bool TextPurifier::check(ScanContext& context, const wchar_t* str) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    return check(*context._buffer, str, wcslen(str));
+}
+
+bool TextPurifier::check(ScanContext& context, const char* str) const
+{
+    return check(context, str, strlen(str));
+}
+
+bool TextPurifier::check(ScanContext& context, const char* str, std::size_t size) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    decode(*_statistics, str, size, buffer._text);
+    return check(buffer, buffer._text.data(), buffer._text.size());
+}
+
+bool TextPurifier::check(ScanContext& context, const char16_t* str, std::size_t size) const
+{
+    PhaseTimer timer(*_statistics, Phase::Total);
+    ScanBuffer& buffer = *context._buffer;
+    decode(*_statistics, str, size, buffer._text);
+    return check(buffer, buffer._text.data(), buffer._text.size());
+}
+
+bool TextPurifier::find(const std::wstring& str, MatchCallback callback, void* context) const
+{
+    auto visitor = [callback, context](size_t start, size_t length, size_t wordId)
+    {
+        return callback(context, start, length, wordId);
+    };
+    return findBatches(str, &TextPurifier::visitBatch<decltype(visitor)>, &visitor);
+}
+
+bool TextPurifier::find(const std::u16string& str, MatchCallback callback, void* context) const
+{
+    auto visitor = [callback, context](size_t start, size_t length, size_t wordId)
+    {
+        return callback(context, start, length, wordId);
+    };
+    return findBatches(str, &TextPurifier::visitBatch<decltype(visitor)>, &visitor);
+}
+
+bool TextPurifier::findBatches(const std::wstring& str,
+                               MatchBatchCallback callback,
+                               void* context) const
+{
+    ScanBuffer buffer;
+    HitSketch* const hitSketch = _hitSketch.get();
+    WordMatch batch[matchBatchSize];
+    size_t count = 0;
+
+    // Only the segments the callback has visited are counted into the sketch.
+    auto flush = [&]()
+    {
+        const bool isContinued = callback(context, batch, count);
+        if(nullptr != hitSketch)
+        {
+            for(size_t index = 0; index < count; ++index)
+            {
+                hitSketch->add(batch[index]._wordId);
+            }
+        }
+
+        count = 0;
+        return isContinued;
+    };
+
+    bool isFinished = _filterList->find(
+        str.data(),
+        str.size(),
+        buffer,
+        [&](size_t start, size_t length, size_t wordId)
+        {
+            batch[count++] = WordMatch{start, length, wordId};
+            return matchBatchSize != count || flush();
+        });
+
+    if(isFinished && 0 != count)
+    {
+        isFinished = flush();
+    }
+
+    if(_statistics->isEnabled())
+    {
+        _statistics->add(StatisticsCounters::FindCalls, 1);
+        countScan(*_statistics, buffer, str.size(), 0);
+    }
+
+    return isFinished;
+}
+
+bool TextPurifier::findBatches(const std::u16string& str,
+                               MatchBatchCallback callback,
+                               void* context) const
+{
+    wstring text;
+    decode(*_statistics, str.data(), str.size(), text);
+
+    // The code unit where each character starts, a supplementary character takes a pair.
+    vector<size_t> offsets;
+    offsets.reserve(text.size() + 1);
+    size_t offset = 0;
+    for(wchar_t character : text)
+    {
+        offsets.push_back(offset);
+        offset += character >= 0x10000 ? 2 : 1;
+    }
+    offsets.push_back(offset);
+
+    // The positions of each batch are moved to the code units.
+    WordMatch units[matchBatchSize];
+    auto convert = [callback, context, &offsets, &units](const WordMatch* matches, size_t& count)
+    {
+        for(size_t index = 0; index < count; ++index)
+        {
+            const size_t start = matches[index]._start;
+            const size_t end = start + matches[index]._length;
+            units[index] = WordMatch{offsets[start], offsets[end] - offsets[start],
+                                     matches[index]._wordId};
+        }
+
+        return callback(context, units, count);
+    };
+
+    return findBatches(
+        text,
+        [](void* context, const WordMatch* matches, size_t& count)
+        {
+            return (*static_cast<decltype(convert)*>(context))(matches, count);
+        },
+        &convert);
+}
+
+void TextPurifier::rewrite(ScanBuffer& buffer,
+                           const wchar_t* str,
+                           std::size_t size,
+                           const wchar_t* mask,
+                           std::size_t maskSize,
+                           bool isMatchSize) const
+{
+    wstring& result = buffer._result;
+    const bool isCounted = _statistics->isEnabled();
+    if(isCounted)
+    {
+        _statistics->add(StatisticsCounters::PurifyCalls, 1);
+    }
+
+    HitSketch* const hitSketch = _hitSketch.get();
+    vector<size_t>& wordIds = buffer._wordIds;
+    const bool isCacheable = _cache->isCacheable(size);
+    const uint64_t generation = _filterList->generation();
+    if(isCacheable &&
+       _cache->findPurify(str, size, mask, maskSize, isMatchSize, generation, result, wordIds))
+    {
+        replayHits(hitSketch, wordIds);
+        buffer._isFound = !wordIds.empty();
+        return;
+    }
+
+    size_t capacity = 0UL;
+    if(isCounted)
+    {
+        capacity = buffer.capacity();
+        buffer._transitions = 0;
+        buffer._matches = 0;
+    }
+
+    result.clear();
+    wordIds.clear();
+    buffer._isFound = false;
+
+    // The word IDs are kept with a cached result, so that its hits can be replayed.
+    auto addHit = [&](size_t wordId)
+    {
+        buffer._isFound = true;
+        if(nullptr != hitSketch)
+        {
+            hitSketch->add(wordId);
+        }
+
+        if(isCacheable)
+        {
+            wordIds.push_back(wordId);
+        }
+    };
+
+    size_t cursor = 0UL;
+    auto rewriteSegment = [&](size_t start, size_t length)
+    {
+        const size_t end = start + length;
+        if(start >= cursor)
+        {
+            result.append(str + cursor, start - cursor);
+            if(isMatchSize)
+            {
+                result.append(length, mask[0]);
+            }
+            else
+            {
+                result.append(mask, maskSize);
+            }
+            cursor = end;
+        }
+        else if(end > cursor)
+        {
+            if(isMatchSize)
+            {
+                result.append(end - cursor, mask[0]);
+            }
+            cursor = end;
+        }
+    };
+
+    if(!_statistics->isTimed())
+    {
+        _filterList->find(str, size, buffer, [&](size_t start, size_t length, size_t wordId)
+        {
+            addHit(wordId);
+            rewriteSegment(start, length);
+            return true;
+        });
+
+        result.append(str + cursor, size - cursor);
+    }
+    else
+    {
+        // Collect the word segments first, so that the scan and the rewrite are timed apart.
+        vector<pair<size_t, size_t>>& segments = buffer._segments;
+        segments.clear();
+        findTimed(*_filterList,
+                  *_statistics,
+                  str,
+                  size,
+                  buffer,
+                  [&](size_t start, size_t length, size_t wordId)
+                  {
+                      addHit(wordId);
+                      segments.emplace_back(start, length);
+                      return true;
+                  });
+
+        PhaseTimer timer(*_statistics, Phase::Rewrite);
+        for(const pair<size_t, size_t>& segment : segments)
+        {
+            rewriteSegment(segment.first, segment.second);
+        }
+
+        result.append(str + cursor, size - cursor);
+    }
+
+    if(isCounted)
+    {
+        countScan(*_statistics, buffer, size, capacity);
+    }
+
+    if(isCacheable)
+    {
+        _cache->storePurify(str, size, mask, maskSize, isMatchSize, generation, result, wordIds);
+    }
+}
+
+template <typename _String>
+void TextPurifier::rewrite(ScanBuffer& buffer,
+                           const wchar_t* str,
+                           std::size_t size,
+                           const MaskPolicy& policy,
+                           _String& output) const
+{
+    const MaskTable& table = *policy._table;
+    if(table.isCacheable() && _cache->isCacheable(size))
+    {
+        const MaskTable::Mask& mask = table._masks.front();
+        rewrite(buffer, str, size, mask._wide.data(), mask._wide.size(), table._isMatchSize);
+        if(static_cast<const void*>(&buffer._result) != static_cast<const void*>(&output))
+        {
+            encode(*_statistics, buffer._result, output);
+        }
+        return;
+    }
+
+    const bool isCounted = _statistics->isEnabled();
+    size_t capacity = 0UL;
+    if(isCounted)
+    {
+        _statistics->add(StatisticsCounters::PurifyCalls, 1);
+        capacity = buffer.capacity();
+        buffer._transitions = 0;
+        buffer._matches = 0;
+    }
+
+    vector<pair<size_t, size_t>>& segments = buffer._segments;
+    vector<size_t>& wordIds = buffer._wordIds;
+    segments.clear();
+    wordIds.clear();
+    HitSketch* const hitSketch = _hitSketch.get();
+    auto collect = [&](size_t start, size_t length, size_t wordId)
+    {
+        if(nullptr != hitSketch)
+        {
+            hitSketch->add(wordId);
+        }
+
+        segments.emplace_back(start, length);
+        wordIds.push_back(wordId);
+        return true;
+    };
+
+    if(!_statistics->isTimed())
+    {
+        _filterList->find(str, size, buffer, collect);
+    }
+    else
+    {
+        findTimed(*_filterList, *_statistics, str, size, buffer, collect);
+    }
+    buffer._isFound = !segments.empty();
+
+    // The text is transcoded span by span while the masks are written, so it is all timed as
+    // the rewrite. Overlapped word segments are merged into the span of the first one.
+    PhaseTimer timer(*_statistics, Phase::Rewrite);
+    output.clear();
+    size_t cursor = 0UL;
+    size_t index = 0UL;
+    while(index < segments.size())
+    {
+        const size_t start = segments[index].first;
+        const size_t wordId = wordIds[index];
+        size_t end = start + segments[index].second;
+        for(++index; index < segments.size() && segments[index].first < end; ++index)
+        {
+            end = max(end, segments[index].first + segments[index].second);
+        }
+
+        appendText(str + cursor, start - cursor, output);
+        appendMask(table, wordId, end - start, buffer._mask, output);
+        cursor = end;
+    }
+    appendText(str + cursor, size - cursor, output);
+
+    if(isCounted)
+    {
+        countScan(*_statistics, buffer, size, capacity);
+    }
+}
+
+bool TextPurifier::check(ScanBuffer& buffer, const wchar_t* str, std::size_t size) const
+{
+    const bool isCounted = _statistics->isEnabled();
+    if(isCounted)
+    {
+        _statistics->add(StatisticsCounters::CheckCalls, 1);
+    }
+
+    HitSketch* const hitSketch = _hitSketch.get();
+    vector<size_t>& wordIds = buffer._wordIds;
+    const bool isCacheable = _cache->isCacheable(size);
+    const uint64_t generation = _filterList->generation();
+    bool isFound = false;
+    if(isCacheable && _cache->findCheck(str, size, generation, isFound, wordIds))
+    {
+        replayHits(hitSketch, wordIds);
+        return isFound;
+    }
+
+    size_t capacity = 0UL;
+    if(isCounted)
+    {
+        capacity = buffer.capacity();
+        buffer._transitions = 0;
+        buffer._matches = 0;
+    }
+
+    wordIds.clear();
+    auto stop = [&](size_t, size_t, size_t wordId)
+    {
+        if(nullptr != hitSketch)
+        {
+            hitSketch->add(wordId);
+        }
+
+        if(isCacheable)
+        {
+            wordIds.push_back(wordId);
+        }
+
+        return false;
+    };
+
+    if(!_statistics->isTimed())
+    {
+        isFound = !_filterList->find(str, size, buffer, stop);
+    }
+    else
+    {
+        isFound = !findTimed(*_filterList, *_statistics, str, size, buffer, stop);
+    }
+
+    if(isCounted)
+    {
+        countScan(*_statistics, buffer, size, capacity);
+    }
+
+    if(isCacheable)
+    {
+        _cache->storeCheck(str, size, generation, isFound, wordIds);
+    }
+
+    return isFound;
 }
@@ -0,0 +1,394 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   text_purifier_c.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-20
+ */
+
+#include "text_purifier_c.h"
+
+#include <cstring>
+#include <exception>
+#include <new>
+#include <string>
+
+#include "text_purifier.h"
+
+
+using namespace lakoo;
+using namespace std;
+
+
+//! The purifier behind the opaque handle.
+struct textpurifier
+{
+    TextPurifier _purifier;
+};
+
+//! The scan context behind the opaque handle.
+struct textpurifier_context
+{
+    ScanContext _context;
+};
+
+
+namespace
+{
+    //! To run a function of the interface, no exception can cross the boundary.
+    template <typename _Function>
+    textpurifier_status guard(_Function&& function)
+    {
+        try
+        {
+            return function();
+        }
+        catch(const bad_alloc&)
+        {
+            return TEXTPURIFIER_OUT_OF_MEMORY;
+        }
+        catch(...)
+        {
+            return TEXTPURIFIER_INTERNAL_ERROR;
+        }
+    }
+
+    //! To purify a string by the mask, or a '*' per character if there is no mask.
+    const string& purify(const textpurifier& purifier,
+                         textpurifier_context& context,
+                         const char* text,
+                         size_t size,
+                         const char* mask,
+                         size_t maskSize)
+    {
+        if(nullptr == mask)
+        {
+            return purifier._purifier.purify(context._context, text, size, '*', true);
+        }
+
+        return purifier._purifier.purify(context._context, text, size, mask, maskSize);
+    }
+}
+
+
+const char* textpurifier_status_string(textpurifier_status status)
+{
+    switch(status)
+    {
+        case TEXTPURIFIER_OK:
+            return "success";
+        case TEXTPURIFIER_INVALID_ARGUMENT:
+            return "invalid argument";
+        case TEXTPURIFIER_BUFFER_TOO_SMALL:
+            return "buffer too small";
+        case TEXTPURIFIER_IO_ERROR:
+            return "cannot read the file or the image";
+        case TEXTPURIFIER_OUT_OF_MEMORY:
+            return "out of memory";
+        case TEXTPURIFIER_INTERNAL_ERROR:
+            return "internal error";
+    }
+
+    return "unknown status";
+}
+
+textpurifier_status textpurifier_create(textpurifier** purifier)
+{
+    if(nullptr == purifier)
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    *purifier = nullptr;
+    return guard([purifier]() -> textpurifier_status
+    {
+        *purifier = new textpurifier();
+        return TEXTPURIFIER_OK;
+    });
+}
+
+void textpurifier_destroy(textpurifier* purifier)
+{
+    delete purifier;
+}
+
+textpurifier_status textpurifier_set_word_boundary(textpurifier* purifier, int isWordBoundary)
+{
+    if(nullptr == purifier)
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([purifier, isWordBoundary]() -> textpurifier_status
+    {
+        purifier->_purifier.setWordBoundary(0 != isWordBoundary);
+        return TEXTPURIFIER_OK;
+    });
+}
+
+textpurifier_status textpurifier_set_memory_budget(textpurifier* purifier, size_t bytes)
+{
+    if(nullptr == purifier)
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([purifier, bytes]() -> textpurifier_status
+    {
+        purifier->_purifier.setMemoryBudget(bytes);
+        return TEXTPURIFIER_OK;
+    });
+}
+
+textpurifier_status textpurifier_add(textpurifier* purifier, const char* word, size_t size)
+{
+    if(nullptr == purifier || (nullptr == word && 0 != size))
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([purifier, word, size]() -> textpurifier_status
+    {
+        purifier->_purifier.add(string(word, size));
+        return TEXTPURIFIER_OK;
+    });
+}
+
+textpurifier_status textpurifier_add_pattern(textpurifier* purifier,
+                                             const char* pattern,
+                                             size_t size)
+{
+    if(nullptr == purifier || (nullptr == pattern && 0 != size))
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([purifier, pattern, size]() -> textpurifier_status
+    {
+        purifier->_purifier.addPattern(string(pattern, size));
+        return TEXTPURIFIER_OK;
+    });
+}
+
+textpurifier_status textpurifier_add_words(textpurifier* purifier, const char* data, size_t size)
+{
+    if(nullptr == purifier || (nullptr == data && 0 != size))
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([purifier, data, size]() -> textpurifier_status
+    {
+        purifier->_purifier.addWords(data, size);
+        return TEXTPURIFIER_OK;
+    });
+}
+
+textpurifier_status textpurifier_add_file(textpurifier* purifier, const char* path)
+{
+    if(nullptr == purifier || nullptr == path)
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([purifier, path]() -> textpurifier_status
+    {
+        return purifier->_purifier.addFile(path) ? TEXTPURIFIER_OK : TEXTPURIFIER_IO_ERROR;
+    });
+}
+
+textpurifier_status textpurifier_compile(textpurifier* purifier)
+{
+    if(nullptr == purifier)
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([purifier]() -> textpurifier_status
+    {
+        purifier->_purifier.compile();
+        return TEXTPURIFIER_OK;
+    });
+}
+
+textpurifier_status textpurifier_load_image(textpurifier* purifier, const char* path)
+{
+    if(nullptr == purifier || nullptr == path)
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([purifier, path]() -> textpurifier_status
+    {
+        return purifier->_purifier.loadImage(path) ? TEXTPURIFIER_OK : TEXTPURIFIER_IO_ERROR;
+    });
+}
+
+textpurifier_status textpurifier_load_image_data(textpurifier* purifier,
+                                                 const char* data,
+                                                 size_t size)
+{
+    if(nullptr == purifier || nullptr == data)
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([purifier, data, size]() -> textpurifier_status
+    {
+        return purifier->_purifier.loadImage(data, size) ? TEXTPURIFIER_OK : TEXTPURIFIER_IO_ERROR;
+    });
+}
+
+textpurifier_status textpurifier_context_create(textpurifier_context** context)
+{
+    if(nullptr == context)
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    *context = nullptr;
+    return guard([context]() -> textpurifier_status
+    {
+        *context = new textpurifier_context();
+        return TEXTPURIFIER_OK;
+    });
+}
+
+void textpurifier_context_destroy(textpurifier_context* context)
+{
+    delete context;
+}
+
+textpurifier_status textpurifier_check(const textpurifier* purifier,
+                                       textpurifier_context* context,
+                                       const char* text,
+                                       size_t size,
+                                       int* isFound)
+{
+    if(nullptr == purifier || nullptr == context || (nullptr == text && 0 != size) ||
+       nullptr == isFound)
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([=]() -> textpurifier_status
+    {
+        *isFound = purifier->_purifier.check(context->_context, text, size) ? 1 : 0;
+        return TEXTPURIFIER_OK;
+    });
+}
+
+textpurifier_status textpurifier_purify(const textpurifier* purifier,
+                                        textpurifier_context* context,
+                                        const char* text,
+                                        size_t size,
+                                        const char* mask,
+                                        size_t maskSize,
+                                        char* output,
+                                        size_t capacity,
+                                        size_t* outputSize)
+{
+    if(nullptr == purifier || nullptr == context || (nullptr == text && 0 != size) ||
+       (nullptr == output && 0 != capacity) || nullptr == outputSize)
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([=]() -> textpurifier_status
+    {
+        const string& result = purify(*purifier, *context, text, size, mask, maskSize);
+        *outputSize = result.size();
+        if(result.size() > capacity)
+        {
+            return TEXTPURIFIER_BUFFER_TOO_SMALL;
+        }
+
+        if(!result.empty())
+        {
+            memcpy(output, result.data(), result.size());
+        }
+        return TEXTPURIFIER_OK;
+    });
+}
+
+textpurifier_status textpurifier_check_batch(const textpurifier* purifier,
+                                             textpurifier_context* context,
+                                             const char* const* texts,
+                                             const size_t* sizes,
+                                             size_t count,
+                                             unsigned char* isFound)
+{
+    if(nullptr == purifier || nullptr == context ||
+       (0 != count && (nullptr == texts || nullptr == sizes || nullptr == isFound)))
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([=]() -> textpurifier_status
+    {
+        for(size_t index = 0; index < count; ++index)
+        {
+            isFound[index] =
+                purifier->_purifier.check(context->_context, texts[index], sizes[index]) ? 1 : 0;
+        }
+        return TEXTPURIFIER_OK;
+    });
+}
+
+textpurifier_status textpurifier_purify_batch(const textpurifier* purifier,
+                                              textpurifier_context* context,
+                                              const char* const* texts,
+                                              const size_t* sizes,
+                                              size_t count,
+                                              const char* mask,
+                                              size_t maskSize,
+                                              char* output,
+                                              size_t capacity,
+                                              size_t* ends)
+{
+    if(nullptr == purifier || nullptr == context || (nullptr == output && 0 != capacity) ||
+       (0 != count && (nullptr == texts || nullptr == sizes || nullptr == ends)))
+    {
+        return TEXTPURIFIER_INVALID_ARGUMENT;
+    }
+
+    return guard([=]() -> textpurifier_status
+    {
+        textpurifier_status status = TEXTPURIFIER_OK;
+        size_t end = 0;
+        for(size_t index = 0; index < count; ++index)
+        {
+            const string& result =
+                purify(*purifier, *context, texts[index], sizes[index], mask, maskSize);
+            if(end + result.size() > capacity)
+            {
+                status = TEXTPURIFIER_BUFFER_TOO_SMALL;
+            }
+            else if(!result.empty())
+            {
+                memcpy(output + end, result.data(), result.size());
+            }
+
+            end += result.size();
+            ends[index] = end;
+        }
+        return status;
+    });
+}
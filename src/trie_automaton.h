@@ -0,0 +1,157 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   trie_automaton.h
+ * @author Aludirk Wong
+ * @date   2017-08-07
+ */
+
+#ifndef __LAKOO_TRIE_AUTOMATON_H__
+#define __LAKOO_TRIE_AUTOMATON_H__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "char_node.h"
+#include "scan_buffer.h"
+
+
+namespace lakoo
+{
+    //! The automaton interface of the CharNode trie for the Scanner.
+    class TrieAutomaton final
+    {
+    public:
+        //! Constructor.
+        /**
+         * @param [in] root The root CharNode of the trie.
+         */
+        explicit TrieAutomaton(const CharNode* root) : _root(root) {}
+
+        //! Default destructor.
+        ~TrieAutomaton() = default;
+
+        //! Deleted copy constructor.
+        TrieAutomaton(const TrieAutomaton&) = delete;
+
+        //! Deleted assignment operator.
+        TrieAutomaton& operator=(const TrieAutomaton&) = delete;
+
+    public:
+        //! The state of the root.
+        /**
+         * @return The state of the root.
+         */
+        inline AutomatonState root() const { return state(_root); }
+
+        //! To follow the edge of a character.
+        /**
+         * @param [in]  current   The current state.
+         * @param [in]  character The character of the edge.
+         * @param [out] next      The next state, unchanged if there is no such edge.
+         * @return                Whether the edge exists.
+         */
+        inline bool next(const AutomatonState& current, wchar_t character, AutomatonState& next) const
+        {
+            const CharNode* nextNode = node(current)->findNext(character);
+            if(nullptr == nextNode)
+            {
+                return false;
+            }
+
+            next = state(nextNode);
+            return true;
+        }
+
+        //! To follow a chain of single edges at once, the trie has none.
+        /**
+         * @param [in,out] current The current state.
+         * @param [in]     text    The text after the current state.
+         * @param [in]     size    The length of the text.
+         * @return                 0.
+         */
+        inline std::size_t follow(AutomatonState& current, const wchar_t* text, std::size_t size) const
+        {
+            (void)current;
+            (void)text;
+            (void)size;
+            return 0;
+        }
+
+        //! Whether a word ends at the state.
+        /**
+         * @param [in] current The state.
+         * @return             Whether a word ends at the state.
+         */
+        inline bool isEnd(const AutomatonState& current) const { return node(current)->isEndNode(); }
+
+        //! The ID of the word which ends at the state.
+        /**
+         * @param [in] current The state, a word must end at it.
+         * @return             The word ID.
+         */
+        inline std::size_t wordId(const AutomatonState& current) const
+        {
+            return node(current)->wordId();
+        }
+
+        //! To visit all edges of a state.
+        /**
+         * @param [in] current The state.
+         * @param [in] visitor The callable with signature
+         *                     <tt>void(wchar_t character, const AutomatonState& next)</tt>.
+         */
+        template <typename _Visitor>
+        void forEachNext(const AutomatonState& current, _Visitor&& visitor) const
+        {
+            for(const auto& next : node(current)->nextNodes())
+            {
+                visitor(next.first, state(next.second.get()));
+            }
+        }
+
+    private:
+        //! The state of a CharNode.
+        /**
+         * @param [in] node The CharNode.
+         * @return          The state.
+         */
+        static inline AutomatonState state(const CharNode* node)
+        {
+            return AutomatonState{reinterpret_cast<std::uintptr_t>(node), 0};
+        }
+
+        //! The CharNode of a state.
+        /**
+         * @param [in] current The state.
+         * @return             The CharNode.
+         */
+        static inline const CharNode* node(const AutomatonState& current)
+        {
+            return reinterpret_cast<const CharNode*>(static_cast<std::uintptr_t>(current._node));
+        }
+
+    private:
+        //! The root CharNode of the trie.
+        const CharNode* _root;
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_TRIE_AUTOMATON_H__
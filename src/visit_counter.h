@@ -0,0 +1,154 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   visit_counter.h
+ * @author Aludirk Wong
+ * @date   2017-08-23
+ */
+
+#ifndef __LAKOO_VISIT_COUNTER_H__
+#define __LAKOO_VISIT_COUNTER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dafsa.h"
+#include "scan_buffer.h"
+
+
+namespace lakoo
+{
+    //! The automaton interface of a Dafsa for the Scanner, counting the visits of the nodes.
+    /**
+     * Every state the Scanner steps into is counted, so a scan of sample text records how hot
+     * each node is for Dafsa::order.
+     */
+    class VisitCounter final
+    {
+    public:
+        //! Constructor.
+        /**
+         * @param [in]     dafsa  The automaton.
+         * @param [in,out] visits The number of visits of each node, to add to.
+         */
+        VisitCounter(const Dafsa& dafsa, std::vector<std::uint64_t>& visits)
+        : _dafsa(dafsa)
+        , _visits(visits)
+        {
+        }
+
+        //! Default destructor.
+        ~VisitCounter() = default;
+
+        //! Deleted copy constructor.
+        VisitCounter(const VisitCounter&) = delete;
+
+        //! Deleted assignment operator.
+        VisitCounter& operator=(const VisitCounter&) = delete;
+
+    public:
+        //! The state of the root.
+        /**
+         * @return The state of the root.
+         */
+        inline AutomatonState root() const
+        {
+            ++_visits[0];
+            return _dafsa.root();
+        }
+
+        //! To follow the edge of a character.
+        /**
+         * @param [in]  current   The current state.
+         * @param [in]  character The character of the edge.
+         * @param [out] next      The next state, unchanged if there is no such edge.
+         * @return                Whether the edge exists.
+         */
+        inline bool next(const AutomatonState& current, wchar_t character, AutomatonState& next) const
+        {
+            if(!_dafsa.next(current, character, next))
+            {
+                return false;
+            }
+
+            ++_visits[next._node];
+            return true;
+        }
+
+        //! To follow a chain of single edges, one edge at a time so that each state is counted.
+        /**
+         * @param [in,out] current The current state.
+         * @param [in]     text    The text after the current state.
+         * @param [in]     size    The length of the text.
+         * @return                 0.
+         */
+        inline std::size_t follow(AutomatonState& current, const wchar_t* text, std::size_t size) const
+        {
+            (void)current;
+            (void)text;
+            (void)size;
+            return 0;
+        }
+
+        //! Whether a word ends at the state.
+        /**
+         * @param [in] current The state.
+         * @return             Whether a word ends at the state.
+         */
+        inline bool isEnd(const AutomatonState& current) const { return _dafsa.isEnd(current); }
+
+        //! The ID of the word which ends at the state.
+        /**
+         * @param [in] current The state, a word must end at it.
+         * @return             The word ID.
+         */
+        inline std::size_t wordId(const AutomatonState& current) const
+        {
+            return _dafsa.wordId(current);
+        }
+
+        //! To visit all edges of a state.
+        /**
+         * @param [in] current The state.
+         * @param [in] visitor The callable with signature
+         *                     <tt>void(wchar_t character, const AutomatonState& next)</tt>.
+         */
+        template <typename _Visitor>
+        void forEachNext(const AutomatonState& current, _Visitor&& visitor) const
+        {
+            _dafsa.forEachNext(current, [this, &visitor](wchar_t character,
+                                                         const AutomatonState& next)
+            {
+                ++_visits[next._node];
+                visitor(character, next);
+            });
+        }
+
+    private:
+        //! The automaton.
+        const Dafsa& _dafsa;
+
+        //! The number of visits of each node.
+        std::vector<std::uint64_t>& _visits;
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_VISIT_COUNTER_H__
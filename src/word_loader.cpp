@@ -0,0 +1,254 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   word_loader.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-09
+ */
+
+#include "word_loader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <thread>
+#include <utility>
+
+#include "string_utils.h"
+
+
+using namespace lakoo;
+using namespace std;
+
+
+namespace
+{
+    //! The minimum number of bytes of a part, a smaller file is not worth another thread.
+    const size_t minChunkSize = 64 * 1024;
+
+    //! Whether a character is trimmed from the words.
+    inline bool isBlank(wchar_t character)
+    {
+        return L'\r' == character || L'\n' == character || L'\t' == character;
+    }
+}
+
+
+WordLoader::WordLoader(const char* data, std::size_t size, std::size_t threadCount)
+: _chunks()
+, _words()
+, _lineCount(0)
+{
+    // Skip the byte order mark.
+    if(size >= 3 && '\xEF' == data[0] && '\xBB' == data[1] && '\xBF' == data[2])
+    {
+        data += 3;
+        size -= 3;
+    }
+
+    if(0 == threadCount)
+    {
+        threadCount = max(1U, thread::hardware_concurrency());
+    }
+    const size_t chunkCount = max<size_t>(1, min(threadCount, size / minChunkSize));
+
+    // Split at the line breaks, so that no line is shared by two parts.
+    const char* const end = data + size;
+    const char* begin = data;
+    _chunks.resize(chunkCount);
+    for(size_t index = 0; index < chunkCount; ++index)
+    {
+        const char* chunkEnd = end;
+        if(index + 1 < chunkCount)
+        {
+            chunkEnd = max(begin, data + size / chunkCount * (index + 1));
+            chunkEnd = find(chunkEnd, end, '\n');
+            if(end != chunkEnd)
+            {
+                ++chunkEnd;
+            }
+        }
+
+        _chunks[index]._begin = begin;
+        _chunks[index]._end = chunkEnd;
+        _chunks[index]._lineCount = 0;
+        begin = chunkEnd;
+    }
+
+    vector<thread> threads;
+    threads.reserve(chunkCount - 1);
+    for(size_t index = 1; index < chunkCount; ++index)
+    {
+        threads.emplace_back(parse, ref(_chunks[index]));
+    }
+    parse(_chunks[0]);
+    for(thread& worker : threads)
+    {
+        worker.join();
+    }
+
+    merge();
+}
+
+int WordLoader::compare(const wchar_t* lhs,
+                        std::size_t lhsLength,
+                        const wchar_t* rhs,
+                        std::size_t rhsLength)
+{
+    const int result = char_traits<wchar_t>::compare(lhs, rhs, min(lhsLength, rhsLength));
+    if(0 != result)
+    {
+        return result;
+    }
+
+    return lhsLength < rhsLength ? -1 : (lhsLength > rhsLength ? 1 : 0);
+}
+
+int WordLoader::compare(const LoadedWord& lhs, const LoadedWord& rhs)
+{
+    if(lhs._prefix != rhs._prefix)
+    {
+        return lhs._prefix < rhs._prefix ? -1 : 1;
+    }
+
+    return compare(lhs._characters, lhs._length, rhs._characters, rhs._length);
+}
+
+void WordLoader::parse(Chunk& chunk)
+{
+    wstring& characters = chunk._characters;
+    wstring line;
+    vector<size_t> offsets;
+    const char* begin = chunk._begin;
+    while(begin != chunk._end)
+    {
+        const char* lineEnd = find(begin, chunk._end, '\n');
+        StringUtils::utf8ToWStr(begin, lineEnd - begin, line);
+
+        // The same as FilterList::add: no space, trimmed and in lower case.
+        const size_t offset = characters.size();
+        for(wchar_t character : line)
+        {
+            if(L' ' != character)
+            {
+                characters.push_back(static_cast<wchar_t>(::tolower(character)));
+            }
+        }
+
+        while(characters.size() > offset && isBlank(characters.back()))
+        {
+            characters.pop_back();
+        }
+
+        size_t first = offset;
+        while(first < characters.size() && isBlank(characters[first]))
+        {
+            ++first;
+        }
+
+        if(first < characters.size())
+        {
+            offsets.push_back(first);
+            // An absent character is 0, so that a word is ordered before the longer words.
+            uint64_t prefix = 0;
+            for(size_t index = first; index < first + 3; ++index)
+            {
+                const wchar_t character = index < characters.size() ? characters[index] : 0;
+                prefix = (prefix << 21) | min<uint64_t>(character, 0x1FFFFF);
+            }
+
+            chunk._words.push_back(LoadedWord{nullptr,
+                                              characters.size() - first,
+                                              chunk._lineCount,
+                                              prefix});
+        }
+
+        ++chunk._lineCount;
+        begin = chunk._end != lineEnd ? lineEnd + 1 : lineEnd;
+    }
+
+    // The characters no longer move, the words can point to them.
+    for(size_t index = 0; index < offsets.size(); ++index)
+    {
+        chunk._words[index]._characters = characters.data() + offsets[index];
+    }
+
+    sort(chunk._words.begin(), chunk._words.end(), [](const LoadedWord& lhs, const LoadedWord& rhs)
+    {
+        const int result = compare(lhs, rhs);
+        return result < 0 || (0 == result && lhs._line < rhs._line);
+    });
+}
+
+void WordLoader::merge()
+{
+    size_t wordCount = 0;
+    vector<size_t> firstLines;
+    firstLines.reserve(_chunks.size());
+    for(const Chunk& chunk : _chunks)
+    {
+        firstLines.push_back(_lineCount);
+        _lineCount += chunk._lineCount;
+        wordCount += chunk._words.size();
+    }
+    _words.reserve(wordCount);
+
+    // The heads of the parts in a heap, the same words are ordered by their parts, so that the
+    // first line of a word comes first.
+    typedef pair<size_t, size_t> Head;
+    auto isAfter = [this](const Head& lhs, const Head& rhs)
+    {
+        const LoadedWord& lhsWord = _chunks[lhs.first]._words[lhs.second];
+        const LoadedWord& rhsWord = _chunks[rhs.first]._words[rhs.second];
+        const int result = compare(lhsWord, rhsWord);
+        return result > 0 || (0 == result && lhs.first > rhs.first);
+    };
+
+    vector<Head> heads;
+    for(size_t index = 0; index < _chunks.size(); ++index)
+    {
+        if(!_chunks[index]._words.empty())
+        {
+            heads.emplace_back(index, 0);
+        }
+    }
+    make_heap(heads.begin(), heads.end(), isAfter);
+
+    while(!heads.empty())
+    {
+        pop_heap(heads.begin(), heads.end(), isAfter);
+        Head& head = heads.back();
+        const LoadedWord& word = _chunks[head.first]._words[head.second];
+
+        if(_words.empty() || 0 != compare(_words.back(), word))
+        {
+            _words.push_back(word);
+            _words.back()._line += firstLines[head.first];
+        }
+
+        if(++head.second < _chunks[head.first]._words.size())
+        {
+            push_heap(heads.begin(), heads.end(), isAfter);
+        }
+        else
+        {
+            heads.pop_back();
+        }
+    }
+}
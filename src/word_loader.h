@@ -0,0 +1,159 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   word_loader.h
+ * @author Aludirk Wong
+ * @date   2017-08-09
+ */
+
+#ifndef __LAKOO_WORD_LOADER_H__
+#define __LAKOO_WORD_LOADER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace lakoo
+{
+    //! A normalized word loaded from a word file.
+    struct LoadedWord final
+    {
+    public:
+        //! The characters of the word, owned by the WordLoader.
+        const wchar_t* _characters;
+
+        //! The number of characters.
+        std::size_t _length;
+
+        //! The index of the first line of the word.
+        std::size_t _line;
+
+        //! The first 3 characters in 21 bits each, to order most words without their characters.
+        std::uint64_t _prefix;
+    };
+
+
+    //! To load the words of a word file, one word per line in UTF-8.
+    /**
+     * The file is split into parts at line breaks, each part is transcoded, normalized the same
+     * way as FilterList::add and sorted by its own thread. The parts are then merged into the
+     * sorted distinct words, ready to be built into a Dafsa in one pass.
+     */
+    class WordLoader final
+    {
+    public:
+        //! Constructor.
+        /**
+         * @param [in] data        The content of the word file.
+         * @param [in] size        The number of bytes of the content.
+         * @param [in] threadCount The number of threads, 0 to use the number of cores.
+         */
+        WordLoader(const char* data, std::size_t size, std::size_t threadCount);
+
+        //! Default destructor.
+        ~WordLoader() = default;
+
+        //! Deleted copy constructor.
+        WordLoader(const WordLoader&) = delete;
+
+        //! Deleted assignment operator.
+        WordLoader& operator=(const WordLoader&) = delete;
+
+    public:
+        //! The distinct words in the sorted order.
+        /**
+         * @return The words, each with its first line.
+         */
+        inline const std::vector<LoadedWord>& words() const { return _words; }
+
+        //! The number of lines.
+        /**
+         * @return The number of lines.
+         */
+        inline std::size_t lineCount() const { return _lineCount; }
+
+        //! To compare two words in the order of std::wstring.
+        /**
+         * @param [in] lhs       The characters of the first word.
+         * @param [in] lhsLength The length of the first word.
+         * @param [in] rhs       The characters of the second word.
+         * @param [in] rhsLength The length of the second word.
+         * @return               Negative, 0 or positive if the first word is ordered before,
+         *                       the same as or after the second word.
+         */
+        static int compare(const wchar_t* lhs,
+                           std::size_t lhsLength,
+                           const wchar_t* rhs,
+                           std::size_t rhsLength);
+
+    private:
+        //! The words of a part of the file.
+        struct Chunk final
+        {
+            //! The first byte of the part.
+            const char* _begin;
+
+            //! The byte after the part.
+            const char* _end;
+
+            //! The characters of all words in the part.
+            std::wstring _characters;
+
+            //! The offsets, lengths and lines of the words, the lines are local to the part.
+            std::vector<LoadedWord> _words;
+
+            //! The number of lines in the part.
+            std::size_t _lineCount;
+        };
+
+    private:
+        //! To compare two loaded words in the order of std::wstring.
+        /**
+         * @param [in] lhs The first word.
+         * @param [in] rhs The second word.
+         * @return         Negative, 0 or positive if the first word is ordered before, the same
+         *                 as or after the second word.
+         */
+        static int compare(const LoadedWord& lhs, const LoadedWord& rhs);
+
+        //! To transcode, normalize and sort the words of a part.
+        /**
+         * @param [in,out] chunk The part.
+         */
+        static void parse(Chunk& chunk);
+
+        //! To merge the sorted parts into the distinct words.
+        void merge();
+
+    private:
+        //! The parts of the file.
+        std::vector<Chunk> _chunks;
+
+        //! The distinct words in the sorted order.
+        std::vector<LoadedWord> _words;
+
+        //! The number of lines.
+        std::size_t _lineCount;
+    };
+} // namespace lakoo
+
+#endif // __LAKOO_WORD_LOADER_H__
@@ -0,0 +1,267 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   benchmark.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-04
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <random>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "text_purifier.h"
+
+
+using namespace std;
+
+
+namespace
+{
+    //! The number of distinct characters in the generated words and text.
+    const wchar_t alphabetSize = 3000;
+
+    wchar_t randomCharacter(mt19937& random)
+    {
+        return static_cast<wchar_t>(0x4E00 + random() % alphabetSize);
+    }
+
+    list<wstring> makeWords(mt19937& random, size_t count)
+    {
+        list<wstring> words;
+        for(size_t index = 0; index < count; ++index)
+        {
+            wstring word;
+            const size_t length = 2 + random() % 5;
+            for(size_t charIndex = 0; charIndex < length; ++charIndex)
+            {
+                word.push_back(randomCharacter(random));
+            }
+            words.push_back(word);
+        }
+        return words;
+    }
+
+    wstring makeText(mt19937& random, const list<wstring>& words, size_t size)
+    {
+        // Plant a word, with one character substituted every other time, in every 50 characters.
+        wstring text;
+        auto word = words.begin();
+        while(text.size() < size)
+        {
+            for(size_t index = 0; index < 50; ++index)
+            {
+                text.push_back(randomCharacter(random));
+            }
+
+            wstring planted = *word;
+            if(0 == text.size() % 100 && planted.size() > 2)
+            {
+                planted[planted.size() - 1] = randomCharacter(random);
+            }
+            text += planted;
+
+            if(words.end() == ++word)
+            {
+                word = words.begin();
+            }
+        }
+        return text;
+    }
+
+    string toUtf8(const wstring& text)
+    {
+        // The characters are all in the range of 3 bytes.
+        string result;
+        for(wchar_t character : text)
+        {
+            result.push_back(static_cast<char>(0xE0 | (character >> 12)));
+            result.push_back(static_cast<char>(0x80 | ((character >> 6) & 0x3F)));
+            result.push_back(static_cast<char>(0x80 | (character & 0x3F)));
+        }
+        return result;
+    }
+
+    //! The counter of the cache misses of the thread, -1 if the host does not allow it.
+    int cacheMissCounter()
+    {
+#ifdef __linux__
+        static const int counter = []()
+        {
+            perf_event_attr attributes;
+            memset(&attributes, 0, sizeof(attributes));
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.size = sizeof(attributes);
+            attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+        }();
+        return counter;
+#else
+        return -1;
+#endif
+    }
+
+    void startCounting()
+    {
+#ifdef __linux__
+        if(-1 != cacheMissCounter())
+        {
+            ioctl(cacheMissCounter(), PERF_EVENT_IOC_RESET, 0);
+            ioctl(cacheMissCounter(), PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    uint64_t stopCounting()
+    {
+        uint64_t misses = 0;
+#ifdef __linux__
+        if(-1 != cacheMissCounter())
+        {
+            ioctl(cacheMissCounter(), PERF_EVENT_IOC_DISABLE, 0);
+            if(static_cast<ssize_t>(sizeof(misses)) !=
+               read(cacheMissCounter(), &misses, sizeof(misses)))
+            {
+                misses = 0;
+            }
+        }
+#endif
+        return misses;
+    }
+
+    void run(const char* name, const lakoo::TextPurifier& tp, const wstring& text, double base)
+    {
+        const int rounds = 10;
+        size_t matches = 0;
+
+        startCounting();
+        const auto start = chrono::steady_clock::now();
+        for(int round = 0; round < rounds; ++round)
+        {
+            tp.find(text, [&matches](size_t, size_t, size_t)
+            {
+                ++matches;
+                return true;
+            });
+        }
+        const auto stop = chrono::steady_clock::now();
+        const uint64_t misses = stopCounting();
+
+        const double seconds = chrono::duration<double>(stop - start).count() / rounds;
+        const double kb = text.size() * 3.0 / 1024.0;
+        printf("%-24s %10.1f us/KB %10zu matches", name, seconds * 1e6 / kb, matches / rounds);
+        if(base > 0.0)
+        {
+            printf(" %8.2fx", seconds * 1e6 / kb / base);
+        }
+        if(-1 != cacheMissCounter())
+        {
+            printf(" %10.1f misses/KB", static_cast<double>(misses) / rounds / kb);
+        }
+        printf("\n");
+    }
+
+    double measure(const lakoo::TextPurifier& tp, const wstring& text)
+    {
+        const int rounds = 10;
+        const auto start = chrono::steady_clock::now();
+        for(int round = 0; round < rounds; ++round)
+        {
+            tp.find(text, [](size_t, size_t, size_t) { return true; });
+        }
+        const auto stop = chrono::steady_clock::now();
+        return chrono::duration<double>(stop - start).count() / rounds * 1e6 /
+               (text.size() * 3.0 / 1024.0);
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    const size_t wordCount = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+    const size_t textSize = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200000;
+    const size_t loadCount = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1000000;
+
+    mt19937 random(20170804);
+    const list<wstring> words = makeWords(random, wordCount);
+    const wstring text = makeText(random, words, textSize);
+
+    printf("%zu words, %zu characters\n", wordCount, text.size());
+
+    lakoo::TextPurifier tp(words);
+    const double base = measure(tp, text);
+    run("exact", tp, text, base);
+
+    tp.setMaxDistance(1);
+    run("approximate (k = 1)", tp, text, base);
+
+    tp.setMaxDistance(2);
+    run("approximate (k = 2)", tp, text, base);
+
+    const size_t trieNodeCount = tp.nodeCount();
+    tp.compile();
+    printf("%zu trie nodes, %zu compiled nodes\n", trieNodeCount, tp.nodeCount());
+
+    tp.setMaxDistance(0);
+    run("exact (compiled)", tp, text, base);
+
+    tp.setMaxDistance(1);
+    run("approximate (compiled)", tp, text, base);
+
+    // Lay out the nodes by the visits of a tenth of the text.
+    tp.setMaxDistance(0);
+    tp.orderNodes(list<string>{ toUtf8(text.substr(0, text.size() / 10)) });
+    run("exact (ordered)", tp, text, base);
+
+    tp.setMaxDistance(1);
+    run("approximate (ordered)", tp, text, base);
+
+    // Load a large word file, one word per line.
+    string content;
+    for(const wstring& word : makeWords(random, loadCount))
+    {
+        content += toUtf8(word);
+        content.push_back('\n');
+    }
+
+    lakoo::TextPurifier loaded;
+    const auto start = chrono::steady_clock::now();
+    loaded.addWords(content.data(), content.size());
+    const auto stop = chrono::steady_clock::now();
+    printf("%-24s %10.1f ms %10zu nodes\n", "load words",
+           chrono::duration<double>(stop - start).count() * 1e3, loaded.nodeCount());
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#!/usr/bin/env bash
+
+# The client speaks the binary frames of tools/daemon.cpp.
+which python3 &> /dev/null
+if [[ ${?} -ne 0 ]]; then
+  printf "Can't find python3, skipping test.\n"
+  exit 77
+fi
+
+DAEMON="${PWD}/../tools/textpurifierd"
+WORK_DIR="$(mktemp -d)"
+trap 'kill ${PID} &> /dev/null; rm -rf "${WORK_DIR}"' EXIT
+pushd "${WORK_DIR}" &> /dev/null
+
+printf "fuck\nshit\n" > words.txt
+cat > client.py << 'EOF'
+import socket, struct, sys, time
+
+def connect():
+    for _ in range(100):
+        try:
+            client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            client.connect("server.sock")
+            return client
+        except OSError:
+            time.sleep(0.05)
+    sys.exit("cannot connect")
+
+def receive(client, size):
+    data = b""
+    while len(data) < size:
+        chunk = client.recv(size - len(data))
+        if not chunk:
+            sys.exit("connection closed")
+        data += chunk
+    return data
+
+def request(client, requests):
+    # All requests are sent before any response is read, the responses are matched by the IDs.
+    for (id, operation, text) in requests:
+        data = text if isinstance(text, bytes) else text.encode("utf-8")
+        client.sendall(struct.pack("=IIB", 5 + len(data), id, operation) + data)
+    responses = {}
+    for _ in requests:
+        size, id, status = struct.unpack("=IIB", receive(client, 9))
+        responses[id] = (status, receive(client, size - 5).decode("utf-8"))
+    return responses
+
+def expect(actual, expected):
+    if actual != expected:
+        sys.exit("expected %r, actual %r" % (expected, actual))
+
+client = connect()
+if "serve" == sys.argv[1]:
+    responses = request(client, [(1, 0, "fuck you"), (2, 1, "shit happens"),
+                                 (3, 7, "fuck"), (4, 0, "darn it"), (5, 1, b"ok \xff")])
+    expect(responses[1], (1, ""))
+    expect(responses[2], (1, "**** happens"))
+    expect(responses[3], (2, ""))
+    expect(responses[4], (0, ""))
+    expect(responses[5], (0, "ok \ufffd"))
+elif "limit" == sys.argv[1]:
+    # A client not reading its responses holds up neither the server nor the other clients.
+    text = b"fuck " * 800
+    client.sendall(b"".join(struct.pack("=IIB", 5 + len(text), id, 1) + text
+                            for id in range(2000)))
+    other = connect()
+    other.settimeout(10)
+    expect(request(other, [(6, 1, "fuck")])[6], (1, "****"))
+
+    # The connection beyond the maximum is closed at once.
+    extra = connect()
+    extra.settimeout(10)
+    try:
+        expect(extra.recv(1), b"")
+    except ConnectionResetError:
+        pass
+else:
+    # The reload takes effect for the batches after it.
+    for _ in range(100):
+        if request(client, [(7, 0, "darn it")])[7] == (1, ""):
+            break
+        time.sleep(0.05)
+    else:
+        sys.exit("the dictionary is not reloaded")
+EOF
+
+"${DAEMON}" -w words.txt -S server.sock -j 2 -c 2 2> /dev/null &
+PID=${!}
+
+python3 client.py serve && python3 client.py limit
+EXIT_CODE=${?}
+
+if [[ ${EXIT_CODE} -eq 0 ]]; then
+  printf "darn\n" >> words.txt
+  kill -HUP ${PID}
+  python3 client.py reload
+  EXIT_CODE=${?}
+fi
+
+kill -TERM ${PID}
+wait ${PID}
+if [[ ${?} -ne 0 || -e server.sock ]]; then
+  printf "The server does not stop cleanly.\n"
+  EXIT_CODE=1
+fi
+
+popd &> /dev/null
+
+exit ${EXIT_CODE}
@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+
+PURIFIER="${PWD}/../tools/textpurifier"
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "${WORK_DIR}"' EXIT
+pushd "${WORK_DIR}" &> /dev/null
+
+EXIT_CODE=0
+expect() {
+  if [[ "${1}" != "${2}" ]]; then
+    printf "%s: expected \"%s\", actual \"%s\"\n" "${3}" "${2}" "${1}"
+    EXIT_CODE=1
+  fi
+}
+
+printf "fuck\nshit\n" > words.txt
+printf "hello\nfuck you\nno shit\n" > chat.txt
+
+OUTPUT="$("${PURIFIER}" -w words.txt check chat.txt)"
+expect "${?}:${OUTPUT}" "1:chat.txt:2"$'\n'"chat.txt:3" "check"
+OUTPUT="$(printf "hello\n" | "${PURIFIER}" -w words.txt check -)"
+expect "${?}:${OUTPUT}" "0:" "check clean"
+
+OUTPUT="$("${PURIFIER}" -w words.txt matches chat.txt)"
+expect "${?}:${OUTPUT}" "0:chat.txt:2:1:fuck"$'\n'"chat.txt:3:4:shit" "matches"
+
+OUTPUT="$("${PURIFIER}" -w words.txt -m "#" purify < chat.txt)"
+expect "${?}:${OUTPUT}" "0:hello"$'\n'"# you"$'\n'"no #" "purify"
+"${PURIFIER}" -w words.txt -s .out purify chat.txt
+expect "${?}:$(cat chat.txt.out)" "0:hello"$'\n'"**** you"$'\n'"no ****" "purify files"
+
+# The clean lines are copied byte for byte, the columns count the characters.
+printf "ok \xff\n\xe4\xbd\xa0 fuck\n" > raw.txt
+"${PURIFIER}" -w words.txt -s .out purify raw.txt
+expect "${?}:$(head -n 1 raw.txt.out | od -An -tx1 | tr -d ' ')" "0:6f6b20ff0a" "purify raw"
+OUTPUT="$("${PURIFIER}" -w words.txt matches raw.txt)"
+expect "${?}:${OUTPUT}" "0:raw.txt:2:3:fuck" "matches raw"
+
+"${PURIFIER}" -w words.txt compile words.img
+expect "${?}" "0" "compile"
+OUTPUT="$(printf "no shit\n" | "${PURIFIER}" -i words.img check)"
+expect "${?}:${OUTPUT}" "1:-:1" "check image"
+
+"${PURIFIER}" -w . check chat.txt 2> /dev/null
+expect "${?}" "2" "bad word file"
+
+popd &> /dev/null
+
+exit ${EXIT_CODE}
@@ -30,3 +30,22 @@ CPPUNIT_TEST_SUITE_REGISTRATION(TestWString);
 CPPUNIT_TEST_SUITE_REGISTRATION(TestString);
 CPPUNIT_TEST_SUITE_REGISTRATION(TestWcStr);
 CPPUNIT_TEST_SUITE_REGISTRATION(TestCStr);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestFind);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestScanContext);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestMatchMode);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestWordBoundary);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestPattern);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestApproximate);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestCompile);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestLoad);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestStaticDictionary);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestCache);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestStatistics);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestHitSketch);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestImage);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestLayered);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestPlacement);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestNodeOrder);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestCInterface);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestAsync);
+CPPUNIT_TEST_SUITE_REGISTRATION(TestMemory);
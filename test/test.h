@@ -68,4 +68,347 @@ class TestString : public TestTextPurifier<TestString, std::string> {};
 class TestWcStr : public TestTextPurifier<TestWcStr, wchar_t> {};
 class TestCStr : public TestTextPurifier<TestCStr, char> {};
 
+class TestFind : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestFind);
+    CPPUNIT_TEST(testVisitor);
+    CPPUNIT_TEST(testStop);
+    CPPUNIT_TEST(testUtf16);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testVisitor()
+    {
+        TestUtil::testFindVisitor();
+    }
+
+    void testStop()
+    {
+        TestUtil::testFindStop();
+    }
+
+    void testUtf16()
+    {
+        TestUtil::testFindUtf16();
+    }
+};
+
+class TestScanContext : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestScanContext);
+    CPPUNIT_TEST(testPurify);
+    CPPUNIT_TEST(testCheck);
+    CPPUNIT_TEST(testMaskPolicy);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testPurify()
+    {
+        TestUtil::testContextPurify();
+    }
+
+    void testCheck()
+    {
+        TestUtil::testContextCheck();
+    }
+
+    void testMaskPolicy()
+    {
+        TestUtil::testMaskPolicy();
+    }
+};
+
+class TestMatchMode : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestMatchMode);
+    CPPUNIT_TEST(testAll);
+    CPPUNIT_TEST(testLeftmostLongest);
+    CPPUNIT_TEST(testLeftmostFirst);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testAll()
+    {
+        TestUtil::testMatchModeAll();
+    }
+
+    void testLeftmostLongest()
+    {
+        TestUtil::testMatchModeLeftmostLongest();
+    }
+
+    void testLeftmostFirst()
+    {
+        TestUtil::testMatchModeLeftmostFirst();
+    }
+};
+
+class TestWordBoundary : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestWordBoundary);
+    CPPUNIT_TEST(testWordBoundary);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testWordBoundary()
+    {
+        TestUtil::testWordBoundary();
+    }
+};
+
+class TestPattern : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestPattern);
+    CPPUNIT_TEST(testAnyCharacter);
+    CPPUNIT_TEST(testGap);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testAnyCharacter()
+    {
+        TestUtil::testPatternAnyCharacter();
+    }
+
+    void testGap()
+    {
+        TestUtil::testPatternGap();
+    }
+};
+
+class TestApproximate : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestApproximate);
+    CPPUNIT_TEST(testEdit);
+    CPPUNIT_TEST(testPurify);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testEdit()
+    {
+        TestUtil::testApproximateEdit();
+    }
+
+    void testPurify()
+    {
+        TestUtil::testApproximatePurify();
+    }
+};
+
+class TestCompile : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestCompile);
+    CPPUNIT_TEST(testSuffix);
+    CPPUNIT_TEST(testScan);
+    CPPUNIT_TEST(testFanout);
+    CPPUNIT_TEST(testChain);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testSuffix()
+    {
+        TestUtil::testCompileSuffix();
+    }
+
+    void testScan()
+    {
+        TestUtil::testCompileScan();
+    }
+
+    void testFanout()
+    {
+        TestUtil::testCompileFanout();
+    }
+
+    void testChain()
+    {
+        TestUtil::testCompileChain();
+    }
+};
+
+class TestLoad : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestLoad);
+    CPPUNIT_TEST(testWords);
+    CPPUNIT_TEST(testFile);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testWords()
+    {
+        TestUtil::testLoadWords();
+    }
+
+    void testFile()
+    {
+        TestUtil::testLoadFile();
+    }
+};
+
+class TestStaticDictionary : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestStaticDictionary);
+    CPPUNIT_TEST(testFind);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testFind()
+    {
+        TestUtil::testStaticDictionaryFind();
+    }
+};
+
+class TestCache : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestCache);
+    CPPUNIT_TEST(testHit);
+    CPPUNIT_TEST(testBound);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testHit()
+    {
+        TestUtil::testCacheHit();
+    }
+
+    void testBound()
+    {
+        TestUtil::testCacheBound();
+    }
+};
+
+class TestStatistics : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestStatistics);
+    CPPUNIT_TEST(testCounters);
+    CPPUNIT_TEST(testLatency);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testCounters()
+    {
+        TestUtil::testStatistics();
+    }
+
+    void testLatency()
+    {
+        TestUtil::testLatency();
+    }
+};
+
+class TestHitSketch : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestHitSketch);
+    CPPUNIT_TEST(testTop);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testTop()
+    {
+        TestUtil::testHitSketch();
+    }
+};
+
+class TestImage : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestImage);
+    CPPUNIT_TEST(testSaveLoad);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testSaveLoad()
+    {
+        TestUtil::testImage();
+    }
+};
+
+class TestLayered : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestLayered);
+    CPPUNIT_TEST(testScan);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testScan()
+    {
+        TestUtil::testLayeredScan();
+    }
+};
+
+class TestNodeOrder : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestNodeOrder);
+    CPPUNIT_TEST(testOrder);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testOrder()
+    {
+        TestUtil::testNodeOrder();
+    }
+};
+
+class TestPlacement : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestPlacement);
+    CPPUNIT_TEST(testHugePage);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testHugePage()
+    {
+        TestUtil::testPlacement();
+    }
+};
+
+class TestMemory : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestMemory);
+    CPPUNIT_TEST(testUsage);
+    CPPUNIT_TEST(testBudget);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testUsage()
+    {
+        TestUtil::testMemoryUsage();
+    }
+
+    void testBudget()
+    {
+        TestUtil::testMemoryBudget();
+    }
+};
+
+class TestCInterface : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestCInterface);
+    CPPUNIT_TEST(testBatch);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testBatch()
+    {
+        TestUtil::testCInterface();
+    }
+};
+
+class TestAsync : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestAsync);
+    CPPUNIT_TEST(testComplete);
+    CPPUNIT_TEST(testBackpressure);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    void testComplete()
+    {
+        TestUtil::testAsyncComplete();
+    }
+
+    void testBackpressure()
+    {
+        TestUtil::testAsyncBackpressure();
+    }
+};
+
 #endif // __LAKOO_TEST_H__
@@ -32,13 +32,27 @@
 #include <cstdlib>
 #include <cstring>
 #include <cwchar>
+#include <atomic>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <limits>
 #include <list>
+#include <string>
+#include <thread>
 #include <memory>
+#include <new>
 #include <vector>
 
 #include <cppunit/extensions/HelperMacros.h>
+#include <poll.h>
 
+#include "async_purifier.h"
+#include "hit_sketch.h"
+#include "static_dictionary.h"
+#include "test_dictionary.h"
 #include "text_purifier.h"
+#include "text_purifier_c.h"
 
 
 namespace CppUnit
@@ -560,6 +574,1564 @@ namespace TestUtil
     template <> void testPurify<wchar_t>() { testRawPurify<wchar_t>(); }
     template <> void testPurify<std::string>() { testStdPurify<std::string>(); }
     template <> void testPurify<std::wstring>() { testStdPurify<std::wstring>(); }
+
+    //--------------------------------------------------------------------------
+
+    struct Match
+    {
+        std::size_t start;
+        std::size_t length;
+        std::size_t wordId;
+    };
+
+    inline void testFindVisitor()
+    {
+        std::list<std::wstring> list;
+        makeList(list);
+        lakoo::TextPurifier tp(list);
+        tp.add(L"歧視甲"); // Duplicated word keeps its ID.
+
+        std::vector<Match> matches;
+        const bool isCompleted = tp.find(L"ABC ＜歧視甲＞ 粗口乙 色情，甲乙丙 色情甲乙丙",
+                                         [&matches](std::size_t start,
+                                                    std::size_t length,
+                                                    std::size_t wordId)
+        {
+            matches.push_back(Match{start, length, wordId});
+            return true;
+        });
+
+        CPPUNIT_ASSERT_EQUAL(true, isCompleted);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), matches.size());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(5), matches[0].start);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), matches[0].length);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), matches[0].wordId);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(10), matches[1].start);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), matches[1].length);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(5), matches[1].wordId);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(21), matches[2].start);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(5), matches[2].length);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(11), matches[2].wordId);
+    }
+
+    inline void testFindStop()
+    {
+        std::list<std::wstring> list;
+        makeList(list);
+        lakoo::TextPurifier tp(list);
+
+        std::size_t count = 0;
+        const bool isCompleted = tp.find(L"歧視甲 歧視乙 歧視丙",
+                                         [&count](std::size_t, std::size_t, std::size_t)
+        {
+            return ++count < 2;
+        });
+
+        CPPUNIT_ASSERT_EQUAL(false, isCompleted);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(2), count);
+
+        // The segments are handed over in batches, the scan still stops at the visitor and only
+        // the visited segments are counted as hits.
+        std::wstring text;
+        std::u16string utf16Text;
+        for(int index = 0; index < 100; ++index)
+        {
+            text += L"歧視甲 ";
+            utf16Text += u"歧視甲 ";
+        }
+
+        tp.setHitSketchWidth(64);
+        count = 0;
+        CPPUNIT_ASSERT_EQUAL(false, tp.find(text, [&count](std::size_t, std::size_t, std::size_t)
+        {
+            return ++count < 70;
+        }));
+        CPPUNIT_ASSERT_EQUAL(std::size_t(70), count);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(70), tp.wordHits(0));
+
+        std::vector<Match> matches;
+        CPPUNIT_ASSERT_EQUAL(true, tp.find(utf16Text, [&matches](std::size_t start,
+                                                                 std::size_t length,
+                                                                 std::size_t wordId)
+        {
+            matches.push_back(Match{start, length, wordId});
+            return true;
+        }));
+        CPPUNIT_ASSERT_EQUAL(std::size_t(100), matches.size());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(396), matches[99].start);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), matches[99].length);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(170), tp.wordHits(0));
+    }
+
+    inline void testFindUtf16()
+    {
+        lakoo::TextPurifier tp(std::list<std::wstring>{ L"fuck", L"粗口", L"\U0001F4A9x", L"色情" });
+
+        // A supplementary character is a surrogate pair, and a lone surrogate is kept.
+        const std::u16string lone(1, static_cast<char16_t>(0xD800));
+        const std::u16string text = u"\U0001F600 FUCK \U0001F4A9X 粗口" + lone + u" 色 情";
+        std::vector<Match> matches;
+        const bool isCompleted = tp.find(text, [&matches](std::size_t start,
+                                                          std::size_t length,
+                                                          std::size_t wordId)
+        {
+            matches.push_back(Match{start, length, wordId});
+            return true;
+        });
+
+        CPPUNIT_ASSERT_EQUAL(true, isCompleted);
+        const Match expected[] = {
+            Match{3, 4, 0}, Match{8, 3, 2}, Match{12, 2, 1}, Match{16, 3, 3}
+        };
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), matches.size());
+        for(std::size_t index = 0; index < matches.size(); ++index)
+        {
+            CPPUNIT_ASSERT_EQUAL(expected[index].start, matches[index].start);
+            CPPUNIT_ASSERT_EQUAL(expected[index].length, matches[index].length);
+            CPPUNIT_ASSERT_EQUAL(expected[index].wordId, matches[index].wordId);
+        }
+
+        CPPUNIT_ASSERT_EQUAL(true, tp.check(text));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check(std::u16string(u"\U0001F4A9 粗 話") + lone));
+        CPPUNIT_ASSERT(u"\U0001F600 **** ** **" + lone + u" ***" == tp.purify(text, u'*', true));
+        CPPUNIT_ASSERT(u"\U0001F600 \U0001F6AB \U0001F6AB \U0001F6AB" + lone + u" \U0001F6AB" ==
+                       tp.purify(text, u"\U0001F6AB"));
+
+        // The buffers of a ScanContext are reused, the text needs no terminator.
+        lakoo::ScanContext context;
+        CPPUNIT_ASSERT_EQUAL(false, tp.check(context, text.data(), 2));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check(context, text.data(), 7));
+        CPPUNIT_ASSERT(u"\U0001F600 ****" == tp.purify(context, text.data(), 7, u'*', true));
+        CPPUNIT_ASSERT(u"\U0001F600 #" == tp.purify(context, text.data(), 7, u"#", 1));
+    }
+
+    //--------------------------------------------------------------------------
+
+    inline void testContextPurify()
+    {
+        std::list<std::string> list;
+        makeList(list);
+        lakoo::TextPurifier tp(list);
+        lakoo::ScanContext context;
+
+        // The same context is reused for every call, results must not leak between calls.
+        for(int round = 0; round < 2; ++round)
+        {
+            CPPUNIT_ASSERT_EQUAL(std::string("ABC ＜禁言＞ 粗口 ＜禁言＞乙"),
+                                 tp.purify(context,
+                                           std::string("ABC ＜歧視甲＞ 粗口 ＜色情甲乙丙＞乙"),
+                                           std::string("禁言")));
+            CPPUNIT_ASSERT_EQUAL(std::string("***乙"),
+                                 tp.purify(context, std::string("粗口甲乙"), '*', true));
+            CPPUNIT_ASSERT_EQUAL(std::wstring(L"ABC ＜禁＞"),
+                                 tp.purify(context, std::wstring(L"ABC ＜歧視乙＞"), L'禁', false));
+            CPPUNIT_ASSERT_EQUAL(std::wstring(L"禁禁禁禁禁"),
+                                 tp.purify(context, std::wstring(L"色情甲乙丙"), L'禁', true));
+            CPPUNIT_ASSERT_EQUAL(static_cast<const char*>("#，#"),
+                                 tp.purify(context, "歧視丙，粗口丙", "#"));
+            CPPUNIT_ASSERT_EQUAL(static_cast<const char*>("甲乙丙"),
+                                 tp.purify(context, "甲乙丙", '#', false));
+            CPPUNIT_ASSERT_EQUAL(static_cast<const wchar_t*>(L"*禁言*"),
+                                 tp.purify(context, L"歧視甲乙丙", L"*禁言*"));
+            CPPUNIT_ASSERT_EQUAL(static_cast<const wchar_t*>(L"###"),
+                                 tp.purify(context, L"色情丙", L'#', true));
+        }
+
+        // The result of a context can be purified again with the same context.
+        const std::wstring& result = tp.purify(context, std::wstring(L"粗口甲粗口乙"), L"粗口丙");
+        CPPUNIT_ASSERT_EQUAL(std::wstring(L"##"), tp.purify(context, result, L'#', false));
+        const std::wstring& mask = tp.purify(context, std::wstring(L"色情丙"), L'#', true);
+        CPPUNIT_ASSERT_EQUAL(std::wstring(L"###"),
+                             tp.purify(context, std::wstring(L"歧視甲乙丙"), mask));
+
+        // So can the string or the mask of the pointer overloads, even from inside the result.
+        const wchar_t* text = tp.purify(context, L"粗口甲粗口乙", L"粗口丙");
+        CPPUNIT_ASSERT_EQUAL(std::wstring(L"##"), std::wstring(tp.purify(context, text, L"#")));
+        const wchar_t* masks = tp.purify(context, L"色情丙", L'#', true);
+        CPPUNIT_ASSERT_EQUAL(std::wstring(L"##"),
+                             std::wstring(tp.purify(context, L"歧視甲乙丙", masks + 1)));
+        text = tp.purify(context, L"粗口甲粗口乙", L"甲粗口丙");
+        CPPUNIT_ASSERT_EQUAL(std::wstring(L"###甲###"),
+                             std::wstring(tp.purify(context, text + 1, L'#', true)));
+
+        // The in-place overloads take a mask from inside the string they rewrite.
+        std::string utf8 = "粗口甲 #";
+        CPPUNIT_ASSERT_EQUAL(std::string("# #"), tp.purify(utf8, utf8.c_str() + utf8.size() - 1));
+        std::wstring wide = L"粗口甲 #";
+        CPPUNIT_ASSERT_EQUAL(std::wstring(L"# #"), tp.purify(wide, wide.c_str() + wide.size() - 1));
+
+        // The context tells whether the last purify found any word, from the cache too.
+        tp.purify(context, std::string("粗口甲"), std::string("粗口甲"));
+        CPPUNIT_ASSERT_EQUAL(true, context.isFound());
+        tp.setCacheSize(16);
+        for(int round = 0; round < 2; ++round)
+        {
+            tp.purify(context, std::string("甲乙丙"), '#', false);
+            CPPUNIT_ASSERT_EQUAL(false, context.isFound());
+            tp.purify(context, std::wstring(L"粗口甲"), L'#', false);
+            CPPUNIT_ASSERT_EQUAL(true, context.isFound());
+        }
+        CPPUNIT_ASSERT_EQUAL(std::size_t(2), tp.cacheStatistics()._hits);
+        tp.setCacheSize(0);
+
+        context.clear();
+        CPPUNIT_ASSERT_EQUAL(false, context.isFound());
+        CPPUNIT_ASSERT_EQUAL(std::string(""), tp.purify(context, std::string(""), std::string("#")));
+    }
+
+    inline void testContextCheck()
+    {
+        std::list<std::string> list;
+        makeList(list);
+        lakoo::TextPurifier tp(list);
+        lakoo::ScanContext context;
+
+        CPPUNIT_ASSERT_EQUAL(true, tp.check(context, std::string("這是歧視甲啊")));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check(context, std::string("這是歧視啊")));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check(context, std::wstring(L"粗口 乙")));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check(context, std::wstring(L"粗口")));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check(context, "色情丙"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check(context, ""));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check(context, L"歧視甲乙丙"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check(context, L"甲乙丙"));
+    }
+
+    //--------------------------------------------------------------------------
+
+    inline std::vector<Match> findAll(const lakoo::TextPurifier& tp, const std::wstring& str)
+    {
+        std::vector<Match> matches;
+        tp.find(str, [&matches](std::size_t start, std::size_t length, std::size_t wordId)
+        {
+            matches.push_back(Match{start, length, wordId});
+            return true;
+        });
+        return matches;
+    }
+
+    inline void assertMatch(const Match& match,
+                            std::size_t start,
+                            std::size_t length,
+                            std::size_t wordId)
+    {
+        CPPUNIT_ASSERT_EQUAL(start, match.start);
+        CPPUNIT_ASSERT_EQUAL(length, match.length);
+        CPPUNIT_ASSERT_EQUAL(wordId, match.wordId);
+    }
+
+    inline void testMatchModeAll()
+    {
+        lakoo::TextPurifier tp(std::list<std::wstring>{ L"ab", L"bc", L"abcd", L"bcd" });
+        CPPUNIT_ASSERT(lakoo::MatchMode::All == tp.matchMode());
+
+        std::vector<Match> matches = findAll(tp, L"abc abcd");
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), matches.size());
+        assertMatch(matches[0], 0, 2, 0);
+        assertMatch(matches[1], 1, 2, 1);
+        assertMatch(matches[2], 4, 4, 2);
+        assertMatch(matches[3], 5, 3, 3);
+        CPPUNIT_ASSERT_EQUAL(std::wstring(L"#"), tp.purify(std::wstring(L"abc"), L"#"));
+        CPPUNIT_ASSERT_EQUAL(std::wstring(L"###"), tp.purify(std::wstring(L"abc"), L'#', true));
+    }
+
+    inline void testMatchModeLeftmostLongest()
+    {
+        lakoo::TextPurifier tp(std::list<std::wstring>{ L"ab", L"bc", L"abcd", L"bcd" });
+        tp.setMatchMode(lakoo::MatchMode::LeftmostLongest);
+        CPPUNIT_ASSERT(lakoo::MatchMode::LeftmostLongest == tp.matchMode());
+
+        std::vector<Match> matches = findAll(tp, L"abc abcd bcab");
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), matches.size());
+        assertMatch(matches[0], 0, 2, 0);
+        assertMatch(matches[1], 4, 4, 2);
+        assertMatch(matches[2], 9, 2, 1);
+        assertMatch(matches[3], 11, 2, 0);
+        CPPUNIT_ASSERT_EQUAL(std::wstring(L"#c # ##"), tp.purify(std::wstring(L"abc abcd bcab"), L"#"));
+    }
+
+    inline void testMatchModeLeftmostFirst()
+    {
+        lakoo::TextPurifier tp(std::list<std::wstring>{ L"ab", L"abcd", L"bcd" });
+        tp.setMatchMode(lakoo::MatchMode::LeftmostFirst);
+
+        std::vector<Match> matches = findAll(tp, L"abcd");
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1), matches.size());
+        assertMatch(matches[0], 0, 2, 0);
+
+        lakoo::TextPurifier reversed(std::list<std::wstring>{ L"abcd", L"ab", L"bcd" });
+        reversed.setMatchMode(lakoo::MatchMode::LeftmostFirst);
+
+        matches = findAll(reversed, L"abcd abc");
+        CPPUNIT_ASSERT_EQUAL(std::size_t(2), matches.size());
+        assertMatch(matches[0], 0, 4, 0);
+        assertMatch(matches[1], 5, 2, 1);
+    }
+
+    //--------------------------------------------------------------------------
+
+    inline void testWordBoundary()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "ass", "色情", "gg中", "éclair" });
+        CPPUNIT_ASSERT_EQUAL(false, tp.isWordBoundary());
+
+        const std::string text("class ass, Ass! passé 這是色情片 égg中文 éclairs éclair");
+        CPPUNIT_ASSERT_EQUAL(std::string("cl# #, #! p#é 這是#片 é#文 #s #"),
+                             tp.purify(text, "#"));
+
+        tp.setWordBoundary(true);
+        CPPUNIT_ASSERT_EQUAL(true, tp.isWordBoundary());
+        CPPUNIT_ASSERT_EQUAL(std::string("class #, #! passé 這是#片 égg中文 éclairs #"),
+                             tp.purify(text, "#"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("classes"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("a s s"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("色情片"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("gg中文"));
+    }
+
+    //--------------------------------------------------------------------------
+
+    inline void testPatternAnyCharacter()
+    {
+        lakoo::TextPurifier tp;
+        tp.add("gold?");
+        tp.addPattern("f?ck");
+        tp.addPattern("色?圖片");
+        tp.addPattern("??");
+
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("fuck"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("F*CK"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("f u c k"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("fck"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("fuuck"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("色情圖片"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("色圖片"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("golds"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("gold?"));
+        CPPUNIT_ASSERT_EQUAL(std::string("這是# #"), tp.purify(std::string("這是色請圖片 fvck"), "#"));
+    }
+
+    inline void testPatternGap()
+    {
+        lakoo::TextPurifier tp;
+        tp.addPattern("*粗*口*");
+        tp.addPattern("b*u*y*g*o*l*d");
+        tp.addPattern("***");
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), tp.maxGap());
+
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("粗口"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("粗x口"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("粗xxx口"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("粗xxxx口"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("粗 x x x 口"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("b_u_y g o l d"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("B-U-Y--G-O-L-D"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("buy silver"));
+        CPPUNIT_ASSERT_EQUAL(std::string("[#]"), tp.purify(std::string("[粗x口]"), "#"));
+        CPPUNIT_ASSERT_EQUAL(std::string("[###]"), tp.purify(std::string("[粗x口]"), '#', true));
+
+        tp.setMaxGap(1);
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("粗x口"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("粗xx口"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("B-U-Y--G-O-L-D"));
+    }
+
+    //--------------------------------------------------------------------------
+
+    inline void testApproximateEdit()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "色情圖片", "粗口" });
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), tp.maxDistance());
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("fvck"));
+
+        tp.setMaxDistance(1);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1), tp.maxDistance());
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("fuck"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("fvck"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("fuk"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("fuuck"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("f u v c k"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("vuck"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("fvvck"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("色請圖片"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("色情圖"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("粗口"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("粗囗"));
+
+        tp.setMaxDistance(2);
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("fvvck"));
+
+        lakoo::TextPurifier longWord(std::list<std::string>{ "motherfucker" });
+        longWord.setMaxDistance(1);
+        CPPUNIT_ASSERT_EQUAL(false, longWord.check("mothafucker"));
+        longWord.setMaxDistance(2);
+        CPPUNIT_ASSERT_EQUAL(true, longWord.check("mothafucker"));
+
+        // A long run of the same character is followed once per state, not once per repeat.
+        lakoo::TextPurifier repeat(std::list<std::wstring>{ std::wstring(40, L'a') });
+        repeat.setMaxDistance(1);
+        CPPUNIT_ASSERT_EQUAL(true, repeat.check(L"ab" + std::wstring(38, L'a') + L"bb"));
+        CPPUNIT_ASSERT_EQUAL(false, repeat.check(L"ab" + std::wstring(37, L'a') + L"bb"));
+        tp.setMaxDistance(1);
+        CPPUNIT_ASSERT_EQUAL(std::string("fuuuuuuuuuuuuuuuuuuuuuuuuuuuuck # #!"),
+                             tp.purify(std::string("fuuuuuuuuuuuuuuuuuuuuuuuuuuuuck fuuck fuk!"),
+                                       "#"));
+
+        // An empty dictionary matches nothing.
+        lakoo::TextPurifier empty;
+        empty.setMaxDistance(1);
+        CPPUNIT_ASSERT_EQUAL(false, empty.check("fuck"));
+        CPPUNIT_ASSERT_EQUAL(std::string("fuck"), empty.purify(std::string("fuck"), "#"));
+    }
+
+    inline void testApproximatePurify()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "fucking" });
+        tp.setMaxDistance(1);
+        tp.setMatchMode(lakoo::MatchMode::LeftmostLongest);
+
+        CPPUNIT_ASSERT_EQUAL(std::string("x# and #!"),
+                             tp.purify(std::string("xfvck and fvcking!"), "#"));
+        CPPUNIT_ASSERT_EQUAL(std::string("x#### ####n"),
+                             tp.purify(std::string("xfvck fuckn"), '#', true));
+    }
+
+    inline void testCompileSuffix()
+    {
+        lakoo::TextPurifier tp(std::list<std::wstring>{ L"walking", L"talking", L"walked",
+                                                        L"talked", L"色情", L"愛情" });
+        const std::wstring text = L"walking talked 愛情 色情 walk";
+        const std::vector<Match> expected = findAll(tp, text);
+        const std::size_t nodeCount = tp.nodeCount();
+        CPPUNIT_ASSERT_EQUAL(std::size_t(23), nodeCount);
+        CPPUNIT_ASSERT_EQUAL(false, tp.isCompiled());
+
+        tp.compile();
+        CPPUNIT_ASSERT_EQUAL(true, tp.isCompiled());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(10), tp.nodeCount());
+
+        const std::vector<Match> matches = findAll(tp, text);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), matches.size());
+        CPPUNIT_ASSERT_EQUAL(expected.size(), matches.size());
+        for(std::size_t index = 0; index < matches.size(); ++index)
+        {
+            assertMatch(matches[index],
+                        expected[index].start,
+                        expected[index].length,
+                        expected[index].wordId);
+        }
+        assertMatch(matches[0], 0, 7, 0);
+        assertMatch(matches[1], 8, 6, 3);
+        assertMatch(matches[2], 15, 2, 5);
+        assertMatch(matches[3], 18, 2, 4);
+
+        tp.add(L"walk");
+        CPPUNIT_ASSERT_EQUAL(false, tp.isCompiled());
+        CPPUNIT_ASSERT_EQUAL(nodeCount, tp.nodeCount());
+        CPPUNIT_ASSERT_EQUAL(std::wstring(L"******* ****** ** ** ****"),
+                             tp.purify(text, L'*', true));
+    }
+
+    inline void testCompileScan()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "fucking", "shit", "色情圖片" });
+        tp.addPattern("f?ck");
+        tp.addPattern("色*圖片");
+        tp.setMatchMode(lakoo::MatchMode::LeftmostLongest);
+        tp.compile();
+
+        CPPUNIT_ASSERT_EQUAL(std::string("# # # #"),
+                             tp.purify(std::string("fucking fxck shit 色情的圖片"), "#"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("fuc"));
+
+        tp.setMaxDistance(1);
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("fvcking"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("色請圖片"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("vuck"));
+
+        tp.setMaxDistance(0);
+        tp.setMatchMode(lakoo::MatchMode::All);
+        std::vector<Match> matches = findAll(tp, L"fucking");
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1), matches.size());
+        assertMatch(matches[0], 0, 7, 1);
+
+        lakoo::TextPurifier empty;
+        empty.compile();
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1), empty.nodeCount());
+        CPPUNIT_ASSERT_EQUAL(false, empty.check("fuck"));
+    }
+
+    inline void testCompileFanout()
+    {
+        // A root of every other character of a range, dense nodes of 40 characters among 100,
+        // sorted nodes of 20 and 5 characters, and chains of single edges.
+        std::list<std::wstring> words;
+        for(wchar_t first = 0x4E00; first < 0x4E00 + 200; first += 2)
+        {
+            const std::size_t fanout = 0 == first % 3 ? 40 : (1 == first % 3 ? 20 : 5);
+            for(std::size_t index = 0; index < fanout; ++index)
+            {
+                const wchar_t second = static_cast<wchar_t>(L'a' + index * 100 / fanout / 2);
+                words.push_back(std::wstring{ first, second, L'x', L'y', L'z' });
+            }
+        }
+        lakoo::TextPurifier trie(words);
+        lakoo::TextPurifier tp(words);
+        tp.compile();
+
+        // Every word is found with its ID, and the characters between the edges are not.
+        for(const std::wstring& word : words)
+        {
+            std::vector<Match> matches = findAll(tp, word);
+            CPPUNIT_ASSERT_EQUAL(std::size_t(1), matches.size());
+            assertMatch(matches[0], 0, 5, findAll(trie, word)[0].wordId);
+            for(wchar_t offset : { -1, 1 })
+            {
+                std::wstring other(word);
+                other[1] = static_cast<wchar_t>(other[1] + offset);
+                CPPUNIT_ASSERT_EQUAL(trie.check(other), tp.check(other));
+                other = word;
+                other[0] = static_cast<wchar_t>(other[0] + offset);
+                CPPUNIT_ASSERT_EQUAL(trie.check(other), tp.check(other));
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(false, tp.check(std::wstring{ 0x4DFF, L'a', L'x', L'y', L'z' }));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check(std::wstring{ 0x4E00, L'a', L'x', L'y' }));
+
+        tp.setMaxDistance(1);
+        trie.setMaxDistance(1);
+        const std::wstring typo{ 0x4E02, L'b', L'x', L'q', L'z' };
+        CPPUNIT_ASSERT_EQUAL(trie.purify(typo, L'*', true), tp.purify(typo, L'*', true));
+    }
+
+    inline void testCompileChain()
+    {
+        // Long words whose tails are chains of single edges, some sharing a prefix or a suffix.
+        const std::list<std::wstring> words = {
+            L"www.example.com/free-download",
+            L"www.example.com/freebies",
+            L"buycheappillsonlinenow",
+            L"makemoneyfastfromhome",
+            L"workfromhome",
+            L"色情網站免費下載",
+            L"abcdefghijklmnopq"
+        };
+        lakoo::TextPurifier trie(words);
+        lakoo::TextPurifier tp(words);
+        tp.compile();
+        CPPUNIT_ASSERT_EQUAL(true, tp.isCompiled());
+
+        // The chains are matched across spaces and case, and are broken at any point.
+        const std::wstring texts[] = {
+            L"go to WWW.Example.com/free-download now",
+            L"www.example.com/freebie www.example.com/freebies",
+            L"buy cheap pills online now, make money fast from home",
+            L"buycheappillsonlinenot workfromhom abcdefghijklmnop abcdefghijklmnopq",
+            L"色 情網站免費下 載 色情網站免費",
+            L"abcdefghijklmnoq abcdefghXjklmnopq abcd efgh ijkl mnop q"
+        };
+        for(const std::wstring& text : texts)
+        {
+            std::vector<Match> expected = findAll(trie, text);
+            std::vector<Match> matches = findAll(tp, text);
+            CPPUNIT_ASSERT_EQUAL(expected.size(), matches.size());
+            for(std::size_t index = 0; index < matches.size(); ++index)
+            {
+                assertMatch(matches[index],
+                            expected[index].start,
+                            expected[index].length,
+                            expected[index].wordId);
+            }
+            CPPUNIT_ASSERT(trie.purify(text, L'*', true) == tp.purify(text, L'*', true));
+        }
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), findAll(tp, texts[2]).size() +
+                                             findAll(tp, texts[5]).size());
+
+        // The chains survive the image and the ordering of the nodes.
+        const std::string path = "test_chain.bin";
+        CPPUNIT_ASSERT_EQUAL(true, tp.saveImage(path));
+        lakoo::TextPurifier loaded;
+        CPPUNIT_ASSERT_EQUAL(true, loaded.loadImage(path));
+        std::remove(path.c_str());
+        CPPUNIT_ASSERT_EQUAL(tp.nodeCount(), loaded.nodeCount());
+        CPPUNIT_ASSERT_EQUAL(true, loaded.orderNodes(std::list<std::string>{ "workfromhome" }));
+        for(const std::wstring& text : texts)
+        {
+            CPPUNIT_ASSERT(tp.purify(text, L'*', true) == loaded.purify(text, L'*', true));
+        }
+
+        // The approximate scan walks the chains one state at a time.
+        tp.setMaxDistance(1);
+        trie.setMaxDistance(1);
+        const std::wstring typo = L"buy cheap pils online now, workfrmhome";
+        CPPUNIT_ASSERT(trie.purify(typo, L'*', true) == tp.purify(typo, L'*', true));
+
+        // And so does the scan of patterns.
+        lakoo::TextPurifier patterns(words);
+        patterns.addPattern(L"make?oney*home");
+        lakoo::TextPurifier compiled(words);
+        compiled.addPattern(L"make?oney*home");
+        compiled.compile();
+        const std::wstring text = L"makeMoneyhome makemoneyfastfromhome make money at home";
+        CPPUNIT_ASSERT(patterns.purify(text, L'*', true) == compiled.purify(text, L'*', true));
+    }
+
+    inline void testLoadWords()
+    {
+        lakoo::TextPurifier tp;
+        tp.add("fuck");
+
+        const std::string data = "\xEF\xBB\xBFShit\n fuck \n色 情\r\nshit\n\n\t粗口";
+        tp.addWords(data.data(), data.size());
+        CPPUNIT_ASSERT_EQUAL(true, tp.isCompiled());
+
+        std::vector<Match> matches = findAll(tp, L"粗口 shit 色情 fuck");
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), matches.size());
+        assertMatch(matches[0], 0, 2, 3);
+        assertMatch(matches[1], 3, 4, 1);
+        assertMatch(matches[2], 8, 2, 2);
+        assertMatch(matches[3], 11, 4, 0);
+
+        // The words split among threads get the same IDs as the words added one by one.
+        std::list<std::string> words;
+        std::string content;
+        for(int index = 0; index < 40000; ++index)
+        {
+            const std::string word = "w" + std::to_string(index * 7919 % 40000);
+            words.push_back(word);
+            content += word + "\n";
+        }
+
+        lakoo::TextPurifier expected(words);
+        lakoo::TextPurifier loaded;
+        loaded.addWords(content.data(), content.size(), 4);
+        const std::wstring text = L"w0 w1 w17 w39999 w123 w40000";
+        std::vector<Match> expectedMatches = findAll(expected, text);
+        matches = findAll(loaded, text);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(6), matches.size());
+        CPPUNIT_ASSERT_EQUAL(expectedMatches.size(), matches.size());
+        for(std::size_t index = 0; index < matches.size(); ++index)
+        {
+            assertMatch(matches[index],
+                        expectedMatches[index].start,
+                        expectedMatches[index].length,
+                        expectedMatches[index].wordId);
+        }
+    }
+
+    inline void testLoadFile()
+    {
+        const char* const path = "test_words.txt";
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << "色情\nfuck\r\n";
+        }
+
+        lakoo::TextPurifier tp;
+        CPPUNIT_ASSERT_EQUAL(true, tp.addFile(path));
+        std::remove(path);
+        CPPUNIT_ASSERT_EQUAL(std::string("# #"), tp.purify(std::string("色情 FUCK"), "#"));
+
+        tp.add("shit");
+        CPPUNIT_ASSERT_EQUAL(false, tp.isCompiled());
+        CPPUNIT_ASSERT_EQUAL(std::string("# # #"), tp.purify(std::string("色情 FUCK shit"), "#"));
+        CPPUNIT_ASSERT_EQUAL(false, tp.addFile("no_such_words.txt", 2));
+        CPPUNIT_ASSERT_EQUAL(false, tp.addFile("."));
+        CPPUNIT_ASSERT_EQUAL(false, tp.loadImage("."));
+    }
+
+    inline void testStaticDictionaryFind()
+    {
+        static_assert(12 == testDictionary.wordCount(), "The tables are built at compile time.");
+
+        std::list<std::wstring> list;
+        makeList(list);
+        lakoo::TextPurifier tp(list);
+
+        const std::wstring text = L"歧視甲乙丙 色情 乙 粗口 粗口丙甲";
+        const lakoo::MatchMode modes[] = {
+            lakoo::MatchMode::All,
+            lakoo::MatchMode::LeftmostLongest,
+            lakoo::MatchMode::LeftmostFirst
+        };
+        for(lakoo::MatchMode mode : modes)
+        {
+            tp.setMatchMode(mode);
+            const std::vector<Match> expected = findAll(tp, text);
+
+            std::vector<Match> matches;
+            testDictionary.find(text.data(), text.size(), mode,
+                                [&matches](std::size_t start, std::size_t length, std::size_t wordId)
+            {
+                matches.push_back(Match{start, length, wordId});
+                return true;
+            });
+
+            CPPUNIT_ASSERT_EQUAL(expected.size(), matches.size());
+            for(std::size_t index = 0; index < matches.size(); ++index)
+            {
+                assertMatch(matches[index],
+                            expected[index].start,
+                            expected[index].length,
+                            expected[index].wordId);
+            }
+        }
+
+        CPPUNIT_ASSERT_EQUAL(true, testDictionary.check(text.data(), text.size()));
+        CPPUNIT_ASSERT_EQUAL(false, testDictionary.check(L"粗口", 2));
+        tp.compile();
+        CPPUNIT_ASSERT_EQUAL(tp.nodeCount(), testDictionary.nodeCount());
+    }
+
+    inline void testCacheHit()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "shit" });
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), tp.cacheSize());
+        tp.setCacheSize(100);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(100), tp.cacheSize());
+
+        for(int round = 0; round < 3; ++round)
+        {
+            CPPUNIT_ASSERT_EQUAL(std::string("gg #"), tp.purify(std::string("gg fuck"), "#"));
+            CPPUNIT_ASSERT_EQUAL(std::string("gg ****"), tp.purify(std::string("gg fuck"), '*', true));
+            CPPUNIT_ASSERT_EQUAL(true, tp.check("gg shit"));
+            CPPUNIT_ASSERT_EQUAL(false, tp.check("gg"));
+        }
+
+        lakoo::CacheStatistics statistics = tp.cacheStatistics();
+        CPPUNIT_ASSERT_EQUAL(std::size_t(8), statistics._hits);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), statistics._misses);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), statistics._size);
+
+        // A long string is not cached.
+        const std::string longText(300, 'a');
+        CPPUNIT_ASSERT_EQUAL(false, tp.check(longText));
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), tp.cacheStatistics()._misses);
+
+        // The results are dropped once the words or options change.
+        tp.add("gg");
+        CPPUNIT_ASSERT_EQUAL(true, tp.check("gg"));
+        CPPUNIT_ASSERT_EQUAL(std::string("# #"), tp.purify(std::string("gg fuck"), "#"));
+        tp.setMatchMode(lakoo::MatchMode::LeftmostFirst);
+        CPPUNIT_ASSERT_EQUAL(std::string("# #"), tp.purify(std::string("gg fuck"), "#"));
+        statistics = tp.cacheStatistics();
+        CPPUNIT_ASSERT_EQUAL(std::size_t(8), statistics._hits);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(7), statistics._misses);
+
+        tp.setCacheSize(0);
+        CPPUNIT_ASSERT_EQUAL(false, tp.check("lol"));
+        statistics = tp.cacheStatistics();
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), statistics._misses);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), statistics._size);
+    }
+
+    inline void testCacheBound()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck" });
+        tp.setCacheSize(32);
+        for(int index = 0; index < 1000; ++index)
+        {
+            tp.check("message " + std::to_string(index));
+        }
+        CPPUNIT_ASSERT(tp.cacheStatistics()._size <= 32);
+
+        // The threads share the cache, each with its own ScanContext.
+        std::vector<std::thread> threads;
+        bool isCorrect[4] = { false, false, false, false };
+        for(int index = 0; index < 4; ++index)
+        {
+            threads.emplace_back([&tp, &isCorrect, index]()
+            {
+                lakoo::ScanContext context;
+                bool result = true;
+                for(int round = 0; round < 1000; ++round)
+                {
+                    const std::string text = "fuck " + std::to_string(round % 50);
+                    result = result &&
+                             "# " + std::to_string(round % 50) == tp.purify(context, text, "#");
+                }
+                isCorrect[index] = result;
+            });
+        }
+
+        for(std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        for(bool result : isCorrect)
+        {
+            CPPUNIT_ASSERT_EQUAL(true, result);
+        }
+    }
+
+    inline void testStatistics()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "shit" });
+        lakoo::RuntimeStatistics statistics = tp.statistics();
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), statistics._purifyCalls);
+        CPPUNIT_ASSERT_EQUAL(false, tp.isStatisticsEnabled());
+
+        // Nothing is counted until the counters are enabled.
+        tp.purify(std::string("fuck"), "#");
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), tp.statistics()._purifyCalls);
+
+        tp.setStatisticsEnabled(true);
+        if(!tp.isStatisticsEnabled())
+        {
+            // The counters are compiled out.
+            tp.check("shit");
+            CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), tp.statistics()._checkCalls);
+            return;
+        }
+
+        lakoo::ScanContext context;
+        CPPUNIT_ASSERT_EQUAL(std::string("# gg #"), tp.purify(context, std::string("fuck gg shit"), "#"));
+        CPPUNIT_ASSERT_EQUAL(true, tp.check(context, std::string("fuck")));
+        CPPUNIT_ASSERT_EQUAL(false, tp.check(context, L"gg"));
+        std::size_t count = 0;
+        tp.find(std::wstring(L"shit"), [&count](std::size_t, std::size_t, std::size_t)
+        {
+            ++count;
+            return true;
+        });
+
+        statistics = tp.statistics();
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), statistics._purifyCalls);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(2), statistics._checkCalls);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), statistics._findCalls);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(16), statistics._bytes);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(22), statistics._characters);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(16), statistics._transitions);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(4), statistics._matches);
+        CPPUNIT_ASSERT(statistics._allocations > 0);
+
+        // The buffers of the context are reused.
+        tp.check(context, std::string("fuck"));
+        CPPUNIT_ASSERT_EQUAL(statistics._allocations, tp.statistics()._allocations);
+
+        tp.resetStatistics();
+        statistics = tp.statistics();
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), statistics._checkCalls);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), statistics._transcodingTime);
+    }
+
+    inline void testHitSketch()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "shit", "ass" });
+        tp.purify(std::string("fuck"), "#");
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), tp.hitSketchWidth());
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), tp.wordHits(0));
+        CPPUNIT_ASSERT(tp.topWords(3).empty());
+
+        tp.setHitSketchWidth(1000);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1024), tp.hitSketchWidth());
+
+        tp.purify(std::string("fuck shit fuck"), "#");
+        tp.check(std::string("ass"));
+        tp.find(std::wstring(L"fuck"), [](std::size_t, std::size_t, std::size_t)
+        {
+            return true;
+        });
+
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(3), tp.wordHits(0));
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), tp.wordHits(1));
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), tp.wordHits(2));
+
+        std::vector<lakoo::WordHits> top = tp.topWords(2);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(2), top.size());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), top[0]._wordId);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(3), top[0]._hits);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1), top[1]._wordId);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(1), top[1]._hits);
+
+        // The copies of all threads are summed up.
+        std::vector<std::thread> threads;
+        for(int index = 0; index < 4; ++index)
+        {
+            threads.emplace_back([&tp]()
+            {
+                lakoo::ScanContext context;
+                for(int round = 0; round < 1000; ++round)
+                {
+                    tp.check(context, std::string("shit"));
+                }
+            });
+        }
+
+        for(std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        top = tp.topWords(5);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), top.size());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1), top[0]._wordId);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(4001), top[0]._hits);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(0), top[1]._wordId);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(2), top[2]._wordId);
+
+        // A result taken from the cache counts its words again.
+        tp.setCacheSize(16);
+        for(int round = 0; round < 3; ++round)
+        {
+            tp.purify(std::string("ass fuck ass"), "#");
+            tp.check(std::string("ass"));
+        }
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), tp.cacheStatistics()._hits);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(6), tp.wordHits(0));
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(10), tp.wordHits(2));
+        tp.setCacheSize(0);
+
+        tp.setHitSketchWidth(0);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), tp.wordHits(1));
+
+        // A counter at its maximum stays there.
+        std::atomic<std::uint8_t> small(250);
+        for(int round = 0; round < 10; ++round)
+        {
+            lakoo::saturatingIncrement(small);
+        }
+        CPPUNIT_ASSERT_EQUAL(255, static_cast<int>(small.load()));
+        std::atomic<std::uint32_t> counter(std::numeric_limits<std::uint32_t>::max() - 1);
+        lakoo::saturatingIncrement(counter);
+        lakoo::saturatingIncrement(counter);
+        CPPUNIT_ASSERT_EQUAL(std::numeric_limits<std::uint32_t>::max(), counter.load());
+    }
+
+    struct TraceRecord
+    {
+        lakoo::Phase _phase;
+        std::uint64_t _start;
+        std::uint64_t _end;
+    };
+
+    inline void trace(void* context, lakoo::Phase phase, std::uint64_t start, std::uint64_t end)
+    {
+        static_cast<std::vector<TraceRecord>*>(context)->push_back(TraceRecord{phase, start, end});
+    }
+
+    inline void testLatency()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "shit" });
+        std::vector<TraceRecord> records;
+        tp.setTraceCallback(&trace, &records);
+        tp.setStatisticsEnabled(true);
+
+        lakoo::ScanContext context;
+        for(int round = 0; round < 10; ++round)
+        {
+            CPPUNIT_ASSERT_EQUAL(std::string("# gg #"),
+                                 tp.purify(context, std::string("fuck gg shit"), "#"));
+        }
+        CPPUNIT_ASSERT_EQUAL(true, tp.check(context, L"shit"));
+
+        if(!tp.isStatisticsEnabled())
+        {
+            // The latencies are compiled out.
+            CPPUNIT_ASSERT(records.empty());
+            CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), tp.latencyStatistics(lakoo::Phase::Total)._count);
+            return;
+        }
+
+        const lakoo::Phase phases[] = {
+            lakoo::Phase::TranscodeIn,
+            lakoo::Phase::CaseFold,
+            lakoo::Phase::Scan,
+            lakoo::Phase::Rewrite,
+            lakoo::Phase::TranscodeOut,
+            lakoo::Phase::Total
+        };
+        CPPUNIT_ASSERT_EQUAL(std::size_t(63), records.size());
+        for(std::size_t index = 0; index < 6; ++index)
+        {
+            CPPUNIT_ASSERT(phases[index] == records[index]._phase);
+            CPPUNIT_ASSERT(records[index]._start <= records[index]._end);
+        }
+        CPPUNIT_ASSERT(records[0]._start >= records[5]._start);
+        CPPUNIT_ASSERT(records[4]._end <= records[5]._end);
+
+        // A check has no transcoding or rewrite.
+        CPPUNIT_ASSERT(lakoo::Phase::CaseFold == records[60]._phase);
+        CPPUNIT_ASSERT(lakoo::Phase::Scan == records[61]._phase);
+        CPPUNIT_ASSERT(lakoo::Phase::Total == records[62]._phase);
+
+        lakoo::LatencyStatistics latency = tp.latencyStatistics(lakoo::Phase::Total);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(11), latency._count);
+        CPPUNIT_ASSERT(latency._p50 <= latency._p90);
+        CPPUNIT_ASSERT(latency._p90 <= latency._p99);
+        CPPUNIT_ASSERT(latency._p99 <= latency._p999);
+        CPPUNIT_ASSERT_EQUAL(latency._p999, latency._max);
+        CPPUNIT_ASSERT(latency._max > 0);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(10), tp.latencyStatistics(lakoo::Phase::Rewrite)._count);
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(11), tp.latencyStatistics(lakoo::Phase::Scan)._count);
+
+        // The trace goes on without the counters.
+        tp.setStatisticsEnabled(false);
+        tp.resetStatistics();
+        records.clear();
+        tp.check(context, L"gg");
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), records.size());
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), tp.latencyStatistics(lakoo::Phase::Total)._count);
+
+        tp.setTraceCallback(nullptr, nullptr);
+        tp.check(context, L"gg");
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), records.size());
+    }
+
+    inline void testImage()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "shit", "粗口" });
+        tp.addPattern("b?tch");
+        tp.setMaxDistance(1);
+
+        const std::string path = "test_image.bin";
+        CPPUNIT_ASSERT_EQUAL(true, tp.saveImage(path));
+        CPPUNIT_ASSERT_EQUAL(false, tp.isCompiled());
+
+        lakoo::TextPurifier loaded(std::list<std::string>{ "gg" });
+        loaded.setMaxDistance(1);
+        CPPUNIT_ASSERT_EQUAL(true, loaded.loadImage(path));
+        CPPUNIT_ASSERT_EQUAL(true, loaded.isCompiled());
+
+        const std::string test("fuk you shit 粗口 batch gg");
+        CPPUNIT_ASSERT_EQUAL(tp.purify(test, '*', true), loaded.purify(test, '*', true));
+        CPPUNIT_ASSERT_EQUAL(std::string("*** you **** ** ***** gg"), loaded.purify(test, '*', true));
+
+        // The new words follow the IDs of the image.
+        loaded.add("gg");
+        std::size_t lastId = 0;
+        loaded.find(std::wstring(L"gg"), [&lastId](std::size_t, std::size_t, std::size_t wordId)
+        {
+            lastId = wordId;
+            return true;
+        });
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), lastId);
+
+        // A broken image is rejected and the words are kept.
+        std::ifstream file(path, std::ios::binary);
+        std::string image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        std::remove(path.c_str());
+
+        CPPUNIT_ASSERT_EQUAL(false, loaded.loadImage(image.data(), image.size() - 1));
+        // The edge count of the root, after the header of 32 bytes and the counts of 24 bytes.
+        std::string broken(image);
+        broken[60] ^= 0x7F;
+        CPPUNIT_ASSERT_EQUAL(false, loaded.loadImage(broken.data(), broken.size()));
+        CPPUNIT_ASSERT_EQUAL(false, loaded.loadImage("nothing"));
+        CPPUNIT_ASSERT_EQUAL(true, loaded.check("gg"));
+
+        CPPUNIT_ASSERT_EQUAL(true, loaded.loadImage(image.data(), image.size()));
+        CPPUNIT_ASSERT_EQUAL(false, loaded.check("gg"));
+    }
+
+    inline void testCInterface()
+    {
+        textpurifier* purifier = nullptr;
+        textpurifier_context* context = nullptr;
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK, textpurifier_create(&purifier));
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK, textpurifier_context_create(&context));
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK, textpurifier_add(purifier, "fuck", 4));
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK, textpurifier_add_words(purifier, "shit\n粗口\n", 12));
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK, textpurifier_compile(purifier));
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_IO_ERROR, textpurifier_add_file(purifier, "nothing"));
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_INVALID_ARGUMENT, textpurifier_add(nullptr, "gg", 2));
+
+        // The strings are not terminated.
+        const char* texts[] = { "fuck you", "good game", "粗口shit!" };
+        const std::size_t sizes[] = { 4, 4, 10 };
+        int isFound = 0;
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK,
+                             textpurifier_check(purifier, context, texts[0], sizes[0], &isFound));
+        CPPUNIT_ASSERT_EQUAL(1, isFound);
+
+        unsigned char isFounds[3] = { 0, 0, 0 };
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK,
+                             textpurifier_check_batch(purifier, context, texts, sizes, 3, isFounds));
+        CPPUNIT_ASSERT_EQUAL(1, static_cast<int>(isFounds[0]));
+        CPPUNIT_ASSERT_EQUAL(0, static_cast<int>(isFounds[1]));
+        CPPUNIT_ASSERT_EQUAL(1, static_cast<int>(isFounds[2]));
+
+        char output[32];
+        std::size_t size = 0;
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK,
+                             textpurifier_purify(purifier,
+                                                 context,
+                                                 texts[2],
+                                                 sizes[2],
+                                                 "#",
+                                                 1,
+                                                 output,
+                                                 sizeof(output),
+                                                 &size));
+        CPPUNIT_ASSERT_EQUAL(std::string("##"), std::string(output, size));
+
+        std::size_t ends[3] = { 0, 0, 0 };
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_BUFFER_TOO_SMALL,
+                             textpurifier_purify_batch(purifier,
+                                                       context,
+                                                       texts,
+                                                       sizes,
+                                                       3,
+                                                       nullptr,
+                                                       0,
+                                                       output,
+                                                       6,
+                                                       ends));
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), ends[0]);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(8), ends[1]);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(14), ends[2]);
+        CPPUNIT_ASSERT_EQUAL(std::string("****"), std::string(output, ends[0]));
+
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK,
+                             textpurifier_purify_batch(purifier,
+                                                       context,
+                                                       texts,
+                                                       sizes,
+                                                       3,
+                                                       nullptr,
+                                                       0,
+                                                       output,
+                                                       sizeof(output),
+                                                       ends));
+        CPPUNIT_ASSERT_EQUAL(std::string("****good******"), std::string(output, ends[2]));
+
+        textpurifier_context_destroy(context);
+        textpurifier_destroy(purifier);
+    }
+
+    inline void testLayeredScan()
+    {
+        lakoo::TextPurifier base(std::list<std::string>{ "fuck", "shit", "粗口" });
+        base.addPattern("b?tch");
+        CPPUNIT_ASSERT_EQUAL(false, base.isCompiled());
+
+        lakoo::TextPurifier tenant(std::list<std::string>{ "noob", "shitty" });
+        CPPUNIT_ASSERT_EQUAL(false, tenant.setBase(base));
+        base.compile();
+        CPPUNIT_ASSERT_EQUAL(true, tenant.setBase(base));
+        CPPUNIT_ASSERT_EQUAL(true, tenant.hasBase());
+
+        // The same results as one list of all the words, whether the tenant is compiled or not.
+        lakoo::TextPurifier merged(std::list<std::string>{ "fuck", "shit", "粗口" });
+        merged.addPattern("b?tch");
+        merged.add(std::list<std::string>{ "noob", "shitty" });
+        const std::string test("fuck you shitty noob 粗口 batch");
+        for(int round = 0; round < 2; ++round)
+        {
+            for(lakoo::MatchMode mode : { lakoo::MatchMode::All,
+                                          lakoo::MatchMode::LeftmostLongest,
+                                          lakoo::MatchMode::LeftmostFirst })
+            {
+                tenant.setMatchMode(mode);
+                merged.setMatchMode(mode);
+                CPPUNIT_ASSERT_EQUAL(merged.purify(test, '*', true), tenant.purify(test, '*', true));
+            }
+            tenant.compile();
+        }
+        tenant.setMatchMode(lakoo::MatchMode::All);
+        merged.setMatchMode(lakoo::MatchMode::All);
+        CPPUNIT_ASSERT_EQUAL(std::string("**** you ****** **** ** *****"),
+                             tenant.purify(test, '*', true));
+
+        // The word IDs of the tenant follow the word IDs of the base.
+        std::vector<std::size_t> wordIds;
+        tenant.find(std::wstring(L"noob shit"), [&wordIds](std::size_t, std::size_t, std::size_t wordId)
+        {
+            wordIds.push_back(wordId);
+            return true;
+        });
+        CPPUNIT_ASSERT_EQUAL(std::size_t(2), wordIds.size());
+        CPPUNIT_ASSERT_EQUAL(std::size_t(4), wordIds[0]);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1), wordIds[1]);
+
+        // Approximate matching follows the edges of both layers.
+        tenant.setMaxDistance(1);
+        merged.setMaxDistance(1);
+        const std::string typo("fuk nooob shity");
+        CPPUNIT_ASSERT_EQUAL(std::string("*** ***** ****y"), tenant.purify(typo, '*', true));
+        CPPUNIT_ASSERT_EQUAL(merged.purify(typo, '*', true), tenant.purify(typo, '*', true));
+        tenant.setMaxDistance(0);
+
+        // The tenant keeps its snapshot of the base, and its words are its own.
+        base.add("gg");
+        CPPUNIT_ASSERT_EQUAL(false, tenant.check("gg"));
+        tenant.add("gg");
+        CPPUNIT_ASSERT_EQUAL(true, tenant.check("gg"));
+        CPPUNIT_ASSERT_EQUAL(true, tenant.check("fuck"));
+
+        tenant.clearBase();
+        CPPUNIT_ASSERT_EQUAL(false, tenant.hasBase());
+        CPPUNIT_ASSERT_EQUAL(false, tenant.check("fuck"));
+        CPPUNIT_ASSERT_EQUAL(true, tenant.check("noob"));
+    }
+
+    inline void testNodeOrder()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "fucker", "shit", "shitty", "粗口" });
+        tp.addPattern("b?tch");
+        tp.setMaxDistance(1);
+
+        std::vector<std::uint64_t> visits;
+        const std::string sample("shit happens, fuk it");
+        CPPUNIT_ASSERT_EQUAL(false, tp.recordVisits(sample, visits));
+        tp.compile();
+        CPPUNIT_ASSERT_EQUAL(true, tp.recordVisits(sample, visits));
+        CPPUNIT_ASSERT_EQUAL(tp.nodeCount(), visits.size());
+        CPPUNIT_ASSERT(0 < visits[0]);
+
+        // The words, their IDs and the results are kept.
+        const std::string test("fuck you shitty fucker 粗口 batch fuk");
+        const std::wstring wtest(L"fuck you shitty fucker 粗口 batch fuk");
+        const std::string expected = tp.purify(test, '*', true);
+        std::vector<std::size_t> wordIds;
+        auto collect = [&wordIds](std::size_t, std::size_t, std::size_t wordId)
+        {
+            wordIds.push_back(wordId);
+            return true;
+        };
+        tp.find(wtest, collect);
+        const std::vector<std::size_t> expectedIds(wordIds);
+
+        CPPUNIT_ASSERT_EQUAL(true, tp.orderNodes(visits));
+        CPPUNIT_ASSERT_EQUAL(expected, tp.purify(test, '*', true));
+        wordIds.clear();
+        tp.find(wtest, collect);
+        CPPUNIT_ASSERT(expectedIds == wordIds);
+
+        CPPUNIT_ASSERT_EQUAL(false, tp.orderNodes(std::vector<std::uint64_t>(1, 0)));
+        CPPUNIT_ASSERT_EQUAL(false, tp.orderNodes(std::list<std::string>()));
+        CPPUNIT_ASSERT_EQUAL(true, tp.orderNodes(std::list<std::string>{ test, "粗口粗口" }));
+        CPPUNIT_ASSERT_EQUAL(expected, tp.purify(test, '*', true));
+
+        // The ordered layout is a valid image.
+        const std::string path = "test_order.bin";
+        CPPUNIT_ASSERT_EQUAL(true, tp.saveImage(path));
+        lakoo::TextPurifier loaded;
+        loaded.setMaxDistance(1);
+        CPPUNIT_ASSERT_EQUAL(true, loaded.loadImage(path));
+        std::remove(path.c_str());
+        CPPUNIT_ASSERT_EQUAL(expected, loaded.purify(test, '*', true));
+    }
+
+    inline void testPlacement()
+    {
+        // Enough words for the edges to take huge pages.
+        std::list<std::string> words;
+        std::uint32_t seed = 1;
+        for(int index = 0; index < 20000; ++index)
+        {
+            std::string word;
+            for(int length = 0; length < 8; ++length)
+            {
+                seed = seed * 1103515245 + 12345;
+                word.push_back(static_cast<char>('a' + (seed >> 16) % 26));
+            }
+            words.push_back(word);
+        }
+        const std::string test = "xx " + words.front() + " yy " + words.back() + " zz";
+        const std::string stars(8, '*');
+
+        // The options are kept before the words are compiled, and after they are changed.
+        lakoo::TextPurifier tp(words);
+        tp.setHugePage(true);
+        tp.setNumaReplicated(true);
+        CPPUNIT_ASSERT_EQUAL(true, tp.isHugePage());
+        CPPUNIT_ASSERT_EQUAL(true, tp.isNumaReplicated());
+        const std::size_t trieNodeCount = tp.nodeCount();
+        tp.compile();
+        CPPUNIT_ASSERT(trieNodeCount > tp.nodeCount());
+        CPPUNIT_ASSERT_EQUAL("xx " + stars + " yy " + stars + " zz", tp.purify(test, '*', true));
+
+        tp.setNumaReplicated(false);
+        CPPUNIT_ASSERT_EQUAL("xx " + stars + " yy " + stars + " zz", tp.purify(test, '*', true));
+        tp.add("xx");
+        tp.compile();
+        CPPUNIT_ASSERT_EQUAL("** " + stars + " yy " + stars + " zz", tp.purify(test, '*', true));
+        tp.setHugePage(false);
+        CPPUNIT_ASSERT_EQUAL("** " + stars + " yy " + stars + " zz", tp.purify(test, '*', true));
+
+        // A placed base is shared by the tenants as it is.
+        lakoo::TextPurifier tenant(std::list<std::string>{ "yy" });
+        tp.setHugePage(true);
+        tp.setNumaReplicated(true);
+        CPPUNIT_ASSERT_EQUAL(true, tenant.setBase(tp));
+        CPPUNIT_ASSERT_EQUAL("** " + stars + " ** " + stars + " zz", tenant.purify(test, '*', true));
+    }
+
+    inline void complete(void* context, lakoo::AsyncResult& result)
+    {
+        static_cast<std::promise<lakoo::AsyncResult>*>(context)->set_value(std::move(result));
+    }
+
+    inline void testAsyncComplete()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "粗口" });
+        lakoo::AsyncPurifier async(tp, 2, 16, lakoo::Backpressure::Block);
+
+        std::vector<std::future<lakoo::AsyncResult>> futures;
+        for(int index = 0; index < 100; ++index)
+        {
+            futures.push_back(async.submit(
+                lakoo::AsyncRequest{lakoo::AsyncOperation::Purify, "fuck 粗口 gg", std::string()}));
+        }
+        for(std::future<lakoo::AsyncResult>& future : futures)
+        {
+            const lakoo::AsyncResult result = future.get();
+            CPPUNIT_ASSERT(lakoo::AsyncStatus::Done == result._status);
+            CPPUNIT_ASSERT_EQUAL(true, result._isFound);
+            CPPUNIT_ASSERT_EQUAL(std::string("**** ** gg"), result._text);
+        }
+
+        std::promise<lakoo::AsyncResult> promise;
+        CPPUNIT_ASSERT_EQUAL(true,
+                             async.submit(lakoo::AsyncRequest{lakoo::AsyncOperation::Check,
+                                                              "good game",
+                                                              std::string()},
+                                          &complete,
+                                          &promise));
+        CPPUNIT_ASSERT_EQUAL(false, promise.get_future().get()._isFound);
+
+        // A word is found even if its mask is the word itself, invalid UTF-8 alone is not.
+        lakoo::AsyncResult result = async.submit(
+            lakoo::AsyncRequest{lakoo::AsyncOperation::Purify, "fuck", "fuck"}).get();
+        CPPUNIT_ASSERT_EQUAL(true, result._isFound);
+        CPPUNIT_ASSERT_EQUAL(std::string("fuck"), result._text);
+        result = async.submit(
+            lakoo::AsyncRequest{lakoo::AsyncOperation::Purify, "gg \xFF", std::string()}).get();
+        CPPUNIT_ASSERT_EQUAL(false, result._isFound);
+        CPPUNIT_ASSERT_EQUAL(std::string("gg \xEF\xBF\xBD"), result._text);
+
+        // The completion queue signals the file descriptor.
+        CPPUNIT_ASSERT(-1 != async.completionFd());
+        for(std::uint64_t tag = 1; tag <= 10; ++tag)
+        {
+            CPPUNIT_ASSERT_EQUAL(true,
+                                 async.submit(lakoo::AsyncRequest{lakoo::AsyncOperation::Purify,
+                                                                  "粗口",
+                                                                  "#"},
+                                              tag));
+        }
+
+        std::vector<lakoo::AsyncResult> results;
+        while(results.size() < 10)
+        {
+            pollfd event{async.completionFd(), POLLIN, 0};
+            CPPUNIT_ASSERT_EQUAL(1, ::poll(&event, 1, 10000));
+            async.poll(results);
+        }
+
+        std::uint64_t tags = 0;
+        for(const lakoo::AsyncResult& result : results)
+        {
+            CPPUNIT_ASSERT_EQUAL(std::string("#"), result._text);
+            tags += result._tag;
+        }
+        CPPUNIT_ASSERT_EQUAL(std::uint64_t(55), tags);
+    }
+
+    inline void hold(void* context, lakoo::AsyncResult&)
+    {
+        std::pair<std::atomic<bool>, std::shared_future<void>>& state =
+            *static_cast<std::pair<std::atomic<bool>, std::shared_future<void>>*>(context);
+        state.first = true;
+        state.second.wait();
+    }
+
+    inline void testAsyncBackpressure()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck" });
+        std::promise<void> release;
+        std::pair<std::atomic<bool>, std::shared_future<void>> state;
+        state.first = false;
+        state.second = release.get_future().share();
+
+        lakoo::AsyncPurifier async(tp, 1, 2, lakoo::Backpressure::Reject);
+        const lakoo::AsyncRequest request{lakoo::AsyncOperation::Check, "fuck", std::string()};
+
+        // The only worker is held by the callback, then the queue of 2 is filled.
+        CPPUNIT_ASSERT_EQUAL(true, async.submit(request, &hold, &state));
+        while(!state.first)
+        {
+            std::this_thread::yield();
+        }
+        std::future<lakoo::AsyncResult> first = async.submit(request);
+        CPPUNIT_ASSERT_EQUAL(true, async.submit(request, 1));
+        CPPUNIT_ASSERT_EQUAL(false, async.submit(request, 2));
+
+        std::future<lakoo::AsyncResult> rejected = async.submit(request);
+        CPPUNIT_ASSERT(lakoo::AsyncStatus::Rejected == rejected.get()._status);
+
+        release.set_value();
+        const lakoo::AsyncResult result = first.get();
+        CPPUNIT_ASSERT(lakoo::AsyncStatus::Done == result._status);
+        CPPUNIT_ASSERT_EQUAL(true, result._isFound);
+    }
+
+    inline void testMemoryUsage()
+    {
+        std::list<std::string> words;
+        std::uint32_t seed = 1;
+        for(int index = 0; index < 2000; ++index)
+        {
+            std::string word;
+            for(int length = 0; length < 8; ++length)
+            {
+                seed = seed * 1103515245 + 12345;
+                word.push_back(static_cast<char>('a' + (seed >> 16) % 26));
+            }
+            words.push_back(word);
+        }
+
+        // The trie grows with the words, and the total is the sum of the components.
+        lakoo::TextPurifier tp;
+        const lakoo::MemoryUsage empty = tp.memoryUsage();
+        tp.add(words);
+        const lakoo::MemoryUsage trie = tp.memoryUsage();
+        CPPUNIT_ASSERT(trie._nodes > empty._nodes);
+        CPPUNIT_ASSERT(trie._edges > empty._edges);
+        CPPUNIT_ASSERT_EQUAL(trie._nodes + trie._edges + trie._tables + trie._metadata +
+                             trie._cache,
+                             trie._total);
+
+        // The compiled words take less, with the tables to find their edges.
+        tp.compile();
+        const lakoo::MemoryUsage compiled = tp.memoryUsage();
+        CPPUNIT_ASSERT(compiled._tables > 0);
+        CPPUNIT_ASSERT(compiled._metadata > trie._metadata);
+        CPPUNIT_ASSERT(compiled._total < trie._total);
+
+        // The cache grows with the results.
+        tp.setCacheSize(100);
+        const std::size_t cache = tp.memoryUsage()._cache;
+        tp.purify(std::string("xx ") + words.front() + std::string(100, 'y'), '*', true);
+        CPPUNIT_ASSERT(tp.memoryUsage()._cache > cache);
+
+        // The scratch buffers grow with the input, and they are released by clear.
+        lakoo::ScanContext context;
+        const std::size_t initial = context.memoryUsage();
+        tp.purify(context, std::string(1000, 'x') + words.back(), std::string("*"));
+        CPPUNIT_ASSERT(context.memoryUsage() > initial + 1000 * sizeof(wchar_t));
+        context.clear();
+        CPPUNIT_ASSERT_EQUAL(initial, context.memoryUsage());
+    }
+
+    inline void testMemoryBudget()
+    {
+        const std::list<std::string> words{ "fuck", "shit", "粗口" };
+        const std::string test("fuck you shit");
+        const std::string path = "test_budget.bin";
+        lakoo::TextPurifier source(words);
+        CPPUNIT_ASSERT_EQUAL(true, source.saveImage(path));
+
+        // The changes beyond the budget are rejected, and the words are kept.
+        lakoo::TextPurifier tp(words);
+        const std::size_t bytes = tp.memoryUsage()._nodes + tp.memoryUsage()._edges;
+        tp.setMemoryBudget(bytes);
+        CPPUNIT_ASSERT_EQUAL(bytes, tp.memoryBudget());
+        const std::size_t nodeCount = tp.nodeCount();
+        CPPUNIT_ASSERT_THROW(tp.add("bitch"), std::bad_alloc);
+        CPPUNIT_ASSERT_EQUAL(nodeCount, tp.nodeCount());
+        CPPUNIT_ASSERT_EQUAL(std::string("**** you ****"), tp.purify(test, '*', true));
+        CPPUNIT_ASSERT_EQUAL(std::string("bitch"), tp.purify(std::string("bitch"), '*', true));
+
+        // A word sharing the nodes of the words fits.
+        tp.add("fuck");
+        CPPUNIT_ASSERT_EQUAL(bytes, tp.memoryUsage()._nodes + tp.memoryUsage()._edges);
+
+        // The compiled words and the images are checked before they replace the words.
+        tp.setMemoryBudget(1);
+        CPPUNIT_ASSERT_THROW(tp.addWords("gg\nwtf\n", 7), std::bad_alloc);
+        CPPUNIT_ASSERT_EQUAL(std::string("gg"), tp.purify(std::string("gg"), '*', true));
+        CPPUNIT_ASSERT_THROW(tp.compile(), std::bad_alloc);
+        CPPUNIT_ASSERT_EQUAL(false, tp.isCompiled());
+        CPPUNIT_ASSERT_THROW(tp.loadImage(path), std::bad_alloc);
+        CPPUNIT_ASSERT_EQUAL(false, tp.isCompiled());
+        CPPUNIT_ASSERT_EQUAL(std::string("**** you ****"), tp.purify(test, '*', true));
+
+        // The words can grow again without the budget.
+        tp.setMemoryBudget(0);
+        tp.add("bitch");
+        tp.compile();
+        CPPUNIT_ASSERT_EQUAL(std::string("*****"), tp.purify(std::string("bitch"), '*', true));
+        const lakoo::MemoryUsage compiled = tp.memoryUsage();
+
+        // Adding a word restores the trie, which takes more than the compiled words.
+        tp.setMemoryBudget(compiled._nodes + compiled._edges + compiled._tables);
+        CPPUNIT_ASSERT_THROW(tp.add("wtf"), std::bad_alloc);
+        CPPUNIT_ASSERT_EQUAL(true, tp.isCompiled());
+        tp.setMemoryBudget(compiled._total);
+        CPPUNIT_ASSERT_EQUAL(true, tp.loadImage(path));
+        std::remove(path.c_str());
+
+        // The C interface reports the budget as out of memory.
+        textpurifier* purifier = nullptr;
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK, textpurifier_create(&purifier));
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OK, textpurifier_set_memory_budget(purifier, 1));
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_OUT_OF_MEMORY, textpurifier_add(purifier, "fuck", 4));
+        CPPUNIT_ASSERT_EQUAL(TEXTPURIFIER_INVALID_ARGUMENT,
+                             textpurifier_set_memory_budget(nullptr, 1));
+        textpurifier_destroy(purifier);
+    }
+
+    inline void maskWord(void* context, std::size_t wordId, std::size_t length, std::wstring& mask)
+    {
+        ++*static_cast<std::size_t*>(context);
+        mask = L"<" + std::to_wstring(wordId) + L":" + std::to_wstring(length) + L">";
+    }
+
+    inline void testMaskPolicy()
+    {
+        lakoo::TextPurifier tp(std::list<std::string>{ "fuck", "shit", "粗口" });
+        lakoo::ScanContext context;
+        const std::string test("fuck you shit 粗口!");
+        const std::u16string utf16Test(u"粗口 😀 shit");
+
+        // A fixed or repeated mask is the same as the mask of the other overloads, with and
+        // without the cache.
+        const lakoo::MaskPolicy fixed(std::string("禁言"));
+        const lakoo::MaskPolicy repeated(L'#');
+        for(int round = 0; round < 2; ++round)
+        {
+            CPPUNIT_ASSERT_EQUAL(tp.purify(test, "禁言"), tp.purify(test, fixed));
+            CPPUNIT_ASSERT_EQUAL(tp.purify(test, '#', true), tp.purify(context, test, repeated));
+            CPPUNIT_ASSERT_EQUAL(std::wstring(L"禁言 you 禁言 禁言!"),
+                                 tp.purify(std::wstring(L"fuck you shit 粗口!"), fixed));
+            CPPUNIT_ASSERT(u"## 😀 ####" == tp.purify(utf16Test, repeated));
+            CPPUNIT_ASSERT(u"禁言 😀 禁言" ==
+                           tp.purify(context, utf16Test.data(), utf16Test.size(), fixed));
+            if(0 == round)
+            {
+                tp.setCacheSize(16);
+            }
+        }
+        CPPUNIT_ASSERT(tp.cacheStatistics()._hits > 0);
+        tp.setCacheSize(0);
+
+        // Each category of the words has its own mask.
+        const lakoo::MaskPolicy categories(std::vector<std::size_t>{ 0, 1, 1 },
+                                           std::vector<std::wstring>{ L"*", L"#" },
+                                           true);
+        CPPUNIT_ASSERT_EQUAL(std::string("**** you #### ##!"), tp.purify(test, categories));
+        const lakoo::MaskPolicy fallback(std::vector<std::size_t>{ 2, 1 },
+                                         std::vector<std::wstring>{ L"[x]", L"[y]" },
+                                         false);
+        CPPUNIT_ASSERT_EQUAL(std::string("[x] you [y] [x]!"), tp.purify(test, fallback));
+
+        // The callback writes the mask of each span, the overlapped words are merged.
+        std::size_t calls = 0;
+        const lakoo::MaskPolicy callback(&maskWord, &calls);
+        CPPUNIT_ASSERT_EQUAL(std::string("<0:4> you <1:4> <2:2>!"), tp.purify(test, callback));
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), calls);
+
+        lakoo::TextPurifier overlap(std::list<std::string>{ "abc", "bcd" });
+        CPPUNIT_ASSERT_EQUAL(overlap.purify(std::string("xabcdx"), "禁言"),
+                             overlap.purify(std::string("xabcdx"), fixed));
+        CPPUNIT_ASSERT_EQUAL(std::string("x####x"),
+                             overlap.purify(std::string("xabcdx"), repeated));
+        CPPUNIT_ASSERT_EQUAL(std::string("x<0:4>x"),
+                             overlap.purify(std::string("xabcdx"), callback));
+    }
 }
 
 #endif // __LAKOO_TEST_TEXTPURIFIER_H__
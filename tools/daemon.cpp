@@ -0,0 +1,919 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   daemon.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-19
+ *
+ * The purification server on a Unix domain socket, sharing one dictionary with all the clients.
+ *
+ * The frames are in the byte order of the host, as the clients are on the same host.
+ * A request is <tt>uint32 size, uint32 id, uint8 operation, text</tt> and a response is
+ * <tt>uint32 size, uint32 id, uint8 status, text</tt>, where the size counts the bytes after it.
+ * The operations are 0 to check and 1 to purify the UTF-8 text. The status is 0 if the text is
+ * clean, 1 if it has words and 2 for a bad request, the purified text follows the status for
+ * purifying. A client can send many requests without waiting, and match the responses by the IDs
+ * as the requests of a connection may be scanned by different threads. The server stops reading
+ * the connections while the queue of the requests is full, and drops a client that leaves more
+ * than 64 MB of responses unread.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "dictionary.h"
+#include "text_purifier.h"
+
+
+using namespace lakoo;
+using namespace std;
+
+
+namespace
+{
+    //! The bytes of the size, the ID and the operation or status of a frame.
+    const size_t headerSize = 9;
+
+    //! The maximum size of a request, the connection is closed for a larger one.
+    const uint32_t maxRequestSize = 16U << 20;
+
+    //! The maximum bytes of the requests in the queue, the readers wait for room beyond it.
+    const size_t maxQueuedBytes = 64U << 20;
+
+    //! The maximum bytes of the responses waiting for a client, the client is dropped beyond it.
+    const size_t maxOutputBytes = 64U << 20;
+
+    //! The operations of the requests.
+    enum Operation
+    {
+        CheckOperation = 0,
+        PurifyOperation = 1
+    };
+
+    //! The status of the responses.
+    enum Status
+    {
+        CleanStatus = 0,
+        FoundStatus = 1,
+        ErrorStatus = 2
+    };
+
+    //! The options from the command line.
+    struct Options
+    {
+        DictionaryOptions _dictionary;
+        string _socketPath;
+        string _mask;
+        size_t _threadCount;
+        size_t _batchSize;
+        size_t _maxConnections;
+    };
+
+    void printUsage(const char* program)
+    {
+        fprintf(stderr, "Usage: %s [options] -S <socket>\n", program);
+        fprintf(stderr, "Serve check and purify requests on a Unix domain socket.\n");
+        fprintf(stderr, "SIGHUP reloads the dictionary, SIGINT and SIGTERM stop the server.\n\n");
+        fprintf(stderr, "Options:\n");
+        fprintf(stderr, "  -S <socket>  the path of the socket\n");
+        fprintf(stderr, "  -w <file>    add a word file, one word per line in UTF-8\n");
+        fprintf(stderr, "  -i <image>   load a dictionary image\n");
+        fprintf(stderr, "  -m <mask>    replace each word by the mask, not '*' per character\n");
+        fprintf(stderr, "  -b           match alphabetic words on word boundaries only\n");
+        fprintf(stderr, "  -j <count>   the number of scanning threads, 0 for the cores\n");
+        fprintf(stderr, "  -n <count>   the maximum number of requests in a batch, default 64\n");
+        fprintf(stderr, "  -c <count>   the maximum number of connections, default 256\n");
+    }
+
+    bool parseOptions(int argc, char* argv[], Options& options)
+    {
+        options._dictionary._isWordBoundary = false;
+        options._threadCount = 0;
+        options._batchSize = 64;
+        options._maxConnections = 256;
+
+        int option = 0;
+        while(-1 != (option = getopt(argc, argv, "S:w:i:m:bj:n:c:h")))
+        {
+            switch(option)
+            {
+                case 'S':
+                    options._socketPath = optarg;
+                    break;
+                case 'w':
+                    options._dictionary._wordFiles.push_back(optarg);
+                    break;
+                case 'i':
+                    options._dictionary._image = optarg;
+                    break;
+                case 'm':
+                    options._mask = optarg;
+                    break;
+                case 'b':
+                    options._dictionary._isWordBoundary = true;
+                    break;
+                case 'j':
+                    options._threadCount = strtoul(optarg, nullptr, 10);
+                    break;
+                case 'n':
+                    options._batchSize = max<size_t>(strtoul(optarg, nullptr, 10), 1);
+                    break;
+                case 'c':
+                    options._maxConnections = max<size_t>(strtoul(optarg, nullptr, 10), 1);
+                    break;
+                default:
+                    return false;
+            }
+        }
+
+        if(0 == options._threadCount)
+        {
+            options._threadCount = max<size_t>(thread::hardware_concurrency(), 1);
+        }
+
+        return optind == argc && !options._socketPath.empty();
+    }
+
+    //! A client connection, closed once its thread and all its requests are done.
+    /**
+     * The socket is non-blocking. A scanning thread sends the responses of a batch as far as the
+     * socket takes them and leaves the rest to the thread of the connection, so it never waits
+     * for a client. A client is dropped once more than maxOutputBytes are waiting for it.
+     */
+    class Connection final
+    {
+    public:
+        explicit Connection(int socket)
+        : _socket(socket)
+        , _wakeFds{-1, -1}
+        , _mutex()
+        , _output()
+        , _pendingCount(0)
+        , _isDropped(false)
+        {
+        }
+
+        ~Connection()
+        {
+            ::close(_socket);
+            for(int fd : _wakeFds)
+            {
+                if(-1 != fd)
+                {
+                    ::close(fd);
+                }
+            }
+        }
+
+        Connection(const Connection&) = delete;
+
+        Connection& operator=(const Connection&) = delete;
+
+    public:
+        //! To make the socket non-blocking and create the pipe to wake the thread.
+        bool open()
+        {
+            if(0 != pipe(_wakeFds))
+            {
+                _wakeFds[0] = _wakeFds[1] = -1;
+                return false;
+            }
+
+            return -1 != fcntl(_socket, F_SETFL, O_NONBLOCK) &&
+                   -1 != fcntl(_wakeFds[0], F_SETFL, O_NONBLOCK) &&
+                   -1 != fcntl(_wakeFds[1], F_SETFL, O_NONBLOCK);
+        }
+
+        inline int socket() const { return _socket; }
+
+        inline int wakeFd() const { return _wakeFds[0]; }
+
+        //! To count a request in the queue, so the connection waits for its response.
+        void addPending()
+        {
+            lock_guard<mutex> lock(_mutex);
+            ++_pendingCount;
+        }
+
+        //! To write the responses of a batch of the given number of requests.
+        void write(const string& responses, size_t count)
+        {
+            lock_guard<mutex> lock(_mutex);
+            _pendingCount -= count;
+            if(_isDropped)
+            {
+                return;
+            }
+
+            size_t offset = 0;
+            if(_output.empty() && !sendSome(responses.data(), responses.size(), offset))
+            {
+                drop();
+                return;
+            }
+
+            _output.append(responses, offset, string::npos);
+            if(_output.size() > maxOutputBytes)
+            {
+                drop();
+            }
+            else if(!_output.empty() || 0 == _pendingCount)
+            {
+                const char wake = 0;
+                ssize_t result = ::write(_wakeFds[1], &wake, 1);
+                static_cast<void>(result);
+            }
+        }
+
+        //! To send the waiting responses as far as the socket takes them.
+        void flush()
+        {
+            lock_guard<mutex> lock(_mutex);
+            size_t offset = 0;
+            if(!sendSome(_output.data(), _output.size(), offset))
+            {
+                drop();
+                return;
+            }
+
+            _output.erase(0, offset);
+        }
+
+        //! The state of the connection for its thread.
+        /**
+         * @param [out] hasOutput Whether any response waits for the socket.
+         * @return                The number of requests waiting for their responses, or
+         *                        \c SIZE_MAX if the connection is dropped.
+         */
+        size_t state(bool& hasOutput)
+        {
+            lock_guard<mutex> lock(_mutex);
+            hasOutput = !_output.empty();
+            return _isDropped ? SIZE_MAX : _pendingCount;
+        }
+
+        //! To drop the connection, the responses to come are discarded.
+        void close()
+        {
+            lock_guard<mutex> lock(_mutex);
+            drop();
+        }
+
+    private:
+        bool sendSome(const char* data, size_t size, size_t& offset)
+        {
+            while(offset < size)
+            {
+                const ssize_t count = send(_socket, data + offset, size - offset, MSG_NOSIGNAL);
+                if(count < 0)
+                {
+                    if(EINTR == errno)
+                    {
+                        continue;
+                    }
+                    return EAGAIN == errno || EWOULDBLOCK == errno;
+                }
+
+                offset += static_cast<size_t>(count);
+            }
+
+            return true;
+        }
+
+        void drop()
+        {
+            if(!_isDropped)
+            {
+                _isDropped = true;
+                string().swap(_output);
+                shutdown(_socket, SHUT_RDWR);
+            }
+        }
+
+    private:
+        int _socket;
+        int _wakeFds[2];
+        mutex _mutex;
+        string _output;
+        size_t _pendingCount;
+        bool _isDropped;
+    };
+
+    //! A request waiting for a scanning thread.
+    struct Request
+    {
+        shared_ptr<Connection> _connection;
+        uint32_t _id;
+        uint8_t _operation;
+        string _text;
+    };
+
+    //! The queue of the requests of all connections, taken by the scanning threads in batches.
+    /**
+     * The queue holds up to maxQueuedBytes, a reader waits for room and so stops reading its
+     * socket, which holds back a client sending faster than the requests are scanned.
+     */
+    class RequestQueue final
+    {
+    public:
+        RequestQueue()
+        : _mutex()
+        , _condition()
+        , _roomCondition()
+        , _requests()
+        , _bytes(0)
+        , _isClosed(false)
+        {
+        }
+
+        RequestQueue(const RequestQueue&) = delete;
+
+        RequestQueue& operator=(const RequestQueue&) = delete;
+
+    public:
+        //! To wait for room and add a request, a request larger than the room fits an empty queue.
+        /**
+         * @return \c false if the queue is closed.
+         */
+        bool push(Request&& request)
+        {
+            const size_t bytes = sizeof(Request) + request._text.size();
+            {
+                unique_lock<mutex> lock(_mutex);
+                _roomCondition.wait(lock, [this, bytes]()
+                {
+                    return _isClosed || _requests.empty() || _bytes + bytes <= maxQueuedBytes;
+                });
+
+                if(_isClosed)
+                {
+                    return false;
+                }
+
+                _bytes += bytes;
+                _requests.push_back(move(request));
+            }
+            _condition.notify_one();
+            return true;
+        }
+
+        //! To wait for requests and take up to the given number of them.
+        /**
+         * @return \c false if the queue is closed.
+         */
+        bool pop(vector<Request>& batch, size_t maxCount)
+        {
+            batch.clear();
+            unique_lock<mutex> lock(_mutex);
+            _condition.wait(lock, [this]()
+            {
+                return _isClosed || !_requests.empty();
+            });
+
+            if(_requests.empty())
+            {
+                return false;
+            }
+
+            const size_t count = min(maxCount, _requests.size());
+            for(size_t index = 0; index < count; ++index)
+            {
+                _bytes -= sizeof(Request) + _requests.front()._text.size();
+                batch.push_back(move(_requests.front()));
+                _requests.pop_front();
+            }
+            lock.unlock();
+            _roomCondition.notify_all();
+            return true;
+        }
+
+        //! To close the queue, the requests in it are still taken.
+        void close()
+        {
+            {
+                lock_guard<mutex> lock(_mutex);
+                _isClosed = true;
+            }
+            _condition.notify_all();
+            _roomCondition.notify_all();
+        }
+
+    private:
+        mutex _mutex;
+        condition_variable _condition;
+        condition_variable _roomCondition;
+        deque<Request> _requests;
+        size_t _bytes;
+        bool _isClosed;
+    };
+
+    //! To parse the complete requests in the input into the queue.
+    /**
+     * @return \c false for a bad request or if the queue is closed.
+     */
+    bool pushRequests(const shared_ptr<Connection>& connection,
+                      string& input,
+                      RequestQueue& queue)
+    {
+        size_t offset = 0;
+        while(input.size() - offset >= headerSize)
+        {
+            uint32_t size = 0;
+            memcpy(&size, input.data() + offset, sizeof(size));
+            if(size < headerSize - 4 || size > maxRequestSize)
+            {
+                return false;
+            }
+            if(input.size() - offset < 4 + size)
+            {
+                break;
+            }
+
+            Request request;
+            memcpy(&request._id, input.data() + offset + 4, sizeof(request._id));
+            request._operation = static_cast<uint8_t>(input[offset + 8]);
+            request._text.assign(input, offset + headerSize, size - (headerSize - 4));
+            request._connection = connection;
+            offset += 4 + size;
+
+            connection->addPending();
+            if(!queue.push(move(request)))
+            {
+                return false;
+            }
+        }
+
+        input.erase(0, offset);
+        return true;
+    }
+
+    //! To read the requests of a connection into the queue and send its responses.
+    /**
+     * After the client stops sending, the connection stays until the responses of all its
+     * requests are sent.
+     */
+    void serveConnection(const shared_ptr<Connection>& connection, RequestQueue& queue)
+    {
+        const size_t chunkSize = 64U << 10;
+        string input;
+        bool isReading = true;
+        for(;;)
+        {
+            bool hasOutput = false;
+            const size_t pendingCount = connection->state(hasOutput);
+            if(SIZE_MAX == pendingCount || (!isReading && 0 == pendingCount && !hasOutput))
+            {
+                break;
+            }
+
+            pollfd events[2] = {
+                {connection->socket(),
+                 static_cast<short>((isReading ? POLLIN : 0) | (hasOutput ? POLLOUT : 0)),
+                 0},
+                {connection->wakeFd(), POLLIN, 0}
+            };
+            if(poll(events, 2, -1) < 0)
+            {
+                if(EINTR == errno)
+                {
+                    continue;
+                }
+                break;
+            }
+
+            if(0 != events[1].revents)
+            {
+                char wakes[64];
+                while(read(connection->wakeFd(), wakes, sizeof(wakes)) > 0)
+                {
+                }
+            }
+
+            if(0 != (events[0].revents & POLLOUT))
+            {
+                connection->flush();
+            }
+
+            if(0 != (events[0].revents & (POLLHUP | POLLERR)) && !isReading)
+            {
+                // The client is gone, the responses cannot be delivered.
+                break;
+            }
+
+            // One chunk is read at a time, so the responses are sent between the chunks.
+            if(isReading && 0 != (events[0].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                const size_t size = input.size();
+                input.resize(size + chunkSize);
+                const ssize_t count = recv(connection->socket(), &input[size], chunkSize, 0);
+                input.resize(size + static_cast<size_t>(max<ssize_t>(count, 0)));
+                if(count > 0)
+                {
+                    isReading = pushRequests(connection, input, queue);
+                }
+                else if(0 == count || (EINTR != errno && EAGAIN != errno && EWOULDBLOCK != errno))
+                {
+                    isReading = false;
+                }
+
+                if(!isReading)
+                {
+                    shutdown(connection->socket(), SHUT_RD);
+                }
+            }
+        }
+
+        connection->close();
+    }
+
+    //! The threads of the connections, up to a maximum number, joined when the server stops.
+    class ConnectionSet final
+    {
+    public:
+        explicit ConnectionSet(size_t maxCount)
+        : _maxCount(maxCount)
+        , _mutex()
+        , _entries()
+        , _isStopped(false)
+        {
+        }
+
+        ConnectionSet(const ConnectionSet&) = delete;
+
+        ConnectionSet& operator=(const ConnectionSet&) = delete;
+
+    public:
+        //! To start the thread of a connection.
+        /**
+         * @return \c false if the connection is closed, as the maximum is reached.
+         */
+        bool start(int socket, RequestQueue& queue)
+        {
+            const shared_ptr<Connection> connection = make_shared<Connection>(socket);
+            if(!connection->open())
+            {
+                return false;
+            }
+
+            lock_guard<mutex> lock(_mutex);
+            reap();
+            if(_isStopped || _entries.size() >= _maxCount)
+            {
+                return false;
+            }
+
+            _entries.emplace_back();
+            Entry& entry = _entries.back();
+            entry._connection = connection;
+            entry._isDone = false;
+            entry._thread = thread([this, connection, &entry, &queue]()
+            {
+                serveConnection(connection, queue);
+                lock_guard<mutex> lock(_mutex);
+                entry._isDone = true;
+            });
+            return true;
+        }
+
+        //! To shut down the connections and join their threads.
+        void stop()
+        {
+            list<Entry> entries;
+            {
+                lock_guard<mutex> lock(_mutex);
+                _isStopped = true;
+                for(Entry& entry : _entries)
+                {
+                    entry._connection->close();
+                }
+                entries.swap(_entries);
+            }
+
+            for(Entry& entry : entries)
+            {
+                entry._thread.join();
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            shared_ptr<Connection> _connection;
+            thread _thread;
+            bool _isDone;
+        };
+
+        //! To join the threads of the connections done.
+        void reap()
+        {
+            for(auto entry = _entries.begin(); entry != _entries.end();)
+            {
+                if(entry->_isDone)
+                {
+                    entry->_thread.join();
+                    entry = _entries.erase(entry);
+                }
+                else
+                {
+                    ++entry;
+                }
+            }
+        }
+
+    private:
+        size_t _maxCount;
+        mutex _mutex;
+        list<Entry> _entries;
+        bool _isStopped;
+    };
+
+    //! To append a response frame.
+    void appendResponse(string& output, uint32_t id, uint8_t status, const string* text)
+    {
+        const uint32_t size =
+            static_cast<uint32_t>(headerSize - 4 + (nullptr != text ? text->size() : 0));
+        output.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        output.append(reinterpret_cast<const char*>(&id), sizeof(id));
+        output.push_back(static_cast<char>(status));
+        if(nullptr != text)
+        {
+            output.append(*text);
+        }
+    }
+
+    //! The responses of a batch to a connection.
+    struct Output
+    {
+        Connection* _connection;
+        string _responses;
+        size_t _count;
+    };
+
+    //! To scan the batches of requests, with one snapshot of the dictionary for each batch.
+    void scanRequests(RequestQueue& queue,
+                      const shared_ptr<const TextPurifier>& dictionary,
+                      const Options& options)
+    {
+        ScanContext context;
+        vector<Request> batch;
+        vector<Output> outputs;
+        while(queue.pop(batch, options._batchSize))
+        {
+            const shared_ptr<const TextPurifier> purifier = atomic_load(&dictionary);
+
+            // The responses are grouped by the connections, so each of them gets one write.
+            for(Output& output : outputs)
+            {
+                output._connection = nullptr;
+                output._responses.clear();
+                output._count = 0;
+            }
+
+            for(const Request& request : batch)
+            {
+                auto output = find_if(outputs.begin(),
+                                      outputs.end(),
+                                      [&request](const Output& output)
+                {
+                    return nullptr == output._connection ||
+                           request._connection.get() == output._connection;
+                });
+                if(outputs.end() == output)
+                {
+                    outputs.push_back(Output{nullptr, string(), 0});
+                    output = outputs.end() - 1;
+                }
+                output->_connection = request._connection.get();
+                ++output->_count;
+
+                if(CheckOperation == request._operation)
+                {
+                    const bool isFound = purifier->check(context, request._text);
+                    appendResponse(output->_responses,
+                                   request._id,
+                                   isFound ? FoundStatus : CleanStatus,
+                                   nullptr);
+                }
+                else if(PurifyOperation == request._operation)
+                {
+                    const string& text = request._text;
+                    const string& result = options._mask.empty()
+                                           ? purifier->purify(context, text, '*', true)
+                                           : purifier->purify(context, text, options._mask);
+                    appendResponse(output->_responses,
+                                   request._id,
+                                   context.isFound() ? FoundStatus : CleanStatus,
+                                   &result);
+                }
+                else
+                {
+                    appendResponse(output->_responses, request._id, ErrorStatus, nullptr);
+                }
+            }
+
+            for(const Output& output : outputs)
+            {
+                if(nullptr != output._connection)
+                {
+                    output._connection->write(output._responses, output._count);
+                }
+            }
+        }
+    }
+
+    //! To build a new snapshot of the dictionary.
+    shared_ptr<const TextPurifier> loadSnapshot(const Options& options)
+    {
+        shared_ptr<TextPurifier> purifier = make_shared<TextPurifier>();
+        if(!loadDictionary(options._dictionary, *purifier))
+        {
+            return nullptr;
+        }
+
+        return purifier;
+    }
+
+    int listenSocket(const string& path)
+    {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if(path.size() >= sizeof(address.sun_path))
+        {
+            fprintf(stderr, "the socket path is too long: %s\n", path.c_str());
+            return -1;
+        }
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        const int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str());
+        if(-1 == server ||
+           0 != bind(server, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) ||
+           0 != listen(server, SOMAXCONN))
+        {
+            fprintf(stderr, "cannot listen on %s: %s\n", path.c_str(), strerror(errno));
+            if(-1 != server)
+            {
+                close(server);
+            }
+            return -1;
+        }
+
+        return server;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if(!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    // The signals are taken by sigwait of the main thread only.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    shared_ptr<const TextPurifier> dictionary = loadSnapshot(options);
+    if(nullptr == dictionary)
+    {
+        return 2;
+    }
+
+    const int server = listenSocket(options._socketPath);
+    if(-1 == server)
+    {
+        return 2;
+    }
+
+    RequestQueue queue;
+    ConnectionSet connections(options._maxConnections);
+    vector<thread> scanners;
+    for(size_t index = 0; index < options._threadCount; ++index)
+    {
+        scanners.emplace_back(scanRequests, ref(queue), cref(dictionary), cref(options));
+    }
+
+    atomic<bool> isStopped(false);
+    atomic<bool> isFailed(false);
+    thread acceptor([&]()
+    {
+        for(;;)
+        {
+            const int client = accept(server, nullptr, nullptr);
+            if(-1 != client)
+            {
+                connections.start(client, queue);
+                continue;
+            }
+
+            if(isStopped)
+            {
+                return;
+            }
+
+            const int error = errno;
+            if(EINTR == error || ECONNABORTED == error)
+            {
+                continue;
+            }
+
+            fprintf(stderr, "cannot accept a connection: %s\n", strerror(error));
+            if(EMFILE == error || ENFILE == error || ENOBUFS == error || ENOMEM == error)
+            {
+                // The connections to come wait in the backlog until the resources are back.
+                this_thread::sleep_for(chrono::milliseconds(100));
+                continue;
+            }
+
+            // The main thread stops the server as for SIGTERM.
+            isFailed = true;
+            kill(getpid(), SIGTERM);
+            return;
+        }
+    });
+
+    for(;;)
+    {
+        int signal = 0;
+        if(0 != sigwait(&signals, &signal))
+        {
+            continue;
+        }
+
+        if(SIGHUP != signal)
+        {
+            break;
+        }
+
+        // The batches in progress keep the old snapshot, the next batches take the new one.
+        const shared_ptr<const TextPurifier> snapshot = loadSnapshot(options);
+        if(nullptr != snapshot)
+        {
+            atomic_store(&dictionary, snapshot);
+            fprintf(stderr, "the dictionary is reloaded\n");
+        }
+    }
+
+    isStopped = true;
+    shutdown(server, SHUT_RDWR);
+    acceptor.join();
+    close(server);
+    unlink(options._socketPath.c_str());
+
+    // The connections waiting for room in the queue give up once it is closed.
+    queue.close();
+    connections.stop();
+    for(thread& scanner : scanners)
+    {
+        scanner.join();
+    }
+
+    return isFailed ? 1 : 0;
+}
@@ -0,0 +1,55 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   dictionary.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-19
+ */
+
+#include "dictionary.h"
+
+#include <cstdio>
+
+
+using namespace lakoo;
+using namespace std;
+
+
+bool lakoo::loadDictionary(const DictionaryOptions& options, TextPurifier& purifier)
+{
+    purifier.setWordBoundary(options._isWordBoundary);
+    if(!options._image.empty() && !purifier.loadImage(options._image))
+    {
+        fprintf(stderr, "cannot load the image %s\n", options._image.c_str());
+        return false;
+    }
+
+    for(const string& path : options._wordFiles)
+    {
+        if(!purifier.addFile(path))
+        {
+            fprintf(stderr, "cannot read %s\n", path.c_str());
+            return false;
+        }
+    }
+
+    purifier.compile();
+    return true;
+}
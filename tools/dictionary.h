@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   dictionary.h
+ * @author Aludirk Wong
+ * @date   2017-08-19
+ */
+
+#ifndef __LAKOO_TOOLS_DICTIONARY_H__
+#define __LAKOO_TOOLS_DICTIONARY_H__
+
+#include <string>
+#include <vector>
+
+#include "text_purifier.h"
+
+
+namespace lakoo
+{
+    //! The options of the dictionary of the tools.
+    struct DictionaryOptions
+    {
+        //! The word files, one word per line in UTF-8.
+        std::vector<std::string> _wordFiles;
+
+        //! The image saved by TextPurifier::saveImage, empty for none.
+        std::string _image;
+
+        //! Whether to match the words of alphabetic scripts on word boundaries.
+        bool _isWordBoundary;
+    };
+
+
+    //! To load the image and the word files into a TextPurifier and compile it.
+    /**
+     * The errors are printed to the standard error.
+     * @param [in]  options  The DictionaryOptions.
+     * @param [out] purifier The TextPurifier without any word.
+     * @return               \c false if any file cannot be loaded.
+     */
+    bool loadDictionary(const DictionaryOptions& options, TextPurifier& purifier);
+} // namespace lakoo
+
+#endif // __LAKOO_TOOLS_DICTIONARY_H__
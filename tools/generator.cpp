@@ -0,0 +1,177 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   generator.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-11
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "dafsa.h"
+#include "word_loader.h"
+
+
+using namespace lakoo;
+using namespace std;
+
+
+namespace
+{
+    //! The number of values on a line of the generated tables.
+    const size_t valuesPerLine = 4;
+
+    void printUsage(const char* program)
+    {
+        fprintf(stderr, "Usage: %s <word file> <name>\n", program);
+        fprintf(stderr, "Generate a header of the lakoo::StaticDictionary <name> from a word file,\n");
+        fprintf(stderr, "one word per line in UTF-8, to the standard output.\n");
+    }
+
+    bool readFile(const char* path, string& data)
+    {
+        // A directory opens as a stream too, but it has no size to read.
+        struct stat status;
+        if(0 != stat(path, &status) || !S_ISREG(status.st_mode))
+        {
+            return false;
+        }
+
+        ifstream file(path, ios::binary);
+        if(!file)
+        {
+            return false;
+        }
+
+        file.seekg(0, ios::end);
+        const streamoff size = file.tellg();
+        if(0 > size)
+        {
+            return false;
+        }
+
+        data.resize(static_cast<size_t>(size));
+        file.seekg(0, ios::beg);
+        return data.empty() || static_cast<bool>(file.read(&data[0], data.size()));
+    }
+
+    template <typename _Value, typename _Allocator, typename _Print>
+    void printTable(const char* type,
+                    const char* name,
+                    const vector<_Value, _Allocator>& values,
+                    _Print print)
+    {
+        // An array cannot be empty, the dummy value is never read.
+        printf("    constexpr %s %s[] = {", type, name);
+        for(size_t index = 0; index < max<size_t>(values.size(), 1); ++index)
+        {
+            printf("%s", 0 == index % valuesPerLine ? "\n        " : " ");
+            print(values.empty() ? _Value() : values[index]);
+            printf(",");
+        }
+        printf("\n    };\n");
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    if(3 != argc)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string data;
+    if(!readFile(argv[1], data))
+    {
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    // The word IDs follow the first lines of the words, the same as TextPurifier::addFile.
+    WordLoader loader(data.data(), data.size(), 0);
+    const size_t noWord = numeric_limits<size_t>::max();
+    vector<size_t> wordIds(loader.lineCount(), noWord);
+    for(const LoadedWord& word : loader.words())
+    {
+        wordIds[word._line] = 0;
+    }
+
+    size_t wordCount = 0;
+    for(size_t& wordId : wordIds)
+    {
+        if(noWord != wordId)
+        {
+            wordId = wordCount++;
+        }
+    }
+
+    DafsaBuilder builder;
+    for(const LoadedWord& word : loader.words())
+    {
+        builder.add(word._characters, word._length, wordIds[word._line]);
+    }
+    const shared_ptr<Dafsa> dafsa = builder.build();
+
+    // The static dictionary walks plain nodes, so the chains are expanded.
+    Dafsa::NodeArray nodes;
+    Dafsa::EdgeArray edges;
+    dafsa->expand(nodes, edges);
+
+    const char* const name = argv[2];
+    printf("// Generated by textpurifier-gen from %s, do not edit.\n\n", argv[1]);
+    printf("#ifndef __TEXTPURIFIER_GEN_%s__\n", name);
+    printf("#define __TEXTPURIFIER_GEN_%s__\n\n", name);
+    printf("#include \"static_dictionary.h\"\n\n\n");
+    printf("namespace %sTables\n{\n", name);
+    printTable("lakoo::StaticDictionary::Node", "nodes", nodes,
+               [](const Dafsa::Node& node)
+    {
+        printf("{%u, %u, %s}", node._firstEdge, node._edgeCount, node._isFinal ? "true" : "false");
+    });
+    printf("\n");
+    printTable("lakoo::StaticDictionary::Edge", "edges", edges,
+               [](const Dafsa::Edge& edge)
+    {
+        printf("{L'\\x%x', %u, %u}",
+               static_cast<unsigned>(edge._character), edge._target, edge._rank);
+    });
+    printf("\n");
+    printTable("std::size_t", "wordIds", dafsa->wordIds(), [](size_t wordId)
+    {
+        printf("%zu", wordId);
+    });
+    printf("} // namespace %sTables\n\n", name);
+    printf("constexpr lakoo::StaticDictionary %s(\n", name);
+    printf("    %sTables::nodes, %zu,\n", name, nodes.size());
+    printf("    %sTables::edges,\n", name);
+    printf("    %sTables::wordIds, %zu);\n\n", name, dafsa->wordCount());
+    printf("#endif // __TEXTPURIFIER_GEN_%s__\n", name);
+
+    return 0;
+}
@@ -0,0 +1,618 @@
+/******************************************************************************
+ * Copyright (C) 2017 Lakoo Games Ltd.                                        *
+ *                                                                            *
+ * This file is part of Text Purifier.                                        *
+ *                                                                            *
+ * Text Purifier is free software: you can redistribute it and/or modify it   *
+ * under the terms of the GNU Lesser General Public License as published      *
+ * by the Free Software Foundation, either version 3 of the License, or       *
+ * (at your option) any later version.                                        *
+ *                                                                            *
+ * Text Purifier is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of             *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the              *
+ * GNU Lesser General Public License for more details.                        *
+ *                                                                            *
+ * You should have received a copy of the GNU Lesser General Public License   *
+ * along with Text Purifier.  If not, see <http://www.gnu.org/licenses/>.     *
+ ******************************************************************************/
+
+/**
+ * @file   purifier.cpp
+ * @author Aludirk Wong
+ * @date   2017-08-18
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dictionary.h"
+#include "text_purifier.h"
+
+
+using namespace lakoo;
+using namespace std;
+
+
+namespace
+{
+    //! The size of the blocks to read and write.
+    const size_t blockSize = 1UL << 20;
+
+    //! The commands.
+    enum class Command
+    {
+        Check,
+        Purify,
+        Matches,
+        Compile
+    };
+
+    //! The options from the command line.
+    struct Options
+    {
+        Command _command;
+        DictionaryOptions _dictionary;
+        string _mask;
+        size_t _threadCount;
+        string _suffix;
+        vector<string> _inputs;
+    };
+
+    //! To decode a line of UTF-8 as the library does, each invalid sequence to U+FFFD.
+    /**
+     * @param [in]  line    The line.
+     * @param [out] result  The characters.
+     * @param [out] offsets The byte offset of each character, and the size of the line at last.
+     */
+    void decodeLine(const string& line, wstring& result, vector<size_t>& offsets)
+    {
+        result.clear();
+        offsets.clear();
+
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(line.data());
+        const size_t size = line.size();
+        size_t index = 0;
+        while(index < size)
+        {
+            offsets.push_back(index);
+            const unsigned char lead = input[index];
+            size_t trail = 0;
+            uint32_t codePoint = lead;
+            uint32_t minimum = 0;
+            if(0xC0U == (lead & 0xE0U))
+            {
+                trail = 1;
+                codePoint = lead & 0x1FU;
+                minimum = 0x80U;
+            }
+            else if(0xE0U == (lead & 0xF0U))
+            {
+                trail = 2;
+                codePoint = lead & 0x0FU;
+                minimum = 0x800U;
+            }
+            else if(0xF0U == (lead & 0xF8U))
+            {
+                trail = 3;
+                codePoint = lead & 0x07U;
+                minimum = 0x10000U;
+            }
+
+            size_t next = index + 1;
+            bool isValid = lead < 0x80U || (0 < trail && index + trail < size);
+            for(; isValid && next <= index + trail; ++next)
+            {
+                if(0x80U != (input[next] & 0xC0U))
+                {
+                    isValid = false;
+                    break;
+                }
+                codePoint = (codePoint << 6) | (input[next] & 0x3FU);
+            }
+
+            isValid = isValid &&
+                      codePoint >= minimum &&
+                      codePoint <= 0x10FFFFU &&
+                      (codePoint < 0xD800U || codePoint > 0xDFFFU);
+            result.push_back(isValid ? static_cast<wchar_t>(codePoint) : L'\xFFFD');
+            index = next;
+        }
+
+        offsets.push_back(size);
+    }
+
+    void printUsage(const char* program)
+    {
+        fprintf(stderr, "Usage: %s [options] check|purify|matches [file...]\n", program);
+        fprintf(stderr, "       %s [options] compile <image>\n\n", program);
+        fprintf(stderr, "Scan the files line by line, or the standard input for none or \"-\".\n");
+        fprintf(stderr, "  check    print <file>:<line> of the lines to purify, exit 1 if any\n");
+        fprintf(stderr, "  purify   write the purified text, to <file><suffix> for the files\n");
+        fprintf(stderr, "  matches  print <file>:<line>:<column>:<word> of the words found\n");
+        fprintf(stderr, "  compile  save the dictionary to an image to load with -i\n\n");
+        fprintf(stderr, "Options:\n");
+        fprintf(stderr, "  -w <file>    add a word file, one word per line in UTF-8\n");
+        fprintf(stderr, "  -i <image>   load a dictionary image\n");
+        fprintf(stderr, "  -m <mask>    replace each word by the mask, not '*' per character\n");
+        fprintf(stderr, "  -b           match alphabetic words on word boundaries only\n");
+        fprintf(stderr, "  -j <count>   the number of files to scan at a time, 0 for the cores\n");
+        fprintf(stderr, "  -s <suffix>  the suffix of the purified files, default \".purified\"\n");
+    }
+
+    bool parseOptions(int argc, char* argv[], Options& options)
+    {
+        options._command = Command::Check;
+        options._dictionary._isWordBoundary = false;
+        options._threadCount = 0;
+        options._suffix = ".purified";
+
+        int option = 0;
+        while(-1 != (option = getopt(argc, argv, "w:i:m:bj:s:h")))
+        {
+            switch(option)
+            {
+                case 'w':
+                    options._dictionary._wordFiles.push_back(optarg);
+                    break;
+                case 'i':
+                    options._dictionary._image = optarg;
+                    break;
+                case 'm':
+                    options._mask = optarg;
+                    break;
+                case 'b':
+                    options._dictionary._isWordBoundary = true;
+                    break;
+                case 'j':
+                    options._threadCount = strtoul(optarg, nullptr, 10);
+                    break;
+                case 's':
+                    options._suffix = optarg;
+                    break;
+                default:
+                    return false;
+            }
+        }
+
+        if(optind >= argc)
+        {
+            return false;
+        }
+
+        const string command(argv[optind++]);
+        if("check" == command)
+        {
+            options._command = Command::Check;
+        }
+        else if("purify" == command)
+        {
+            options._command = Command::Purify;
+        }
+        else if("matches" == command)
+        {
+            options._command = Command::Matches;
+        }
+        else if("compile" == command)
+        {
+            options._command = Command::Compile;
+        }
+        else
+        {
+            return false;
+        }
+
+        options._inputs.assign(argv + optind, argv + argc);
+        if(options._inputs.empty() && Command::Compile != options._command)
+        {
+            options._inputs.push_back("-");
+        }
+
+        return Command::Compile != options._command || 1 == options._inputs.size();
+    }
+
+    //! The output buffered in blocks, the lines of the threads sharing a file are not mixed up.
+    class Output final
+    {
+    public:
+        Output(FILE* file, mutex* lock)
+        : _file(file)
+        , _lock(lock)
+        , _buffer()
+        {
+            _buffer.reserve(blockSize);
+        }
+
+        ~Output()
+        {
+            flush();
+        }
+
+        Output(const Output&) = delete;
+
+        Output& operator=(const Output&) = delete;
+
+    public:
+        //! To append the text, it is flushed only between the lines.
+        inline void append(const char* text, size_t size)
+        {
+            _buffer.append(text, size);
+        }
+
+        inline void append(const string& text)
+        {
+            _buffer.append(text);
+        }
+
+        //! To end a line, the block is written once it is full.
+        inline void endLine()
+        {
+            _buffer.push_back('\n');
+            if(_buffer.size() >= blockSize)
+            {
+                flush();
+            }
+        }
+
+        void flush()
+        {
+            if(_buffer.empty())
+            {
+                return;
+            }
+
+            if(nullptr != _lock)
+            {
+                lock_guard<mutex> guard(*_lock);
+                fwrite(_buffer.data(), 1, _buffer.size(), _file);
+            }
+            else
+            {
+                fwrite(_buffer.data(), 1, _buffer.size(), _file);
+            }
+            _buffer.clear();
+        }
+
+    private:
+        FILE* _file;
+        mutex* _lock;
+        string _buffer;
+    };
+
+    //! To scan the lines of the inputs by a command.
+    class LineScanner final
+    {
+    public:
+        LineScanner(const TextPurifier& purifier, const Options& options)
+        : _purifier(purifier)
+        , _options(options)
+        , _context()
+        , _line()
+        , _wideLine()
+        , _offsets()
+        , _number()
+        , _isFound(false)
+        {
+        }
+
+        LineScanner(const LineScanner&) = delete;
+
+        LineScanner& operator=(const LineScanner&) = delete;
+
+    public:
+        //! Whether any word is found.
+        inline bool isFound() const { return _isFound; }
+
+        //! To scan a line without the newline.
+        void scanLine(const char* name,
+                      size_t lineNumber,
+                      const char* text,
+                      size_t size,
+                      bool hasNewline,
+                      Output& output)
+        {
+            _line.assign(text, size);
+            switch(_options._command)
+            {
+                case Command::Check:
+                    if(_purifier.check(_context, _line))
+                    {
+                        _isFound = true;
+                        printLocation(name, lineNumber, output);
+                        output.endLine();
+                    }
+                    break;
+                case Command::Purify:
+                    // A clean line is written as it is read, even if it is not valid UTF-8.
+                    if(!_purifier.check(_context, _line))
+                    {
+                        output.append(_line);
+                    }
+                    else if(_options._mask.empty())
+                    {
+                        output.append(_purifier.purify(_context, _line, '*', true));
+                    }
+                    else
+                    {
+                        output.append(_purifier.purify(_context, _line, _options._mask));
+                    }
+
+                    if(hasNewline)
+                    {
+                        output.endLine();
+                    }
+                    break;
+                case Command::Matches:
+                    // Most lines are clean, only the lines with words are transcoded for find.
+                    if(!_purifier.check(_context, _line))
+                    {
+                        break;
+                    }
+
+                    _isFound = true;
+                    decodeLine(_line, _wideLine, _offsets);
+                    _purifier.find(_wideLine, [&](size_t start, size_t length, size_t)
+                    {
+                        printLocation(name, lineNumber, output);
+                        output.append(":", 1);
+                        printNumber(start + 1, output);
+                        output.append(":", 1);
+                        output.append(_line.data() + _offsets[start],
+                                      _offsets[start + length] - _offsets[start]);
+                        output.endLine();
+                        return true;
+                    });
+                    break;
+                case Command::Compile:
+                    break;
+            }
+        }
+
+        //! To scan the lines of a block, the last line of the input may have no newline.
+        /**
+         * @return The number of bytes of the complete lines scanned.
+         */
+        size_t scanBlock(const char* name,
+                         size_t& lineNumber,
+                         const char* data,
+                         size_t size,
+                         bool isLast,
+                         Output& output)
+        {
+            size_t start = 0;
+            while(start < size)
+            {
+                const char* newline =
+                    static_cast<const char*>(memchr(data + start, '\n', size - start));
+                if(nullptr == newline && !isLast)
+                {
+                    break;
+                }
+
+                const size_t end = nullptr != newline ? newline - data : size;
+                scanLine(name, ++lineNumber, data + start, end - start, nullptr != newline, output);
+                start = nullptr != newline ? end + 1 : end;
+            }
+
+            return start;
+        }
+
+    private:
+        void printLocation(const char* name, size_t lineNumber, Output& output)
+        {
+            output.append(name, strlen(name));
+            output.append(":", 1);
+            printNumber(lineNumber, output);
+        }
+
+        void printNumber(size_t number, Output& output)
+        {
+            const int size = snprintf(_number, sizeof(_number), "%zu", number);
+            output.append(_number, static_cast<size_t>(size));
+        }
+
+    private:
+        const TextPurifier& _purifier;
+        const Options& _options;
+        ScanContext _context;
+        string _line;
+        wstring _wideLine;
+        vector<size_t> _offsets;
+        char _number[24];
+        bool _isFound;
+    };
+
+    //! To scan a stream in blocks, carrying the incomplete line to the next block.
+    bool scanStream(int input, const char* name, LineScanner& scanner, Output& output)
+    {
+        vector<char> block(blockSize);
+        size_t size = 0;
+        size_t lineNumber = 0;
+        for(;;)
+        {
+            if(size == block.size())
+            {
+                // A line longer than the block.
+                block.resize(block.size() * 2);
+            }
+
+            const ssize_t count = read(input, block.data() + size, block.size() - size);
+            if(count < 0)
+            {
+                if(EINTR == errno)
+                {
+                    continue;
+                }
+                return false;
+            }
+
+            size += static_cast<size_t>(count);
+            const bool isLast = 0 == count;
+            const size_t scanned =
+                scanner.scanBlock(name, lineNumber, block.data(), size, isLast, output);
+            if(isLast)
+            {
+                return true;
+            }
+
+            memmove(block.data(), block.data() + scanned, size - scanned);
+            size -= scanned;
+        }
+    }
+
+    //! To scan a file, memory mapped if it can be, or streamed.
+    bool scanFile(const string& path, LineScanner& scanner, Output& output)
+    {
+        const int file = open(path.c_str(), O_RDONLY);
+        if(-1 == file)
+        {
+            return false;
+        }
+
+        struct stat status;
+        void* data = MAP_FAILED;
+        if(0 == fstat(file, &status) && S_ISREG(status.st_mode) && status.st_size > 0)
+        {
+            data = mmap(nullptr,
+                        static_cast<size_t>(status.st_size),
+                        PROT_READ,
+                        MAP_PRIVATE,
+                        file,
+                        0);
+        }
+
+        bool isScanned = true;
+        if(MAP_FAILED != data)
+        {
+            const size_t size = static_cast<size_t>(status.st_size);
+            madvise(data, size, MADV_SEQUENTIAL);
+            size_t lineNumber = 0;
+            scanner.scanBlock(path.c_str(),
+                              lineNumber,
+                              static_cast<const char*>(data),
+                              size,
+                              true,
+                              output);
+            munmap(data, size);
+        }
+        else
+        {
+            isScanned = scanStream(file, path.c_str(), scanner, output);
+        }
+
+        close(file);
+        return isScanned;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if(!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    TextPurifier purifier;
+    if(!loadDictionary(options._dictionary, purifier))
+    {
+        return 2;
+    }
+
+    if(Command::Compile == options._command)
+    {
+        if(!purifier.saveImage(options._inputs[0]))
+        {
+            fprintf(stderr, "cannot write %s\n", options._inputs[0].c_str());
+            return 2;
+        }
+        return 0;
+    }
+
+    size_t threadCount = 0 != options._threadCount
+                         ? options._threadCount
+                         : max<size_t>(thread::hardware_concurrency(), 1);
+    threadCount = min(threadCount, options._inputs.size());
+
+    // The files are taken by the threads in turn, each thread has its own ScanContext.
+    mutex stdoutLock;
+    atomic<size_t> next(0);
+    atomic<bool> isFound(false);
+    atomic<bool> isFailed(false);
+    auto work = [&]()
+    {
+        LineScanner scanner(purifier, options);
+        Output output(stdout, &stdoutLock);
+        for(size_t index = next++; index < options._inputs.size(); index = next++)
+        {
+            const string& input = options._inputs[index];
+            bool isScanned = false;
+            if("-" == input)
+            {
+                isScanned = scanStream(STDIN_FILENO, "-", scanner, output);
+            }
+            else if(Command::Purify == options._command)
+            {
+                FILE* file = fopen((input + options._suffix).c_str(), "wb");
+                if(nullptr != file)
+                {
+                    {
+                        Output fileOutput(file, nullptr);
+                        isScanned = scanFile(input, scanner, fileOutput);
+                    }
+                    isScanned = 0 == fclose(file) && isScanned;
+                }
+            }
+            else
+            {
+                isScanned = scanFile(input, scanner, output);
+            }
+
+            if(!isScanned)
+            {
+                lock_guard<mutex> guard(stdoutLock);
+                fprintf(stderr, "cannot scan %s\n", input.c_str());
+                isFailed = true;
+            }
+        }
+
+        if(scanner.isFound())
+        {
+            isFound = true;
+        }
+    };
+
+    vector<thread> threads;
+    for(size_t index = 1; index < threadCount; ++index)
+    {
+        threads.emplace_back(work);
+    }
+    work();
+    for(thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    if(isFailed)
+    {
+        return 2;
+    }
+
+    return Command::Check == options._command && isFound ? 1 : 0;
+}